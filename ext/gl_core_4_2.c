@@ -87,6 +87,10 @@ static PROC WinGetProcAddress(const char *name)
 	#else
 		#if defined(__sgi) || defined(__sun)
 			#define IntGetProcAddress(name) SunGetProcAddress(name)
+		#elif defined(USE_HEADLESS_EGL)
+			#include <EGL/egl.h>
+
+			#define IntGetProcAddress(name) eglGetProcAddress(name)
 		#else /* GLX */
 		    #include <GL/glx.h>
 
@@ -1,6 +1,7 @@
 #include "commonCode.h"
 #include "Init.h"
 #include "DisplayUtils.h"
+#include "GLState.h"
 
 namespace displayUtils
 {
@@ -29,35 +30,32 @@ namespace displayUtils
         const GLsizei STRIDE = sizeof(float)*5;
 
         glGenBuffers(1, vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+        glState::bindBuffer(GL_ARRAY_BUFFER, *vbo);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadData), quadData, GL_STATIC_DRAW);
 
         //
         // VAO setup
         //
         glGenVertexArrays(1, vao); 
-        glBindVertexArray(*vao);
+        glState::bindVertexArray(*vao);
 
-        glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+        glState::bindBuffer(GL_ARRAY_BUFFER, *vbo);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STRIDE, 0);
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*3));
         CHECK_OPENGL_ERRORS();
 
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glState::bindVertexArray(0);
     }
 
     ///////////////////////////////////////////////////////////////////////////////
     void drawQuad(GLuint vao)
     {
-        glBindVertexArray(vao);
+        // the vao stays bound, so drawing the same quad again costs no binds
+        glState::bindVertexArray(vao);
 
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
 }
\ No newline at end of file
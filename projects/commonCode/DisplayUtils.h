@@ -15,7 +15,7 @@ namespace displayUtils
     //! @param vbo this parameter will return new, initialized vbo
     void initQuadGeometry(GLuint* vao, GLuint* vbo);
 
-    //! Draw given quad. Takes care of disabling VAO 
+    //! Draw given quad. The VAO is left bound (binds go through glState)
     void drawQuad(GLuint vao);
 
 }
\ No newline at end of file
@@ -0,0 +1,411 @@
+/** @file FrameCapture.cpp
+*  @brief frames of the back buffer written to files without stalling the rendering
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+#include <algorithm>
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "Framebuffer.h"
+#include "FrameCapture.h"
+
+namespace
+{
+    const GLuint READBACK_RING_SIZE = 3;
+
+    /// PNG CRC, filled in FrameCapture::start on the main thread before the worker runs
+    unsigned int sCrcTable[256];
+    bool         sCrcTableReady = false;
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void initCrcTable()
+    {
+        if (sCrcTableReady)
+            return;
+
+        for (unsigned int n = 0; n < 256; ++n)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            sCrcTable[n] = c;
+        }
+        sCrcTableReady = true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    unsigned int updateCrc(unsigned int crc, const unsigned char *data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            crc = sCrcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void putBE32(std::vector<unsigned char> *out, unsigned int v)
+    {
+        out->push_back((unsigned char)(v >> 24));
+        out->push_back((unsigned char)(v >> 16));
+        out->push_back((unsigned char)(v >> 8));
+        out->push_back((unsigned char)v);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool writeChunk(FILE *fp, const char *type, const std::vector<unsigned char> &data)
+    {
+        std::vector<unsigned char> head;
+        putBE32(&head, (unsigned int)data.size());
+        head.insert(head.end(), type, type + 4);
+
+        unsigned int crc = updateCrc(0xffffffffu, (const unsigned char *)type, 4);
+        if (!data.empty())
+            crc = updateCrc(crc, &data[0], data.size());
+        std::vector<unsigned char> tail;
+        putBE32(&tail, crc ^ 0xffffffffu);
+
+        return fwrite(&head[0], 1, head.size(), fp) == head.size() &&
+               (data.empty() || fwrite(&data[0], 1, data.size(), fp) == data.size()) &&
+               fwrite(&tail[0], 1, tail.size(), fp) == tail.size();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    unsigned char clampByte(int v)
+    {
+        return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    FILE *openFile(const std::string &name, const char *mode)
+    {
+        FILE *fp = NULL;
+#ifdef _MSC_VER
+        fopen_s(&fp, name.c_str(), mode);
+#else
+        fp = fopen(name.c_str(), mode);
+#endif
+        return fp;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameCapture::FrameCapture() :
+    mFormat(Format::RAW),
+    mWidth(0),
+    mHeight(0),
+    mFps(60),
+    mRequested(0),
+    mCapturing(false),
+    mStopping(false),
+    mStream(NULL),
+    mWritten(0),
+    mMaxQueued(8)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::start(const char *prefix, Format format, GLuint width, GLuint height, GLuint fps)
+{
+    assert(prefix && width > 0 && height > 0 && fps > 0);
+
+    stop();
+
+    mPrefix    = prefix;
+    mFormat    = format;
+    mWidth     = width;
+    mHeight    = height;
+    mFps       = fps;
+    mRequested = 0;
+    mWritten   = 0;
+    mStopping  = false;
+
+    if (mReadback.init(READBACK_RING_SIZE, (GLsizeiptr)mWidth * mHeight * 4) == false)
+        return false;
+
+    if (mFormat == Format::RAW || mFormat == Format::Y4M)
+    {
+        const std::string name = mPrefix + (mFormat == Format::RAW ? ".rgba" : ".y4m");
+        mStream = openFile(name, "wb");
+        if (mStream == NULL)
+        {
+            LOG_ERROR("cannot create %s", name.c_str());
+            mReadback.destroy();
+            return false;
+        }
+
+        // C420jpeg - full range BT.601, the same as the conversion in writeY4M
+        if (mFormat == Format::Y4M)
+            fprintf(mStream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", mWidth, mHeight, mFps);
+        else
+            LOG("raw capture: %ux%u RGBA8, %u fps", mWidth, mHeight, mFps);
+    }
+    else
+        initCrcTable();
+
+    mCapturing = true;
+    mWorker = std::thread(&FrameCapture::workerLoop, this);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameCapture::stop()
+{
+    if (!mCapturing)
+        return;
+
+    // the last frames are still in the ring
+    glFinish();
+    update();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeUp.notify_all();
+    mWorker.join();
+
+    if (mStream)
+    {
+        fclose(mStream);
+        mStream = NULL;
+    }
+    mReadback.destroy();
+    mQueue.clear();
+    mCapturing = false;
+
+    LOG("capture %s finished: %u frames written", mPrefix.c_str(), mWritten);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::isReady()
+{
+    if (!mCapturing || mReadback.isFull())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() + mReadback.pendingCount() < mMaxQueued;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::captureFrame()
+{
+    if (!mCapturing || mReadback.isFull())
+        return false;
+
+    PixelReadback::Region region;
+    region.mWidth  = mWidth;
+    region.mHeight = mHeight;
+    region.mTag    = mRequested;
+
+    const GLuint systemFbo = FrameBuffer::getSystemFrameBufferId();
+    glState::bindFramebuffer(GL_READ_FRAMEBUFFER, systemFbo);
+    glReadBuffer(systemFbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    if (mReadback.readPixels(region, GL_RGBA, GL_UNSIGNED_BYTE) == false)
+        return false;
+
+    mRequested++;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameCapture::update()
+{
+    if (!mCapturing)
+        return;
+
+    const size_t size = (size_t)mWidth * mHeight * 4;
+
+    PixelReadback::Region region;
+    const unsigned char *data = NULL;
+    while ((data = (const unsigned char *)mReadback.mapOldest(&region)) != NULL)
+    {
+        std::vector<unsigned char> frame(data, data + size);
+        mReadback.unmap();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.push_back(std::vector<unsigned char>());
+            mQueue.back().swap(frame);
+        }
+        mWakeUp.notify_one();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameCapture::workerLoop()
+{
+    std::vector<unsigned char> frame;
+    bool ok = true;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mStopping && mQueue.empty())
+                mWakeUp.wait(lock);
+
+            // everything queued before stop() is written
+            if (mQueue.empty())
+                break;
+
+            frame.swap(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        // the frames are consumed anyway, so the main thread never waits for a broken disk
+        if (ok && (ok = writeFrame(frame)) == false)
+            LOG_ERROR("cannot write the frame %u of %s", mWritten, mPrefix.c_str());
+        if (ok)
+            mWritten++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::writeFrame(const std::vector<unsigned char> &rgba)
+{
+    if (mFormat == Format::Y4M)
+        return writeY4M(rgba);
+    if (mFormat == Format::PNG)
+        return writePNG(rgba);
+
+    // GL rows go from the bottom, files from the top
+    const size_t rowSize = (size_t)mWidth * 4;
+    for (GLuint y = 0; y < mHeight; ++y)
+    {
+        if (fwrite(&rgba[(mHeight - 1 - y) * rowSize], 1, rowSize, mStream) != rowSize)
+            return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::writeY4M(const std::vector<unsigned char> &rgba)
+{
+    const GLuint cw = (mWidth + 1) / 2;
+    const GLuint ch = (mHeight + 1) / 2;
+    mConverted.resize((size_t)mWidth * mHeight + 2 * (size_t)cw * ch);
+
+    unsigned char *planeY = &mConverted[0];
+    unsigned char *planeU = planeY + (size_t)mWidth * mHeight;
+    unsigned char *planeV = planeU + (size_t)cw * ch;
+
+    // fixed point BT.601, full range
+    for (GLuint y = 0; y < mHeight; ++y)
+    {
+        const unsigned char *src = &rgba[(size_t)(mHeight - 1 - y) * mWidth * 4];
+        unsigned char *dst = planeY + (size_t)y * mWidth;
+        for (GLuint x = 0; x < mWidth; ++x, src += 4)
+            dst[x] = clampByte((77 * src[0] + 150 * src[1] + 29 * src[2] + 128) >> 8);
+    }
+
+    // chroma of 2x2 blocks, the last column/row is repeated for odd sizes
+    for (GLuint cy = 0; cy < ch; ++cy)
+    {
+        for (GLuint cx = 0; cx < cw; ++cx)
+        {
+            int r = 0, g = 0, b = 0;
+            for (GLuint dy = 0; dy < 2; ++dy)
+            {
+                const GLuint y = std::min(cy * 2 + dy, mHeight - 1);
+                for (GLuint dx = 0; dx < 2; ++dx)
+                {
+                    const GLuint x = std::min(cx * 2 + dx, mWidth - 1);
+                    const unsigned char *p = &rgba[((size_t)(mHeight - 1 - y) * mWidth + x) * 4];
+                    r += p[0]; g += p[1]; b += p[2];
+                }
+            }
+            r /= 4; g /= 4; b /= 4;
+            planeU[(size_t)cy * cw + cx] = clampByte((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+            planeV[(size_t)cy * cw + cx] = clampByte((128 * r - 107 * g - 21 * b + 32896) >> 8);
+        }
+    }
+
+    return fputs("FRAME\n", mStream) >= 0 &&
+           fwrite(&mConverted[0], 1, mConverted.size(), mStream) == mConverted.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCapture::writePNG(const std::vector<unsigned char> &rgba)
+{
+    char name[16];
+#ifdef _MSC_VER
+    sprintf_s(name, sizeof(name), "_%05u.png", mWritten);
+#else
+    snprintf(name, sizeof(name), "_%05u.png", mWritten);
+#endif
+    const std::string fileName = mPrefix + name;
+
+    //
+    // zlib stream of stored deflate blocks: no compression, but no dependency and no CPU time
+    //
+    const size_t rowSize = (size_t)mWidth * 4;
+    const size_t rawSize = (rowSize + 1) * mHeight;     // filter byte (0 - none) + row
+    const size_t MAX_STORED = 65535;
+
+    std::vector<unsigned char> &idat = mConverted;
+    idat.clear();
+    idat.reserve(2 + rawSize + 5 * (rawSize / MAX_STORED + 1) + 4);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+
+    unsigned int adlerA = 1, adlerB = 0;
+    size_t blockLeft = 0;
+    size_t written = 0;
+    for (GLuint y = 0; y < mHeight; ++y)
+    {
+        const unsigned char *row = &rgba[(mHeight - 1 - y) * rowSize];
+        for (size_t i = 0; i <= rowSize; ++i)
+        {
+            if (blockLeft == 0)
+            {
+                const size_t len = std::min(MAX_STORED, rawSize - written);
+                idat.push_back(written + len == rawSize ? 1 : 0);
+                idat.push_back((unsigned char)(len & 0xff));
+                idat.push_back((unsigned char)(len >> 8));
+                idat.push_back((unsigned char)(~len & 0xff));
+                idat.push_back((unsigned char)((~len >> 8) & 0xff));
+                blockLeft = len;
+            }
+
+            const unsigned char b = i == 0 ? 0 : row[i - 1];
+            idat.push_back(b);
+            adlerA = (adlerA + b) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+            blockLeft--;
+            written++;
+        }
+    }
+    putBE32(&idat, (adlerB << 16) | adlerA);
+
+    std::vector<unsigned char> ihdr;
+    putBE32(&ihdr, mWidth);
+    putBE32(&ihdr, mHeight);
+    ihdr.push_back(8);      // bits per channel
+    ihdr.push_back(6);      // RGBA
+    ihdr.push_back(0);      // deflate
+    ihdr.push_back(0);      // adaptive filtering
+    ihdr.push_back(0);      // no interlace
+
+    FILE *fp = openFile(fileName, "wb");
+    if (fp == NULL)
+        return false;
+
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    bool ok = fwrite(SIGNATURE, 1, sizeof(SIGNATURE), fp) == sizeof(SIGNATURE) &&
+              writeChunk(fp, "IHDR", ihdr) &&
+              writeChunk(fp, "IDAT", idat) &&
+              writeChunk(fp, "IEND", std::vector<unsigned char>());
+    ok = fclose(fp) == 0 && ok;
+
+    return ok;
+}
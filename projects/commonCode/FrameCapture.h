@@ -0,0 +1,92 @@
+/** @file FrameCapture.h
+*  @brief frames of the back buffer written to files without stalling the rendering
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "PixelReadback.h"
+
+/** captures rendered frames for reference clips
+*
+* captureFrame() only queues a read of the back buffer (ring of pixel pack buffers),
+* update() collects the finished reads and a worker thread converts and writes them.
+* When the ring or the queue of the worker is full isReady() returns false - the application
+* should not advance its time in that frame (see mainIdle), so no frame is ever lost and
+* nothing waits. Every captured frame is 1/fps of simulated time, the clip does not depend
+* on the speed of the machine.
+*
+* formats:
+* RAW - "prefix.rgba", RGBA8 frames one after another, rows from the top
+* Y4M - "prefix.y4m", YUV 4:2:0 (BT.601 full range) stream, most video tools read it
+* PNG - "prefix_00000.png"... one file per frame, stored (not deflated) data, big but fast to write
+*/
+class FrameCapture
+{
+public:
+    enum class Format
+    {
+        RAW,
+        Y4M,
+        PNG
+    };
+private:
+    PixelReadback mReadback;
+    Format        mFormat;
+    std::string   mPrefix;
+    GLuint        mWidth;
+    GLuint        mHeight;
+    GLuint        mFps;
+    GLuint        mRequested;    //!< frames passed to captureFrame
+    bool          mCapturing;
+
+    // frames waiting for the worker (RGBA, rows from the bottom):
+    std::deque<std::vector<unsigned char> > mQueue;
+    std::thread             mWorker;
+    std::mutex              mMutex;
+    std::condition_variable mWakeUp;
+    bool                    mStopping;
+
+    // used only by the worker:
+    FILE                      *mStream;        //!< RAW and Y4M
+    GLuint                     mWritten;
+    std::vector<unsigned char> mConverted;
+public:
+    /// frames the worker may lag behind, default is 8
+    GLuint mMaxQueued;
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    /// starts a clip of width x height pixels (the size of the back buffer that is read)
+    bool start(const char *prefix, Format format, GLuint width, GLuint height, GLuint fps = 60);
+    /// waits for the pending frames, closes the files
+    void stop();
+    bool isCapturing() const { return mCapturing; }
+
+    /// false when the next frame cannot be accepted without waiting, skip the update then
+    bool isReady();
+    /// reads the back buffer, call it after the scene is rendered and before the UI and the swap
+    bool captureFrame();
+    /// collects finished reads, call it once per frame
+    void update();
+
+    /// simulated time of one frame in seconds
+    double frameTime() const { return 1.0 / (double)mFps; }
+    GLuint frameCount() const { return mRequested; }
+private:
+    void workerLoop();
+    bool writeFrame(const std::vector<unsigned char> &rgba);
+    bool writeY4M(const std::vector<unsigned char> &rgba);
+    bool writePNG(const std::vector<unsigned char> &rgba);
+
+    // block copying:
+    FrameCapture(const FrameCapture &);
+    FrameCapture & operator=(const FrameCapture &);
+};
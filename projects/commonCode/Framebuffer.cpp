@@ -9,11 +9,13 @@
 #include "Init.h"
 #include "Log.h"
 #include "Framebuffer.h"
+#include "GLState.h"
 
 using namespace std;
 
 
 FrameBuffer *FrameBuffer::sCurrentBinding = NULL;
+GLuint FrameBuffer::sSystemFboId = 0;
 
 GLuint FrameBuffer::sMaxColorTargets = 0;
 GLuint FrameBuffer::sMaxRenderbufferSize = 0;
@@ -53,7 +55,7 @@ bool FrameBuffer::createAndBind()
 
     glGenFramebuffers(1, &mFboId);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
+    glState::bindFramebuffer(GL_FRAMEBUFFER, mFboId);
     mIsBounded = true;
     sCurrentBinding = this;
 
@@ -71,12 +73,22 @@ void FrameBuffer::destroy()
 
         glDeleteFramebuffers(1, &mFboId);
         mFboId = 0;
+
+        // GL falls back to the system framebuffer when the bound fbo is deleted
+        glState::invalidate();
     }
     mTargets.clear();
+    mDrawBuffers.clear();
+    mDepthTarget = Target();
+
+    // so that the object can be created again
+    if (sCurrentBinding == this)
+        sCurrentBinding = NULL;
+    mIsBounded = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void FrameBuffer::attachTextureAsColorTarget(GLuint destId, GLuint texId, int w, int h, GLenum texType) 
+void FrameBuffer::attachTextureAsColorTarget(GLuint destId, GLuint texId, int w, int h, GLenum texType, GLint level) 
 {
     assert(texId != 0);
     assert(destId < sMaxColorTargets);
@@ -88,7 +100,7 @@ void FrameBuffer::attachTextureAsColorTarget(GLuint destId, GLuint texId, int w,
     mTargets[destId].mObject = texId;
     mTargets[destId].mType = texType;
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+destId, texType, texId, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+destId, texType, texId, level);
 
     // get W & H:
     mWidth = w;
@@ -192,6 +204,7 @@ void FrameBuffer::createAndAttachDepthRenderbuffer(int w, int h)
     assert(mDepthTarget.mType == 0);
 
     mDepthTarget.mType = GL_RENDERBUFFER;
+    mDepthTarget.mActive = true;
     glGenRenderbuffers(1, &mDepthTarget.mObject);
     glBindRenderbuffer(GL_RENDERBUFFER, mDepthTarget.mObject);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h);
@@ -204,16 +217,17 @@ void FrameBuffer::createAndAttachDepthRenderbuffer(int w, int h)
 ///////////////////////////////////////////////////////////////////////////////
 bool FrameBuffer::bind(bool setNewViewport) 
 {
-    if (mIsBounded) return true;
-
     if (sCurrentBinding != NULL && sCurrentBinding != this)
         sCurrentBinding->unbind();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
+    // redundant binds are filtered by glState
+    glState::bindFramebuffer(GL_FRAMEBUFFER, mFboId);
 
     // check completness
 #ifdef _DEBUG
-    if (check() == false) return false;
+    // unbinding the previous target does not touch mIsBounded of this one
+    const bool wasBound = mIsBounded;
+    if (!wasBound && check() == false) return false;
 #endif
 
 
@@ -221,7 +235,7 @@ bool FrameBuffer::bind(bool setNewViewport)
     sCurrentBinding = this;
 
     if (setNewViewport)
-        glViewport(0, 0, mWidth, mHeight);
+        glState::viewport(0, 0, mWidth, mHeight);
 
     return true;
 }
@@ -284,7 +298,7 @@ void FrameBuffer::bindColorTargetAsTexture(GLuint colorTargetId)
     assert(mTargets[colorTargetId].mActive == true);
     assert(mTargets[colorTargetId].mType == GL_TEXTURE_2D);
 
-    glBindTexture(GL_TEXTURE_2D, mTargets[colorTargetId].mObject);
+    glState::bindTexture(GL_TEXTURE_2D, mTargets[colorTargetId].mObject);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -293,7 +307,7 @@ void FrameBuffer::bindDepthAsTexture()
     assert(mDepthTarget.mActive == true);
     assert(mDepthTarget.mType == GL_TEXTURE_2D);
 
-    glBindTexture(GL_TEXTURE_2D, mDepthTarget.mObject);
+    glState::bindTexture(GL_TEXTURE_2D, mDepthTarget.mObject);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -320,9 +334,11 @@ void FrameBuffer::bindSystemFrameBuffer(int screenW, int screenH)
 
     sCurrentBinding = NULL;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDrawBuffer(GL_BACK);
+    // draw buffer of an fbo is its own state, set when it was created
+    glState::bindFramebuffer(GL_FRAMEBUFFER, sSystemFboId);
+    if (sSystemFboId == 0)
+        glState::systemDrawBuffer(GL_BACK);
 
     if (screenW > 0 && screenH > 0)
-        glViewport(0, 0, screenW, screenH);
+        glState::viewport(0, 0, screenW, screenH);
 }
\ No newline at end of file
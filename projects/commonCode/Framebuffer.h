@@ -42,8 +42,8 @@ public:
     /** destroys the framebuffer */
     void destroy();
 
-    /** attaches texture to specific color target target */
-    void attachTextureAsColorTarget(GLuint destId, GLuint texId, int w, int h, GLenum texType);
+    /** attaches texture (or one of its mip levels, w and h are the size of that level) to specific color target target */
+    void attachTextureAsColorTarget(GLuint destId, GLuint texId, int w, int h, GLenum texType, GLint level = 0);
 
     /** attaches texture layer to specified color target */
     void attachTextureLayerAsColorTarget(GLuint destId, GLuint layer, GLuint texId, int w, int h, GLenum texType);
@@ -72,6 +72,10 @@ public:
     */
     static void bindSystemFrameBuffer(int screenW = -1, int screenH = -1);
 
+    /** fbo used instead of the window's framebuffer (headless context), 0 - the window */
+    static void setSystemFrameBufferId(GLuint fboId) { sSystemFboId = fboId; }
+    static GLuint getSystemFrameBufferId() { return sSystemFboId; }
+
     /** checks its completness */
     bool check();
 
@@ -107,6 +111,7 @@ private:
     /// calculated when the first Framebuffer is created using 'createAndBind'
     static GLuint sMaxRenderbufferSize;
     static FrameBuffer *sCurrentBinding;
+    static GLuint sSystemFboId;
 
     //
     // block copying:
@@ -0,0 +1,53 @@
+/** @file Frustum.cpp
+*  @brief view frustum planes and visibility tests of bounding volumes
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Frustum.h"
+
+///////////////////////////////////////////////////////////////////////////////
+Frustum::Frustum()
+{
+    // everything is visible:
+    for (int i = 0; i < PLANE_COUNT; ++i)
+        mPlanes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Frustum::fromMatrix(const glm::mat4 &m)
+{
+    // glm is column major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    mPlanes[LEFT]       = row3 + row0;
+    mPlanes[RIGHT]      = row3 - row0;
+    mPlanes[BOTTOM]     = row3 + row1;
+    mPlanes[TOP]        = row3 - row1;
+    mPlanes[NEAR_PLANE] = row3 + row2;
+    mPlanes[FAR_PLANE]  = row3 - row2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Frustum::isBoxVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const
+{
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        const glm::vec4 &p = mPlanes[i];
+
+        // corner of the box that is the furthest along the plane normal
+        glm::vec3 corner(p.x >= 0.0f ? boxMax.x : boxMin.x,
+                         p.y >= 0.0f ? boxMax.y : boxMin.y,
+                         p.z >= 0.0f ? boxMax.z : boxMin.z);
+
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
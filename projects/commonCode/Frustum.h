@@ -0,0 +1,30 @@
+/** @file Frustum.h
+*  @brief view frustum planes and visibility tests of bounding volumes
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** six planes of the view frustum in world space (or in the space of the matrix input)
+*
+* planes are extracted directly from the projection * modelview matrix (Gribb & Hartmann),
+* they point inside and are not normalized, so only the sign of the distance can be used.
+*/
+class Frustum
+{
+public:
+    enum Plane { LEFT = 0, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+private:
+    glm::vec4 mPlanes[PLANE_COUNT];
+public:
+    Frustum();
+    explicit Frustum(const glm::mat4 &viewProjection) { fromMatrix(viewProjection); }
+
+    void fromMatrix(const glm::mat4 &viewProjection);
+
+    /// conservative test: boxes near the corners of the frustum can be reported as visible
+    bool isBoxVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const;
+
+    const glm::vec4 &plane(Plane p) const { return mPlanes[p]; }
+};
@@ -0,0 +1,303 @@
+/** @file GLState.cpp
+*  @brief shadowed OpenGL state, redundant binds and state changes are not sent to the driver
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+
+namespace glState
+{
+    namespace
+    {
+        /// value that never matches a real name, so the next call is always issued
+        const GLuint UNKNOWN = 0xFFFFFFFF;
+        const GLuint MAX_TEXTURE_UNITS = 32;
+
+        enum BufferSlot
+        {
+            ARRAY_BUFFER_SLOT,
+            ELEMENT_ARRAY_BUFFER_SLOT,
+            PIXEL_PACK_BUFFER_SLOT,
+            PIXEL_UNPACK_BUFFER_SLOT,
+            UNIFORM_BUFFER_SLOT,
+            BUFFER_SLOT_COUNT
+        };
+
+        struct State
+        {
+            GLuint mProgram;
+            GLuint mVertexArray;
+            GLuint mBuffers[BUFFER_SLOT_COUNT];
+            GLuint mActiveTexture;         //!< index, not GL_TEXTUREi
+            GLuint mTextures2D[MAX_TEXTURE_UNITS];
+            GLuint mDrawFramebuffer;
+            GLuint mReadFramebuffer;
+            GLenum mSystemDrawBuffer;
+            GLint  mViewport[4];
+            GLuint mDepthTest;             //!< 0, 1 or UNKNOWN
+            GLuint mBlend;
+            GLenum mBlendSrc;
+            GLenum mBlendDst;
+        };
+
+        State sState;
+        Stats sStats = { 0, 0 };
+        bool  sInitialized = false;
+
+        inline void ensureInitialized()
+        {
+            if (!sInitialized)
+                invalidate();
+        }
+
+        /// @return true when the call has to be sent to GL
+        inline bool changed(GLuint *cached, GLuint value)
+        {
+            ensureInitialized();
+            if (*cached == value)
+            {
+                sStats.mFiltered++;
+                return false;
+            }
+            *cached = value;
+            sStats.mIssued++;
+            return true;
+        }
+
+        inline int bufferSlot(GLenum target)
+        {
+            switch (target)
+            {
+            case GL_ARRAY_BUFFER:         return ARRAY_BUFFER_SLOT;
+            case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_BUFFER_SLOT;
+            case GL_PIXEL_PACK_BUFFER:    return PIXEL_PACK_BUFFER_SLOT;
+            case GL_PIXEL_UNPACK_BUFFER:  return PIXEL_UNPACK_BUFFER_SLOT;
+            case GL_UNIFORM_BUFFER:       return UNIFORM_BUFFER_SLOT;
+            default:                      return -1;
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void invalidate()
+    {
+        sState.mProgram     = UNKNOWN;
+        sState.mVertexArray = UNKNOWN;
+        for (int i = 0; i < BUFFER_SLOT_COUNT; ++i)
+            sState.mBuffers[i] = UNKNOWN;
+        sState.mActiveTexture = UNKNOWN;
+        for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i)
+            sState.mTextures2D[i] = UNKNOWN;
+        sState.mDrawFramebuffer  = UNKNOWN;
+        sState.mReadFramebuffer  = UNKNOWN;
+        sState.mSystemDrawBuffer = UNKNOWN;
+        sState.mViewport[0] = sState.mViewport[1] = -1;
+        sState.mViewport[2] = sState.mViewport[3] = -1;
+        sState.mDepthTest = UNKNOWN;
+        sState.mBlend     = UNKNOWN;
+        sState.mBlendSrc  = UNKNOWN;
+        sState.mBlendDst  = UNKNOWN;
+
+        sInitialized = true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    const Stats &stats()
+    {
+        return sStats;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void resetStats()
+    {
+        sStats.mIssued   = 0;
+        sStats.mFiltered = 0;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void useProgram(GLuint program)
+    {
+        if (changed(&sState.mProgram, program))
+            glUseProgram(program);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindVertexArray(GLuint vao)
+    {
+        if (changed(&sState.mVertexArray, vao))
+        {
+            glBindVertexArray(vao);
+            sState.mBuffers[ELEMENT_ARRAY_BUFFER_SLOT] = UNKNOWN;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindBuffer(GLenum target, GLuint buffer)
+    {
+        int slot = bufferSlot(target);
+        if (slot < 0)
+        {
+            sStats.mIssued++;
+            glBindBuffer(target, buffer);
+        }
+        else if (changed(&sState.mBuffers[slot], buffer))
+            glBindBuffer(target, buffer);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        ensureInitialized();
+        sStats.mIssued++;
+        glBindBufferRange(target, index, buffer, offset, size);
+
+        int slot = bufferSlot(target);
+        if (slot >= 0)
+            sState.mBuffers[slot] = buffer;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void activeTexture(GLenum unit)
+    {
+        assert(unit - GL_TEXTURE0 < MAX_TEXTURE_UNITS);
+
+        if (changed(&sState.mActiveTexture, unit - GL_TEXTURE0))
+            glActiveTexture(unit);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindTexture(GLenum target, GLuint texture)
+    {
+        ensureInitialized();
+
+        if (target != GL_TEXTURE_2D || sState.mActiveTexture == UNKNOWN)
+        {
+            sStats.mIssued++;
+            glBindTexture(target, texture);
+
+            // the 2D binding of the unit is not touched by other targets
+            return;
+        }
+
+        if (changed(&sState.mTextures2D[sState.mActiveTexture], texture))
+            glBindTexture(target, texture);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindTextureToUnit(GLuint unit, GLenum target, GLuint texture)
+    {
+        activeTexture(GL_TEXTURE0 + unit);
+        bindTexture(target, texture);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void bindFramebuffer(GLenum target, GLuint fbo)
+    {
+        ensureInitialized();
+
+        if (target == GL_FRAMEBUFFER)
+        {
+            if (sState.mDrawFramebuffer == fbo && sState.mReadFramebuffer == fbo)
+            {
+                sStats.mFiltered++;
+                return;
+            }
+            sState.mDrawFramebuffer = fbo;
+            sState.mReadFramebuffer = fbo;
+            sStats.mIssued++;
+            glBindFramebuffer(target, fbo);
+        }
+        else if (target == GL_DRAW_FRAMEBUFFER)
+        {
+            if (changed(&sState.mDrawFramebuffer, fbo))
+                glBindFramebuffer(target, fbo);
+        }
+        else if (changed(&sState.mReadFramebuffer, fbo))
+            glBindFramebuffer(target, fbo);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void systemDrawBuffer(GLenum mode)
+    {
+        assert(sState.mDrawFramebuffer == 0 && "bind the system framebuffer first!");
+
+        if (changed(&sState.mSystemDrawBuffer, mode))
+            glDrawBuffer(mode);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        ensureInitialized();
+
+        GLint *v = sState.mViewport;
+        if (v[0] == x && v[1] == y && v[2] == width && v[3] == height)
+        {
+            sStats.mFiltered++;
+            return;
+        }
+
+        v[0] = x; v[1] = y; v[2] = width; v[3] = height;
+        sStats.mIssued++;
+        glViewport(x, y, width, height);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void getViewport(GLint *outViewport)
+    {
+        ensureInitialized();
+
+        GLint *v = sState.mViewport;
+        if (v[2] < 0)
+            glGetIntegerv(GL_VIEWPORT, v);
+
+        for (int i = 0; i < 4; ++i)
+            outViewport[i] = v[i];
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void setDepthTest(bool enabled)
+    {
+        if (changed(&sState.mDepthTest, enabled ? 1 : 0))
+        {
+            if (enabled)
+                glEnable(GL_DEPTH_TEST);
+            else
+                glDisable(GL_DEPTH_TEST);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void setBlend(bool enabled)
+    {
+        if (changed(&sState.mBlend, enabled ? 1 : 0))
+        {
+            if (enabled)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void blendFunc(GLenum src, GLenum dst)
+    {
+        ensureInitialized();
+
+        if (sState.mBlendSrc == src && sState.mBlendDst == dst)
+        {
+            sStats.mFiltered++;
+            return;
+        }
+
+        sState.mBlendSrc = src;
+        sState.mBlendDst = dst;
+        sStats.mIssued++;
+        glBlendFunc(src, dst);
+    }
+} // namespace glState
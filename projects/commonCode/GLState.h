@@ -0,0 +1,58 @@
+/** @file GLState.h
+*  @brief shadowed OpenGL state, redundant binds and state changes are not sent to the driver
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** all commonCode helpers go through these functions, the app should use them as well.
+*
+* the cache knows only about calls made through glState, so call invalidate()
+* after code that changes the state on its own (AntTweakBar, SOIL) and after
+* deleting objects that might be bound (GL unbinds them and names can be reused)
+*/
+namespace glState
+{
+    /// how many calls were sent to GL and how many were dropped as redundant
+    struct Stats
+    {
+        unsigned int mIssued;
+        unsigned int mFiltered;
+    };
+
+    /// forgets everything, the next call of each kind always goes to GL
+    void invalidate();
+
+    const Stats &stats();
+    void resetStats();
+
+    void useProgram(GLuint program);
+
+    /// GL_ELEMENT_ARRAY_BUFFER is a part of the VAO so it is forgotten when the VAO changes
+    void bindVertexArray(GLuint vao);
+
+    /// array, element array, pixel pack/unpack and uniform buffers are cached, other targets are passed through
+    void bindBuffer(GLenum target, GLuint buffer);
+    /// indexed binding also changes the generic binding of the target
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    void activeTexture(GLenum unit);
+    /// binds to the active unit, only GL_TEXTURE_2D is cached
+    void bindTexture(GLenum target, GLuint texture);
+    /// activeTexture(GL_TEXTURE0 + unit) + bindTexture
+    void bindTextureToUnit(GLuint unit, GLenum target, GLuint texture);
+
+    /// GL_FRAMEBUFFER sets both draw and read bindings
+    void bindFramebuffer(GLenum target, GLuint fbo);
+    /// glDrawBuffer of the system framebuffer, the system framebuffer must be bound
+    void systemDrawBuffer(GLenum mode);
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    /// cached viewport, GL is asked only when the viewport is not known
+    void getViewport(GLint *outViewport);
+
+    void setDepthTest(bool enabled);
+    void setBlend(bool enabled);
+    void blendFunc(GLenum src, GLenum dst);
+} // namespace glState
@@ -0,0 +1,196 @@
+/** @file HeadlessContext.cpp
+*  @brief OpenGL context without a window (EGL), for batch runs on servers
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "Framebuffer.h"
+#include "Texture.h"
+#include "HeadlessContext.h"
+
+#ifdef USE_HEADLESS_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace headless
+{
+    namespace
+    {
+        EGLDisplay  sDisplay = EGL_NO_DISPLAY;
+        EGLContext  sContext = EGL_NO_CONTEXT;
+        FrameBuffer sTarget;
+        GLuint      sColorTex = 0;
+
+        ///////////////////////////////////////////////////////////////////////////////
+        EGLDisplay openDisplay()
+        {
+            // no X, no Wayland, no GBM device: the only thing that works on every headless node
+            const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+            if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless"))
+            {
+                PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+                if (getPlatformDisplay)
+                {
+                    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+                    if (display != EGL_NO_DISPLAY)
+                        return display;
+                }
+            }
+
+            return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool init()
+    {
+        shutdown();
+
+        sDisplay = openDisplay();
+        EGLint major = 0, minor = 0;
+        if (sDisplay == EGL_NO_DISPLAY || eglInitialize(sDisplay, &major, &minor) == EGL_FALSE)
+        {
+            LOG_ERROR("cannot initialize the EGL display!");
+            sDisplay = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        const char *extensions = eglQueryString(sDisplay, EGL_EXTENSIONS);
+        if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL)
+        {
+            LOG_ERROR("EGL %d.%d has no surfaceless contexts!", major, minor);
+            shutdown();
+            return false;
+        }
+
+        if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+        {
+            LOG_ERROR("EGL cannot create desktop OpenGL contexts!");
+            shutdown();
+            return false;
+        }
+
+        // no surface at all (the default asks for a window), everything is drawn into fbos
+        const EGLint configAttribs[] =
+        {
+            EGL_SURFACE_TYPE, 0,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (eglChooseConfig(sDisplay, configAttribs, &config, 1, &configCount) == EGL_FALSE || configCount == 0)
+        {
+            LOG_ERROR("no EGL config for OpenGL!");
+            shutdown();
+            return false;
+        }
+
+        // the same as glutInitContextVersion/Profile in the windowed version
+        const EGLint contextAttribs[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+            EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_NONE
+        };
+        sContext = eglCreateContext(sDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+        if (sContext == EGL_NO_CONTEXT || eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, sContext) == EGL_FALSE)
+        {
+            LOG_ERROR("cannot create OpenGL 4.2 core context (EGL error 0x%x)!", eglGetError());
+            shutdown();
+            return false;
+        }
+
+        LOG("headless EGL %d.%d context created (%s)", major, minor, eglQueryString(sDisplay, EGL_VENDOR));
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool createTarget(GLuint width, GLuint height)
+    {
+        assert(isActive() && "call init first!");
+
+        sColorTex = textureLoader::createEmptyTexture2D(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_CLAMP_TO_EDGE);
+
+        sTarget.createAndBind();
+        sTarget.attachTextureAsColorTarget(0, sColorTex, width, height, GL_TEXTURE_2D);
+        sTarget.createAndAttachDepthRenderbuffer(width, height);
+        sTarget.setDrawBuffers();
+        const bool complete = sTarget.check();
+
+        // everything that draws "to the window" draws here from now on
+        FrameBuffer::setSystemFrameBufferId(complete ? sTarget.getId() : 0);
+        FrameBuffer::bindSystemFrameBuffer(width, height);
+        CHECK_OPENGL_ERRORS();
+
+        if (!complete)
+            LOG_ERROR("cannot create the %dx%d headless target!", width, height);
+
+        return complete;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void shutdown()
+    {
+        if (sContext != EGL_NO_CONTEXT)
+        {
+            FrameBuffer::setSystemFrameBufferId(0);
+            sTarget.destroy();
+            if (sColorTex)
+                glDeleteTextures(1, &sColorTex);
+            sColorTex = 0;
+            glState::invalidate();
+
+            eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(sDisplay, sContext);
+            sContext = EGL_NO_CONTEXT;
+        }
+
+        if (sDisplay != EGL_NO_DISPLAY)
+        {
+            eglTerminate(sDisplay);
+            sDisplay = EGL_NO_DISPLAY;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool isActive()
+    {
+        return sContext != EGL_NO_CONTEXT;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void *getProcAddress(const char *name)
+    {
+        return (void *)eglGetProcAddress(name);
+    }
+} // namespace headless
+
+#else
+
+namespace headless
+{
+    bool init()
+    {
+        LOG_ERROR("built without USE_HEADLESS_EGL!");
+        return false;
+    }
+
+    bool createTarget(GLuint, GLuint) { return false; }
+    void shutdown() { }
+    bool isActive() { return false; }
+    void *getProcAddress(const char *) { return NULL; }
+} // namespace headless
+
+#endif // USE_HEADLESS_EGL
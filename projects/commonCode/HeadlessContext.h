@@ -0,0 +1,30 @@
+/** @file HeadlessContext.h
+*  @brief OpenGL context without a window (EGL), for batch runs on servers
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** windowless GL 4.2 core context, compiled only with USE_HEADLESS_EGL
+*
+* EGL surfaceless display (EGL_MESA_platform_surfaceless, falls back to the default display),
+* so it runs on a GPU without a display server or on Mesa llvmpipe without any GPU.
+* There is no window framebuffer: createTarget makes an fbo (RGBA8 + depth) and sets it as
+* the "system" framebuffer (FrameBuffer::setSystemFrameBufferId), the rest of the code does not see a difference.
+* GL functions are loaded with eglGetProcAddress (needs EGL 1.5 or EGL_KHR_get_all_proc_addresses).
+*
+* without USE_HEADLESS_EGL all the functions fail
+*/
+namespace headless
+{
+    /// creates the context and makes it current, call utils::initGL after it
+    bool init();
+    /// offscreen target of the given size, needs loaded GL functions
+    bool createTarget(GLuint width, GLuint height);
+    void shutdown();
+
+    bool isActive();
+    /// instead of glutGetProcAddress
+    void *getProcAddress(const char *name);
+} // namespace headless
@@ -5,8 +5,13 @@
 */
 
 #include "commonCode.h"
-#include "init.h"
+#include "Init.h"
 #include "Log.h"
+#include "HeadlessContext.h"
+
+#ifdef USE_HEADLESS_EGL
+#include <chrono>
+#endif
 
 
 void APIENTRY DebugFunc(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
@@ -46,6 +51,20 @@ void APIENTRY DebugFunc(GLenum source, GLenum type, GLuint id, GLenum severity,
 		errorType.c_str(), srcName.c_str(), typeSeverity.c_str(), message);
 }
 
+namespace
+{
+    /// miliseconds since the start, like GLUT_ELAPSED_TIME
+    int elapsedTime()
+    {
+#ifdef USE_HEADLESS_EGL
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+#else
+        return glutGet(GLUT_ELAPSED_TIME);
+#endif
+    }
+}
+
 namespace utils
 {
     bool initGL(bool vsync)
@@ -61,6 +80,7 @@ namespace utils
             LOG("OpenGL Loaded, but without %d extensions!", glLoadStatus - ogl_LOAD_SUCCEEDED);
         }
 
+#if defined(WIN32) && !defined(USE_HEADLESS_EGL)
         int wglLoadStatus = wgl_LoadFunctions(::wglGetCurrentDC());
         if (wglLoadStatus == ogl_LOAD_FAILED)
         {
@@ -70,6 +90,7 @@ namespace utils
         {
             LOG("WGL Loaded, but without %d extensions!", wglLoadStatus - wgl_LOAD_SUCCEEDED);
         }
+#endif
 
         if (ogl_ext_ARB_debug_output)
 	    {
@@ -93,14 +114,25 @@ namespace utils
         LOG("GLSL Version:    %s", (char *)glGetString(GL_SHADING_LANGUAGE_VERSION));
         LOG("- - - - - - - - - - - - - - - - - - - - - - - \n");
 
-#ifdef WIN32
+#if defined(WIN32) && !defined(USE_HEADLESS_EGL)
         if (wgl_ext_EXT_swap_control)
             wglSwapIntervalEXT(vsync ? 1 : 0);
+#else
+        (void)vsync; // nothing is presented without a window
 #endif
 
         return true;
     }
 
+    void *getProcAddress(const char *name)
+    {
+#ifdef USE_HEADLESS_EGL
+        return headless::getProcAddress(name);
+#else
+        return (void *)glutGetProcAddress(name);
+#endif
+    }
+
     void calculateFps(float *fps)
     {
         static unsigned int frame = 0;
@@ -108,7 +140,7 @@ namespace utils
 
         frame++;
 
-        int t = glutGet(GLUT_ELAPSED_TIME);
+        int t = elapsedTime();
         if (t - timeBase > 1000) 
         {
             *fps = 0.5f*(*fps) + 0.5f*(frame*1000.0f/(float)(t - timeBase));
@@ -123,7 +155,7 @@ namespace utils
         static double lastDeltas[3] = { 0.0, 0.0, 0.0 };
 
         // in milisec
-        int t = glutGet(GLUT_ELAPSED_TIME);
+        int t = elapsedTime();
         double newTime = (double)t*0.001;
 
         *deltaTime = newTime - *appTime;
@@ -16,6 +16,9 @@ namespace utils
 {
     bool initGL(bool vsync);
 
+    /// extension functions that are not in the generated loader (glut or EGL when headless)
+    void *getProcAddress(const char *name);
+
     void calculateFps(float *fps);
 
     void updateTimer(double *deltaTime, double *appTime, const double MAX_REFRESH_TIME = 1.0/60.0);
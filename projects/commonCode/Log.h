@@ -10,7 +10,8 @@
 //#define UTILS_LOG_WITH_PRINTF
 #define UTILS_LOG_WITH_OUTPUT_DBG_STRING
 
-#ifdef UTILS_LOG_WITH_PRINTF
+// no debugger output outside Windows (the headless build), the console is the log
+#if defined(UTILS_LOG_WITH_PRINTF) || !defined(WIN32)
     #define LOG(msg, ...)         { printf(msg, ##__VA_ARGS__); printf("\n"); }
     #define LOG_SUCCESS(msg, ...) { printf("SUCCESS: "); printf(msg, ##__VA_ARGS__); printf("\n"); }
     #define LOG_ERROR(msg, ...)   { printf("ERR in %s at line %d: ", __FUNCTION__, __LINE__); printf(msg, ##__VA_ARGS__); printf("\n"); }
@@ -0,0 +1,114 @@
+/** @file MappedFile.cpp
+*  @brief read only file mapped into memory
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile() :
+    mData(NULL),
+    mSize(0),
+#ifdef _WIN32
+    mFile(INVALID_HANDLE_VALUE),
+    mMapping(NULL)
+#else
+    mFile(-1)
+#endif
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::open(const char *fileName)
+{
+    assert(fileName);
+
+    close();
+
+#ifdef _WIN32
+    mFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(mFile, &size) == FALSE || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    mSize = (size_t)size.QuadPart;
+
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL)
+    {
+        close();
+        return false;
+    }
+
+    mData = (const unsigned char *)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    mFile = ::open(fileName, O_RDONLY);
+    if (mFile < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(mFile, &st) != 0 || st.st_size == 0)
+    {
+        close();
+        return false;
+    }
+    mSize = (size_t)st.st_size;
+
+    void *data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    mData = data == MAP_FAILED ? NULL : (const unsigned char *)data;
+#endif
+
+    if (mData == NULL)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMapping)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+    mMapping = NULL;
+    mFile    = INVALID_HANDLE_VALUE;
+#else
+    if (mData)
+        munmap((void *)mData, mSize);
+    if (mFile >= 0)
+        ::close(mFile);
+    mFile = -1;
+#endif
+    mData = NULL;
+    mSize = 0;
+}
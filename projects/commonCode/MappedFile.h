@@ -0,0 +1,40 @@
+/** @file MappedFile.h
+*  @brief read only file mapped into memory
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** whole file mapped for reading, pages are loaded by the OS when they are touched
+*
+* used for big binary files (compressed textures) that are only copied to the GPU,
+* there is no intermediate buffer and no fread.
+*/
+class MappedFile
+{
+private:
+    const unsigned char *mData;
+    size_t               mSize;
+#ifdef _WIN32
+    void                *mFile;      //!< HANDLE
+    void                *mMapping;   //!< HANDLE
+#else
+    int                  mFile;
+#endif
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /// @return false when the file does not exist or is empty
+    bool open(const char *fileName);
+    void close();
+
+    bool isOpen() const                 { return mData != NULL; }
+    const unsigned char *data() const   { return mData; }
+    size_t size() const                 { return mSize; }
+private:
+    // block copying:
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+};
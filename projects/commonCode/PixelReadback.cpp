@@ -0,0 +1,191 @@
+/** @file PixelReadback.cpp
+*  @brief asynchronous pixel readback using a ring of pixel pack buffers
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "PixelReadback.h"
+#include "GLState.h"
+
+///////////////////////////////////////////////////////////////////////////////
+PixelReadback::PixelReadback() :
+    mSlotSize(0),
+    mNextSlot(0),
+    mOldestSlot(0),
+    mPendingCount(0),
+    mIsMapped(false)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PixelReadback::~PixelReadback()
+{
+    destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PixelReadback::init(GLuint slotCount, GLsizeiptr slotSize)
+{
+    assert(slotCount > 0 && slotSize > 0);
+
+    destroy();
+
+    mSlots.resize(slotCount);
+    mSlotSize = slotSize;
+
+    for (GLuint i = 0; i < slotCount; ++i)
+    {
+        glGenBuffers(1, &mSlots[i].mBuffer);
+        glState::bindBuffer(GL_PIXEL_PACK_BUFFER, mSlots[i].mBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, slotSize, NULL, GL_STREAM_READ);
+    }
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    CHECK_OPENGL_ERRORS();
+
+    return mSlots[0].mBuffer != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PixelReadback::destroy()
+{
+    if (mIsMapped)
+        unmap();
+
+    for (size_t i = 0; i < mSlots.size(); ++i)
+    {
+        if (mSlots[i].mFence)
+            glDeleteSync(mSlots[i].mFence);
+        if (mSlots[i].mBuffer)
+            glDeleteBuffers(1, &mSlots[i].mBuffer);
+    }
+    mSlots.clear();
+    glState::invalidate();
+
+    mSlotSize     = 0;
+    mNextSlot     = 0;
+    mOldestSlot   = 0;
+    mPendingCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PixelReadback::readPixels(const Region &region, GLenum format, GLenum type)
+{
+    assert(mSlots.size() > 0 && "call init first!");
+
+    if (isFull())
+        return false;
+
+    GLsizeiptr size = (GLsizeiptr)region.mWidth * region.mHeight * bytesPerPixel(format, type);
+    if (size <= 0 || size > mSlotSize)
+    {
+        LOG_ERROR("region %dx%d does not fit into the readback buffer!", region.mWidth, region.mHeight);
+        return false;
+    }
+
+    Slot &slot = mSlots[mNextSlot];
+
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.mBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(region.mX, region.mY, region.mWidth, region.mHeight, format, type, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.mFence   = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.mRegion  = region;
+    slot.mFormat  = format;
+    slot.mType    = type;
+    slot.mPending = true;
+
+    mNextSlot = (mNextSlot + 1) % (GLuint)mSlots.size();
+    mPendingCount++;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const void *PixelReadback::mapOldest(Region *outRegion, GLenum *outFormat, GLenum *outType)
+{
+    assert(!mIsMapped && "unmap the previous data first!");
+
+    if (mPendingCount == 0)
+        return NULL;
+
+    Slot &slot = mSlots[mOldestSlot];
+
+    // do not wait, just check (and flush so that the fence is signaled at some point)
+    GLenum status = glClientWaitSync(slot.mFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return NULL;
+
+    glDeleteSync(slot.mFence);
+    slot.mFence = 0;
+
+    GLsizeiptr size = (GLsizeiptr)slot.mRegion.mWidth * slot.mRegion.mHeight * bytesPerPixel(slot.mFormat, slot.mType);
+
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.mBuffer);
+    const void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (data == NULL)
+    {
+        LOG_ERROR("cannot map the readback buffer!");
+        slot.mPending = false;
+        mOldestSlot = (mOldestSlot + 1) % (GLuint)mSlots.size();
+        mPendingCount--;
+        return NULL;
+    }
+
+    if (outRegion) *outRegion = slot.mRegion;
+    if (outFormat) *outFormat = slot.mFormat;
+    if (outType)   *outType   = slot.mType;
+
+    mIsMapped = true;
+    return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PixelReadback::unmap()
+{
+    assert(mIsMapped);
+
+    Slot &slot = mSlots[mOldestSlot];
+
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.mBuffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.mPending = false;
+    mOldestSlot = (mOldestSlot + 1) % (GLuint)mSlots.size();
+    mPendingCount--;
+    mIsMapped = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLuint PixelReadback::bytesPerPixel(GLenum format, GLenum type)
+{
+    GLuint components = 0;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_DEPTH_COMPONENT: components = 1; break;
+    case GL_RG:              components = 2; break;
+    case GL_RGB:
+    case GL_BGR:             components = 3; break;
+    case GL_RGBA:
+    case GL_BGRA:            components = 4; break;
+    default:                 return 0;
+    }
+
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE:  return components;
+    case GL_HALF_FLOAT:     return components * 2;
+    case GL_FLOAT:          return components * 4;
+    default:                return 0;
+    }
+}
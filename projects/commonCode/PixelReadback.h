@@ -0,0 +1,75 @@
+/** @file PixelReadback.h
+*  @brief asynchronous pixel readback using a ring of pixel pack buffers
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** reads pixels from the current read framebuffer into a ring of PBOs
+*
+* every read is followed by a fence, results are collected a few frames later
+* (when the fence is signaled) so that glReadPixels never stalls the pipeline.
+* When all the buffers are still in flight new reads are rejected, not waited for.
+*/
+class PixelReadback
+{
+public:
+    /// describes one read, tag is any user value (frame number for instance)
+    struct Region
+    {
+        Region() { mX = mY = mWidth = mHeight = 0; mTag = 0; }
+        int mX;
+        int mY;
+        int mWidth;
+        int mHeight;
+        unsigned int mTag;
+    };
+
+private:
+    struct Slot
+    {
+        Slot() { mBuffer = 0; mFence = 0; mFormat = 0; mType = 0; mPending = false; }
+        GLuint mBuffer;
+        GLsync mFence;
+        Region mRegion;
+        GLenum mFormat;
+        GLenum mType;
+        bool   mPending;
+    };
+
+    std::vector<Slot> mSlots;
+    GLsizeiptr mSlotSize;     //!< max size of one read in bytes
+
+    GLuint mNextSlot;         //!< slot that will be used by the next read
+    GLuint mOldestSlot;       //!< the oldest pending read
+    GLuint mPendingCount;
+    bool   mIsMapped;
+public:
+    PixelReadback();
+    ~PixelReadback();
+
+    /// creates the ring, slotSize is the max size (in bytes) of a single read
+    bool init(GLuint slotCount, GLsizeiptr slotSize);
+    void destroy();
+
+    /// issues glReadPixels from the current GL_READ_FRAMEBUFFER into the next free buffer
+    /// @return false when all the buffers are still in flight or the region does not fit
+    bool readPixels(const Region &region, GLenum format, GLenum type);
+
+    /// maps the oldest read if it is finished, returns NULL when there is nothing ready yet
+    /// data is tightly packed (pack alignment = 1), call unmap() when done
+    const void *mapOldest(Region *outRegion, GLenum *outFormat = NULL, GLenum *outType = NULL);
+    void unmap();
+
+    GLuint pendingCount() const { return mPendingCount; }
+    bool isFull() const { return mPendingCount == (GLuint)mSlots.size(); }
+    GLsizeiptr slotSize() const { return mSlotSize; }
+
+    /// @return size of one pixel in bytes, 0 if the combination is not supported
+    static GLuint bytesPerPixel(GLenum format, GLenum type);
+private:
+    // block copying:
+    PixelReadback(const PixelReadback &);
+    PixelReadback & operator=(const PixelReadback &);
+};
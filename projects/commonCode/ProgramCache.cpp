@@ -0,0 +1,206 @@
+/** @file ProgramCache.cpp
+*  @brief linked shader programs stored on disk (glGetProgramBinary/glProgramBinary)
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "Init.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "ProgramCache.h"
+
+namespace programCache
+{
+    namespace
+    {
+        /// "SWPB" - simpleWater program binary
+        const unsigned int FILE_MAGIC   = 0x42505753;
+        const unsigned int FILE_VERSION = 1;
+
+        /// written before the binary
+        struct FileHeader
+        {
+            unsigned int mMagic;
+            unsigned int mVersion;
+            Key          mKey;         //!< also in the file name, checked against collisions of the name
+            unsigned int mFormat;      //!< GLenum from glGetProgramBinary
+            unsigned int mLength;
+        };
+
+        bool        sEnabled = false;
+        std::string sDirectory;
+        Key         sDriverKey = 0;
+
+        ///////////////////////////////////////////////////////////////////////////////
+        std::string fileName(Key key)
+        {
+            char name[32];
+#ifdef _MSC_VER
+            sprintf_s(name, sizeof(name), "%016llx.bin", key);
+#else
+            snprintf(name, sizeof(name), "%016llx.bin", key);
+#endif
+            return sDirectory + "/" + name;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        FILE *openFile(const std::string &name, const char *mode)
+        {
+            FILE *fp = NULL;
+#ifdef _MSC_VER
+            fopen_s(&fp, name.c_str(), mode);
+#else
+            fp = fopen(name.c_str(), mode);
+#endif
+            return fp;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool init(const char *directory)
+    {
+        assert(directory);
+
+        sEnabled = false;
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0)
+        {
+            LOG("program binaries are not supported by the driver, shaders will be always compiled");
+            return false;
+        }
+
+        // fails when the directory already exists, that is fine
+#ifdef _WIN32
+        _mkdir(directory);
+#else
+        mkdir(directory, 0755);
+#endif
+
+        sDirectory = directory;
+        sDriverKey = hashString(0xcbf29ce484222325ULL, (const char *)glGetString(GL_VENDOR));
+        sDriverKey = hashString(sDriverKey, (const char *)glGetString(GL_RENDERER));
+        sDriverKey = hashString(sDriverKey, (const char *)glGetString(GL_VERSION));
+        sEnabled = true;
+
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool isEnabled()
+    {
+        return sEnabled;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    Key hashString(Key seed, const char *str)
+    {
+        Key h = seed;
+        if (str == NULL)
+            return h;
+
+        for (; *str; ++str)
+        {
+            h ^= (unsigned char)*str;
+            h *= 0x100000001b3ULL;
+        }
+
+        // separator, so that "ab" + "c" and "a" + "bc" differ
+        h ^= 0xff;
+        h *= 0x100000001b3ULL;
+        return h;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    Key driverKey()
+    {
+        return sDriverKey;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool load(ShaderProgram *outProg, Key key)
+    {
+        assert(outProg);
+
+        if (!sEnabled)
+            return false;
+
+        FILE *fp = openFile(fileName(key), "rb");
+        if (fp == NULL)
+            return false;
+
+        FileHeader header;
+        std::vector<char> data;
+        bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+                  header.mMagic == FILE_MAGIC && header.mVersion == FILE_VERSION && header.mKey == key && header.mLength > 0;
+        if (ok)
+        {
+            data.resize(header.mLength);
+            ok = fread(&data[0], 1, data.size(), fp) == data.size();
+        }
+        fclose(fp);
+
+        if (!ok)
+        {
+            LOG("cached program %016llx is damaged, it will be rebuilt", key);
+            return false;
+        }
+
+        // drivers reject binaries after an update that did not change the version string
+        if (outProg->loadBinary((GLenum)header.mFormat, &data[0], (GLsizei)data.size()) == false)
+        {
+            LOG("cached program %016llx was rejected by the driver, it will be rebuilt", key);
+            return false;
+        }
+
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool store(const ShaderProgram &prog, Key key)
+    {
+        if (!sEnabled)
+            return false;
+
+        FileHeader header;
+        std::vector<char> data;
+        GLenum format = 0;
+        if (prog.getBinary(&format, &data) == false)
+            return false;
+
+        header.mMagic   = FILE_MAGIC;
+        header.mVersion = FILE_VERSION;
+        header.mKey     = key;
+        header.mFormat  = format;
+        header.mLength  = (unsigned int)data.size();
+
+        const std::string name = fileName(key);
+        FILE *fp = openFile(name, "wb");
+        if (fp == NULL)
+        {
+            LOG_ERROR("cannot write the program cache file %s", name.c_str());
+            return false;
+        }
+
+        bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                  fwrite(&data[0], 1, data.size(), fp) == data.size();
+        fclose(fp);
+
+        if (!ok)
+        {
+            LOG_ERROR("cannot write the program cache file %s", name.c_str());
+            remove(name.c_str());
+        }
+
+        return ok;
+    }
+
+} // namespace programCache
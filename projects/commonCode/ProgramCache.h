@@ -0,0 +1,36 @@
+/** @file ProgramCache.h
+*  @brief linked shader programs stored on disk (glGetProgramBinary/glProgramBinary)
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+class ShaderProgram;
+
+/** persistent cache of program binaries, used by shaderLoader
+*
+* every program is stored in its own file (directory/<key>.bin), the key is a hash of the sources
+* of all stages (with their types) and of the driver (vendor, renderer, version), so any change
+* of a shader or an update of the driver gives a new key. Binaries that the driver rejects
+* are rebuilt from the sources and written again.
+*/
+namespace programCache
+{
+    typedef unsigned long long Key;
+
+    /// enables the cache, call it after the GL context is ready
+    /// @return false when the driver has no binary formats, the cache stays disabled then
+    bool init(const char *directory);
+    bool isEnabled();
+
+    /// FNV-1a, can be chained: hashString(hashString(seed, a), b)
+    Key hashString(Key seed, const char *str);
+    /// hash of the driver strings, use it as the seed of the program's key
+    Key driverKey();
+
+    /// creates the program from the cached binary, false when there is no entry or it was rejected
+    bool load(ShaderProgram *outProg, Key key);
+    /// writes the binary of a linked program (see ShaderProgram::setBinaryRetrievable)
+    bool store(const ShaderProgram &prog, Key key);
+} // namespace programCache
@@ -0,0 +1,53 @@
+/** @file ResolutionScaler.cpp
+*  @brief controller that scales the resolution of a render pass to hold its GPU time budget
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "ResolutionScaler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+ResolutionScaler::ResolutionScaler()
+{
+    mBudget   = 2.0f;
+    mMinScale = 0.25f;
+    mMaxScale = 1.0f;
+    mStep     = 1.0f/16.0f;
+    mHeadroom = 0.8f;
+
+    mScale  = mMaxScale;
+    mTarget = mMaxScale;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ResolutionScaler::setScale(float scale)
+{
+    mTarget = glm::clamp(scale, mMinScale, mMaxScale);
+    mScale  = mTarget;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ResolutionScaler::update(double gpuTime)
+{
+    if (gpuTime <= 0.0 || mBudget <= 0.0f)
+        return false;
+
+    // scale that would give exactly the budget: time ~ scale^2
+    const float ideal = mScale * sqrtf(mBudget / (float)gpuTime);
+
+    if ((float)gpuTime > mBudget)
+        mTarget = ideal;                                    // too slow - go down at once
+    else if ((float)gpuTime < mBudget * mHeadroom)
+        mTarget = mTarget + (ideal - mTarget) * 0.05f;      // headroom - go up slowly
+    mTarget = glm::clamp(mTarget, mMinScale, mMaxScale);
+
+    // quantize, down: floor, up: only after the whole step is reached
+    const float quantized = glm::clamp(floorf(mTarget / mStep) * mStep, mMinScale, mMaxScale);
+    if (quantized == mScale)
+        return false;
+
+    mScale = quantized;
+    return true;
+}
@@ -0,0 +1,39 @@
+/** @file ResolutionScaler.h
+*  @brief controller that scales the resolution of a render pass to hold its GPU time budget
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** picks a resolution scale (of width and height) from the measured GPU time of a pass
+*
+* the cost is assumed to be proportional to the pixel count (scale^2), so the scale jumps
+* towards the budget when the pass is too slow and grows slowly when there is headroom.
+* The scale is quantized (mStep) so that targets are not reallocated every frame.
+*/
+class ResolutionScaler
+{
+private:
+    float mScale;
+    float mTarget;     //!< not quantized, follows the measurements
+public:
+    /// GPU time budget of the pass in miliseconds
+    float mBudget;
+    float mMinScale;
+    float mMaxScale;
+    /// resolution changes in steps of that size, default is 1/16
+    float mStep;
+    /// the scale goes up only when the pass takes less than mBudget * mHeadroom, default is 0.8
+    float mHeadroom;
+public:
+    ResolutionScaler();
+
+    /// @param gpuTime the latest measurement in miliseconds (e.g. AsyncTimerQuery::getTime)
+    /// @return true if the scale has changed
+    bool update(double gpuTime);
+
+    /// quantized scale, from mMinScale to mMaxScale
+    float scale() const { return mScale; }
+    void setScale(float scale);
+};
@@ -10,6 +10,7 @@
 #include "Init.h"
 #include "Log.h"
 #include "Shader.h"
+#include "ShaderSources.h"
 
 
 // helpers:
@@ -32,42 +33,36 @@ Shader::~Shader()
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-bool Shader::loadFromFile(const char *fileName, const char *name)
+bool Shader::loadFromFile(const char *fileName, const char *name, const ShaderDefines *defines)
 {
-    const char *vs = readAllTextFromFile(fileName);
-
-    if (vs == NULL)
+    std::string vs;
+    if (shaderSources::load(fileName, &vs) == false)
     {
         LOG_ERROR("cannot load shader from file %s", logger::fileNameFromPath((char *)fileName));
         return false;
     }
 
-    if (mId > 0) 
-        glDeleteShader(mId);
-
-    mId = glCreateShader(static_cast<GLenum>(mType));
-    glShaderSource(mId, 1, &vs, NULL);    
-
-    free((void *)vs);
-
-    // assign name:
-    if (name == NULL)
-        mName = std::string(logger::fileNameFromPath((char *)fileName));
-    else
-        mName = std::string(name);
+    loadFromSource(vs.c_str(), name == NULL ? logger::fileNameFromPath(fileName) : name, defines);
 
     return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void Shader::loadFromSource(const char *source, const char *name)
+void Shader::loadFromSource(const char *source, const char *name, const ShaderDefines *defines)
 {
     if (mId > 0) 
         glDeleteShader(mId);
 
     mId = glCreateShader(static_cast<GLenum>(mType));
 
-    glShaderSource(mId, 1, &source, NULL); 
+    if (defines != NULL && !defines->empty())
+    {
+        const std::string full = injectDefines(source, *defines);
+        const char *fullSource = full.c_str();
+        glShaderSource(mId, 1, &fullSource, NULL); 
+    }
+    else
+        glShaderSource(mId, 1, &source, NULL); 
 
     // assign name:
     if (name == NULL)
@@ -76,14 +71,60 @@ void Shader::loadFromSource(const char *source, const char *name)
         mName = std::string(name);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+std::string Shader::injectDefines(const char *source, const ShaderDefines &defines)
+{
+    assert(source);
+
+    // #version has to be the first directive, so it is searched only at the beginning of a line
+    const char *version = strstr(source, "#version");
+    while (version != NULL && version != source && version[-1] != '\n')
+        version = strstr(version + 1, "#version");
+
+    if (version == NULL)
+        return defines.toSource() + "#line 1\n" + source;
+
+    const char *afterVersion = strchr(version, '\n');
+    if (afterVersion == NULL)
+        return std::string(source) + "\n" + defines.toSource();
+    afterVersion++;
+
+    int nextLine = 1;
+    for (const char *c = source; c < afterVersion; ++c)
+    {
+        if (*c == '\n')
+            nextLine++;
+    }
+
+    char lineDirective[32];
+#ifdef _MSC_VER
+    sprintf_s(lineDirective, sizeof(lineDirective), "#line %d\n", nextLine);
+#else
+    snprintf(lineDirective, sizeof(lineDirective), "#line %d\n", nextLine);
+#endif
+
+    return std::string(source, afterVersion) + defines.toSource() + lineDirective + afterVersion;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 bool Shader::compile()
+{
+    compileAsync();
+
+    return checkCompileStatus();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Shader::compileAsync()
 {
     assert(mId > 0 && "id is null so the shader source should be loaded first!");
 
     glCompileShader(mId);
+}
 
-    // check:
+///////////////////////////////////////////////////////////////////////////////
+bool Shader::checkCompileStatus()
+{
     int compileStatus = GL_TRUE;
     glGetShaderiv(mId, GL_COMPILE_STATUS, &compileStatus);
 
@@ -143,6 +184,65 @@ void Shader::logShaderInfo()
 //		shaderPtr->compile();
 //}
 
+///////////////////////////////////////////////////////////////////////////////
+void ShaderDefines::set(const char *name, const char *value)
+{
+    assert(name && value);
+
+    Define define(name, value);
+    std::vector<Define>::iterator it = mDefines.begin();
+    while (it != mDefines.end() && it->first < define.first)
+        ++it;
+
+    if (it != mDefines.end() && it->first == define.first)
+        it->second = define.second;
+    else
+        mDefines.insert(it, define);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShaderDefines::set(const char *name, int value)
+{
+    char str[16];
+#ifdef _MSC_VER
+    sprintf_s(str, sizeof(str), "%d", value);
+#else
+    snprintf(str, sizeof(str), "%d", value);
+#endif
+    set(name, str);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShaderDefines::remove(const char *name)
+{
+    for (std::vector<Define>::iterator it = mDefines.begin(); it != mDefines.end(); ++it)
+    {
+        if (it->first == name)
+        {
+            mDefines.erase(it);
+            return;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string ShaderDefines::toSource() const
+{
+    std::string source;
+    for (size_t i = 0; i < mDefines.size(); ++i)
+        source += "#define " + mDefines[i].first + " " + mDefines[i].second + "\n";
+    return source;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string ShaderDefines::key() const
+{
+    std::string key;
+    for (size_t i = 0; i < mDefines.size(); ++i)
+        key += mDefines[i].first + "=" + mDefines[i].second + ";";
+    return key;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // from Lighthouse3D tutorial
 const char *readAllTextFromFile(const char *fname) 
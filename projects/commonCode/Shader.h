@@ -7,15 +7,36 @@
 
 #pragma once
 
+/// preprocessor defines injected after the #version line of the source (see Shader::injectDefines)
+/// the order of set() calls does not matter, the list is kept sorted by name
+class ShaderDefines
+{
+private:
+    typedef std::pair<std::string, std::string> Define;
+    std::vector<Define> mDefines;
+public:
+    void set(const char *name, const char *value = "1");
+    void set(const char *name, int value);
+    void remove(const char *name);
+
+    bool empty() const { return mDefines.empty(); }
+    /// "#define NAME VALUE" lines
+    std::string toSource() const;
+    /// "NAME=VALUE;..." - the same for the same set of defines
+    std::string key() const;
+};
+
 /// manages single shader loading ad compilation
 class Shader
 {
 public:
     enum class Type 
     {
-        VERTEX   = GL_VERTEX_SHADER, 
-        FRAGMENT = GL_FRAGMENT_SHADER, 
-        GEOMETRY = GL_GEOMETRY_SHADER
+        VERTEX          = GL_VERTEX_SHADER, 
+        FRAGMENT        = GL_FRAGMENT_SHADER, 
+        GEOMETRY        = GL_GEOMETRY_SHADER,
+        TESS_CONTROL    = GL_TESS_CONTROL_SHADER,
+        TESS_EVALUATION = GL_TESS_EVALUATION_SHADER
     };
 private:
     GLuint mId;
@@ -30,17 +51,29 @@ public:
     /// if the shader was loaded and generated before then a new id will be created and
     /// the previous one will be destroyed
     /// @param name optional name, if NULL then the path is assigned to its internal name
-    bool loadFromFile(const char *fileName, const char *name = NULL);
+    /// @param defines optional, injected after the #version line
+    bool loadFromFile(const char *fileName, const char *name = NULL, const ShaderDefines *defines = NULL);
 
     /// loads source of the shader and generates its ID
     /// if the shader was loaded and generated before then a new id will be created and
     /// the previous one will be destroyed
     /// @param name optional name, if NULL then the "FROM SOURCE" is assigned to its internal name
-    void loadFromSource(const char *source, const char *name = NULL);
+    /// @param defines optional, injected after the #version line
+    void loadFromSource(const char *source, const char *name = NULL, const ShaderDefines *defines = NULL);
+
+    /// source with the defines after the #version line (or at the beginning when there is none),
+    /// a #line directive follows them so that compile errors point to the lines of the file
+    static std::string injectDefines(const char *source, const ShaderDefines &defines);
 
     /// compiles the shader and checks the compilation status, outputs Error using utLOG_ERROR
     bool compile();
 
+    /// only starts the compilation, asking for the status would wait for the driver,
+    /// use it for many shaders at once and check them later (see shaderLoader::ProgramBatch)
+    void compileAsync();
+    /// waits for the compilation and checks its status, outputs Error using utLOG_ERROR
+    bool checkCompileStatus();
+
     GLuint getId()        const { return mId; }
     const char *getName() const { return mName.c_str(); }
 private:
@@ -10,27 +10,49 @@
 #include "Log.h"
 #include "Shader.h"
 #include "ShaderProgram.h"
-#include "shaderLoader.h"
+#include "ShaderLoader.h"
+#include "ProgramCache.h"
+#include "ShaderSources.h"
+
+// KHR_parallel_shader_compile (the same values as in the ARB version):
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace shaderLoader
 {
     ///////////////////////////////////////////////////////////////////////////////
     bool gPrintFullPathToShaderFile = false;
 
+    namespace
+    {
+        bool sParallelCompile = false;
+    }
+
     ///////////////////////////////////////////////////////////////////////////////
     bool loadAndBuildShaderPairFromFile(ShaderProgram *outProg, const char *vs, const char *fs)
     {
-        assert(outProg != NULL && "create the object for shader first!");
         assert(vs && fs);
 
+        return loadAndBuildShaderProgramFromFiles(outProg, vs, NULL, NULL, NULL, fs);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool loadAndBuildShaderPairFromSource(ShaderProgram *outProg, const char *vsSource, const char *fsSource)
+    {
+        assert(outProg != NULL && "create the object for shader first!");
+        assert(vsSource && fsSource);
+
         Shader *vert = new Shader(Shader::Type::VERTEX);
-        if (vert->loadFromFile(vs) == false || vert->compile() == false)
+        vert->loadFromSource(vsSource);
+        if (vert->compile() == false)
         {
             delete vert;
             return false;
         }
         Shader *frag = new Shader(Shader::Type::FRAGMENT);
-        if (frag->loadFromFile(fs) == false || frag->compile() == false)
+        frag->loadFromSource(fsSource);
+        if (frag->compile() == false)
         {
             delete frag;
             delete vert;
@@ -44,43 +66,284 @@ namespace shaderLoader
             return false;
         }
 
-        LOG_SUCCESS("program %s and %s ready!", logger::fileNameFromPath(vs), logger::fileNameFromPath(fs));
+        LOG_SUCCESS("shader program from SOURCE loaded and built properly!");
 
         return true;
     }
 
     ///////////////////////////////////////////////////////////////////////////////
-    bool loadAndBuildShaderPairFromSource(ShaderProgram *outProg, const char *vsSource, const char *fsSource)
+    bool loadAndBuildShaderProgramFromFiles(ShaderProgram *outProg, const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs,
+                                            const ShaderDefines *defines)
     {
-        assert(outProg != NULL && "create the object for shader first!");
-        assert(vsSource && fsSource);
+        ProgramBatch batch;
+        if (batch.add(outProg, vs, tcs, tes, gs, fs, defines) == false)
+            return false;
 
-        Shader *vert = new Shader(Shader::Type::VERTEX);
-        vert->loadFromSource(vsSource);
-        if (vert->compile() == false)
+        return batch.finish();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool initParallelCompile(GLuint maxThreads)
+    {
+        sParallelCompile = false;
+
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        bool khr = false;
+        bool arb = false;
+        for (GLint i = 0; i < count; ++i)
         {
-            delete vert;
-            return false;
+            const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (ext == NULL)
+                continue;
+
+            khr = khr || strcmp(ext, "GL_KHR_parallel_shader_compile") == 0;
+            arb = arb || strcmp(ext, "GL_ARB_parallel_shader_compile") == 0;
         }
-        Shader *frag = new Shader(Shader::Type::FRAGMENT);
-        frag->loadFromSource(fsSource);
-        if (frag->compile() == false)
+
+        if (!khr && !arb)
         {
-            delete frag;
-            delete vert;
+            LOG("no parallel shader compile extension, programs will be built one by one");
             return false;
         }
+
+        // not in the generated loader, both versions have the same signature and enums
+        typedef void (CODEGEN_FUNCPTR *PFNMAXSHADERCOMPILERTHREADS)(GLuint count);
+        PFNMAXSHADERCOMPILERTHREADS maxShaderCompilerThreads = 
+            (PFNMAXSHADERCOMPILERTHREADS)utils::getProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+        if (maxShaderCompilerThreads)
+            maxShaderCompilerThreads(maxThreads);
+
+        sParallelCompile = true;
+        LOG("parallel shader compile turned on!");
+
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool isParallelCompileEnabled()
+    {
+        return sParallelCompile;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ProgramBatch::ProgramBatch() :
+        mPending(0),
+        mFailed(false)
+    {
+
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool ProgramBatch::add(ShaderProgram *outProg, const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs,
+                           const ShaderDefines *defines)
+    {
+        assert(outProg != NULL && "create the object for shader first!");
+        assert(vs && fs);
+        assert((tcs == NULL) == (tes == NULL) && "tessellation needs both stages!");
+
+        const int STAGE_COUNT = 5;
+        const char *files[STAGE_COUNT] = { vs, tcs, tes, gs, fs };
+        const Shader::Type types[STAGE_COUNT] = { Shader::Type::VERTEX, Shader::Type::TESS_CONTROL, Shader::Type::TESS_EVALUATION,
+                                                  Shader::Type::GEOMETRY, Shader::Type::FRAGMENT };
+
+        Entry entry;
+        entry.mProg = outProg;
+        entry.mName = std::string(logger::fileNameFromPath(vs)) + " ... " + logger::fileNameFromPath(fs);
+        if (defines != NULL && !defines->empty())
+            entry.mName += " [" + defines->key() + "]";
+        entry.mDone = false;
+
+        //
+        // sources (with the defines) are read first, the key of the cached binary is made from them
+        //
+        std::string sources[STAGE_COUNT];
+        entry.mKey = programCache::driverKey();
+        for (int i = 0; i < STAGE_COUNT; ++i)
+        {
+            if (files[i] == NULL)
+                continue;
+
+            std::string text;
+            if (shaderSources::load(files[i], &text) == false)
+            {
+                LOG_ERROR("cannot load shader from file %s", logger::fileNameFromPath(files[i]));
+                mFailed = true;
+                return false;
+            }
+
+            sources[i] = (defines != NULL && !defines->empty()) ? Shader::injectDefines(text.c_str(), *defines) : text;
+
+            entry.mKey = programCache::hashString(entry.mKey + (programCache::Key)types[i], sources[i].c_str());
+        }
+
+        if (programCache::load(outProg, entry.mKey))
+        {
+            LOG_SUCCESS("program %s loaded from the cache!", entry.mName.c_str());
+            return true;
+        }
+
+        //
+        // only submit the work, no status is asked here so the driver does not have to finish it
+        //
         outProg->create();
-        outProg->attachShader(vert);
-        outProg->attachShader(frag);
-        if (outProg->link() == false)
+        for (int i = 0; i < STAGE_COUNT; ++i)
         {
-            return false;
+            if (files[i] == NULL)
+                continue;
+
+            Shader *shader = new Shader(types[i]);
+            shader->loadFromSource(sources[i].c_str(), logger::fileNameFromPath(files[i]));
+            shader->compileAsync();
+            outProg->attachShader(shader);
         }
 
-        LOG_SUCCESS("shader program from SOURCE loaded and built properly!");
+        if (programCache::isEnabled())
+            outProg->setBinaryRetrievable();
+
+        outProg->linkAsync();
+
+        mEntries.push_back(entry);
+        mPending++;
 
         return true;
     }
 
+    ///////////////////////////////////////////////////////////////////////////////
+    bool ProgramBatch::poll()
+    {
+        for (size_t i = 0; i < mEntries.size() && mPending > 0; ++i)
+        {
+            if (mEntries[i].mDone)
+                continue;
+
+            // without the extension there is no way to ask, the status query waits then
+            if (sParallelCompile)
+            {
+                GLint completed = GL_FALSE;
+                glGetProgramiv(mEntries[i].mProg->getId(), GL_COMPLETION_STATUS_KHR, &completed);
+                if (completed == GL_FALSE)
+                    continue;
+            }
+
+            completeEntry(&mEntries[i]);
+        }
+
+        return mPending == 0;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool ProgramBatch::finish()
+    {
+        for (size_t i = 0; i < mEntries.size() && mPending > 0; ++i)
+        {
+            if (!mEntries[i].mDone)
+                completeEntry(&mEntries[i]);
+        }
+
+        return !mFailed;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void ProgramBatch::completeEntry(Entry *entry)
+    {
+        entry->mDone = true;
+        mPending--;
+
+        if (entry->mProg->finishLink() == false)
+        {
+            LOG_ERROR("cannot build program %s", entry->mName.c_str());
+            mFailed = true;
+            return;
+        }
+
+        programCache::store(*entry->mProg, entry->mKey);
+
+        LOG_SUCCESS("program %s ready!", entry->mName.c_str());
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    PermutationCache::PermutationCache()
+    {
+
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    PermutationCache::~PermutationCache()
+    {
+        clear();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void PermutationCache::init(const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs)
+    {
+        assert(vs && fs);
+
+        clear();
+
+        const char *files[STAGE_COUNT] = { vs, tcs, tes, gs, fs };
+        for (int i = 0; i < STAGE_COUNT; ++i)
+            mFiles[i] = files[i] ? files[i] : "";
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ShaderProgram *PermutationCache::prepare(const ShaderDefines &defines, ProgramBatch *batch, bool *outCreated)
+    {
+        assert(batch);
+        assert(!mFiles[0].empty() && "call init first!");
+
+        if (outCreated)
+            *outCreated = false;
+
+        const std::string key = defines.key();
+        std::map<std::string, ShaderProgram *>::iterator it = mPrograms.find(key);
+        if (it != mPrograms.end())
+            return it->second;
+
+        ShaderProgram *prog = new ShaderProgram();
+        if (batch->add(prog, fileOrNull(0), fileOrNull(1), fileOrNull(2), fileOrNull(3), fileOrNull(4), &defines) == false)
+        {
+            delete prog;
+            prog = NULL;
+        }
+
+        // failed variants are remembered too, so they are not built again every frame
+        mPrograms[key] = prog;
+        if (outCreated)
+            *outCreated = prog != NULL;
+
+        return prog;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ShaderProgram *PermutationCache::get(const ShaderDefines &defines, bool *outCreated)
+    {
+        bool created = false;
+        ProgramBatch batch;
+        ShaderProgram *prog = prepare(defines, &batch, &created);
+
+        if (batch.finish() == false)
+        {
+            delete prog;
+            prog = NULL;
+            mPrograms[defines.key()] = NULL;
+            created = false;
+        }
+
+        if (outCreated)
+            *outCreated = created;
+
+        return prog;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void PermutationCache::clear()
+    {
+        for (std::map<std::string, ShaderProgram *>::iterator it = mPrograms.begin(); it != mPrograms.end(); ++it)
+            delete it->second;
+
+        mPrograms.clear();
+    }
+
 } // namespce shaderLoader
\ No newline at end of file
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include "ProgramCache.h"
+
 class Shader;
 class ShaderProgram;
+class ShaderDefines;
 
 namespace shaderLoader
 {
@@ -17,6 +20,95 @@ namespace shaderLoader
 
     bool loadAndBuildShaderPairFromFile(ShaderProgram *outProg, const char *vs, const char *fs);
     bool loadAndBuildShaderPairFromSource(ShaderProgram *outProg, const char *vsSource, const char *fsSource);
+
+    /// builds a program from any set of stages, pass NULL for the stages that are not used
+    /// (vs and fs are required, tcs and tes have to be given together)
+    /// when programCache is initialized the linked binary is reused between runs
+    /// @param defines optional, injected into every stage (see Shader::injectDefines)
+    bool loadAndBuildShaderProgramFromFiles(ShaderProgram *outProg, const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs,
+                                            const ShaderDefines *defines = NULL);
     void disableAllShaders();
 
+    /// turns on KHR_parallel_shader_compile (or the ARB version) when the driver has it,
+    /// ProgramBatch::poll can tell then which programs are ready without waiting
+    /// @param maxThreads driver compiler threads, 0xFFFFFFFF lets the driver decide
+    bool initParallelCompile(GLuint maxThreads = 0xFFFFFFFF);
+    bool isParallelCompileEnabled();
+
+    /** builds many programs at once
+    *
+    * add() only reads the files and submits the shaders and programs to the driver (or takes them
+    * from programCache), no status is asked so the driver can compile everything in parallel.
+    * poll() finishes the programs that are ready and never waits when the parallel compile
+    * extension is on, finish() waits for all of them. A program can be used only after it is finished.
+    */
+    class ProgramBatch
+    {
+    private:
+        struct Entry
+        {
+            ShaderProgram     *mProg;
+            programCache::Key  mKey;
+            std::string        mName;
+            bool               mDone;
+        };
+
+        std::vector<Entry> mEntries;
+        size_t mPending;
+        bool   mFailed;
+    public:
+        ProgramBatch();
+
+        /// the same parameters as loadAndBuildShaderProgramFromFiles, false when a file cannot be read
+        bool add(ShaderProgram *outProg, const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs,
+                 const ShaderDefines *defines = NULL);
+
+        /// @return true when all programs are finished (check failed() then)
+        bool poll();
+        /// waits for all programs, @return false when any of them failed
+        bool finish();
+
+        bool failed() const { return mFailed; }
+        size_t pendingCount() const { return mPending; }
+    private:
+        void completeEntry(Entry *entry);
+    };
+
+    /** variants of one program (the same files, different ShaderDefines), each is built on its first use and kept
+    *
+    * lets a shader compile in only the branches that are needed instead of branching on uniforms,
+    * the programs are owned by the cache, the pointers are valid until clear() or init()
+    */
+    class PermutationCache
+    {
+    private:
+        static const int STAGE_COUNT = 5;
+
+        std::string mFiles[STAGE_COUNT];      //!< vs, tcs, tes, gs, fs, empty when not used
+        std::map<std::string, ShaderProgram *> mPrograms;   //!< key - ShaderDefines::key(), NULL - build failed
+    public:
+        PermutationCache();
+        ~PermutationCache();
+
+        /// the same files as in loadAndBuildShaderProgramFromFiles
+        void init(const char *vs, const char *tcs, const char *tes, const char *gs, const char *fs);
+
+        /// program for the defines, built and finished when it is used for the first time
+        /// @param outCreated true when it was just built, uniforms have to be set then
+        /// @return NULL when the variant cannot be built
+        ShaderProgram *get(const ShaderDefines &defines, bool *outCreated = NULL);
+
+        /// like get, but a new variant is only added to the batch, it can be used after the batch is finished,
+        /// use it to build many variants at once (at startup for instance)
+        ShaderProgram *prepare(const ShaderDefines &defines, ProgramBatch *batch, bool *outCreated = NULL);
+
+        void clear();
+    private:
+        const char *fileOrNull(int stage) const { return mFiles[stage].empty() ? NULL : mFiles[stage].c_str(); }
+
+        // block copying:
+        PermutationCache(const PermutationCache &);
+        PermutationCache & operator=(const PermutationCache &);
+    };
+
 } // namespace shaderLoader
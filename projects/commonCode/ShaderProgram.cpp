@@ -47,23 +47,92 @@ void ShaderProgram::attachShader(Shader *shader)
 
 ///////////////////////////////////////////////////////////////////////////////
 bool ShaderProgram::link()
+{
+    linkAsync();
+
+    return finishLink();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::linkAsync()
 {
     assert(mId > 0 && "create the program id first!");
 
     glLinkProgram(mId);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderProgram::finishLink()
+{
+    assert(mId > 0 && "create the program id first!");
 
     int success = 0;
     glGetProgramiv(mId, GL_LINK_STATUS, &success);
 
     if (success == GL_FALSE) 
     {
+        // compile status was not checked when the shaders were compiled asynchronously
+        for (size_t i = 0; i < mShaders.size(); ++i)
+            mShaders[i]->checkCompileStatus();
+
         logProgramInfo();
         return false;
     }
 
+    collectUniforms();
+
     return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::setBinaryRetrievable()
+{
+    assert(mId > 0 && "create the program id first!");
+
+    glProgramParameteri(mId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderProgram::loadBinary(GLenum format, const void *data, GLsizei length)
+{
+    assert(data && length > 0);
+
+    create();
+    glProgramBinary(mId, format, data, length);
+
+    // rejected binary is not an error, the caller builds the program from sources then
+    int success = 0;
+    glGetProgramiv(mId, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE)
+    {
+        destroy();
+        return false;
+    }
+
+    collectUniforms();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderProgram::getBinary(GLenum *outFormat, std::vector<char> *outData) const
+{
+    assert(outFormat && outData);
+    assert(mId > 0 && "create the program id first!");
+
+    GLint length = 0;
+    glGetProgramiv(mId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    outData->resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(mId, length, &written, outFormat, &(*outData)[0]);
+    outData->resize(written);
+
+    return written > 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 bool ShaderProgram::validate()
 {
@@ -77,6 +146,24 @@ bool ShaderProgram::validate()
     return status == GL_TRUE;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderProgram::uniformBlockBinding(const char *blockName, GLuint binding)
+{
+    assert(mId > 0 && "create the program id first!");
+
+    GLuint index = glGetUniformBlockIndex(mId, blockName);
+    if (index == GL_INVALID_INDEX)
+    {
+#ifdef _DEBUG
+        LOG_ERROR("uniform block %s does not exist!", blockName);
+#endif
+        return false;
+    }
+
+    glUniformBlockBinding(mId, index, binding);
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void ShaderProgram::destroy()
 {
@@ -95,6 +182,7 @@ void ShaderProgram::destroy()
 #endif
 
     mShaders.clear();
+    mUniforms.clear();
 
     if (mId > 0) 
         glDeleteProgram(mId);
@@ -120,6 +208,84 @@ void ShaderProgram::logProgramInfo()
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::collectUniforms()
+{
+    mUniforms.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(mId, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(mId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    if (count <= 0 || maxLength <= 0)
+        return;
+
+    std::vector<char> name(maxLength + 1);
+    mUniforms.reserve(count);
+
+    for (GLint u = 0; u < count; ++u)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(mId, (GLuint)u, maxLength, &length, &size, &type, &name[0]);
+
+        // uniforms from uniform blocks do not have locations
+        GLint location = glGetUniformLocation(mId, &name[0]);
+        if (location == -1)
+            continue;
+
+        UniformEntry entry;
+        entry.mHash     = hashName(&name[0], length);
+        entry.mLocation = location;
+        entry.mName.assign(&name[0], length);
+        mUniforms.push_back(entry);
+
+        // arrays are reported as "name[0]", but can be set also by "name"
+        if (length > 3 && strcmp(&name[length - 3], "[0]") == 0)
+        {
+            entry.mHash = hashName(&name[0], length - 3);
+            entry.mName.resize(length - 3);
+            mUniforms.push_back(entry);
+        }
+    }
+
+    std::sort(mUniforms.begin(), mUniforms.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLint ShaderProgram::findUniformLocation(const char *varName) const
+{
+    UniformEntry key;
+    key.mHash = hashName(varName, strlen(varName));
+
+    std::vector<UniformEntry>::const_iterator it = std::lower_bound(mUniforms.begin(), mUniforms.end(), key);
+    for (; it != mUniforms.end() && it->mHash == key.mHash; ++it)
+    {
+        if (it->mName == varName)
+            return it->mLocation;
+    }
+
+    // other elements of arrays ("name[2]") are not in the table
+    if (strchr(varName, '[') != NULL)
+        return glGetUniformLocation(mId, varName);
+
+    return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned int ShaderProgram::hashName(const char *name, size_t len)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 //void testShaderProgramClass()
 //{
@@ -8,16 +8,43 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include "Log.h"
+#include "GLState.h"
 
 class Shader;
 
+/** location of a uniform, get it once from ShaderProgram::uniformHandle and then
+* use it with the uniform* overloads - no string lookup is done then
+*/
+struct UniformHandle
+{
+    GLint mLocation;
+
+    UniformHandle() : mLocation(-1) { }
+    explicit UniformHandle(GLint location) : mLocation(location) { }
+
+    bool isValid() const { return mLocation != -1; }
+};
+
 /// manages the creation and building process of the glsl shader program
+/// active uniforms are collected after linking so that uniform* calls do not ask GL for locations
 class ShaderProgram
 {
 private:
+    /// one active uniform, the table is sorted by mHash
+    struct UniformEntry
+    {
+        unsigned int mHash;
+        GLint        mLocation;
+        std::string  mName;
+
+        bool operator < (const UniformEntry &other) const { return mHash < other.mHash; }
+    };
+
     GLuint mId;
     std::vector<Shader *> mShaders;
+    std::vector<UniformEntry> mUniforms;
 public:
     /// create shader 
     ShaderProgram();
@@ -31,6 +58,18 @@ public:
     /// links all the program and checks the link status, outputs Error using utLOG_ERROR
     bool link();
 
+    /// only starts linking, the shaders may be still compiling (Shader::compileAsync)
+    void linkAsync();
+    /// waits for linking and checks the status, on failure logs the shaders that did not compile
+    bool finishLink();
+
+    /// asks the driver to keep the binary of the program, call it before link() (see ProgramCache.h)
+    void setBinaryRetrievable();
+    /// creates a new program from the binary returned by getBinary, false when the driver rejects it
+    bool loadBinary(GLenum format, const void *data, GLsizei length);
+    /// binary of the linked program, false when the driver does not give it
+    bool getBinary(GLenum *outFormat, std::vector<char> *outData) const;
+
     /// validated the shader program, note that this can degradate performance, 
     /// so use this in DEBUG mode for instance
     bool validate();
@@ -38,6 +77,12 @@ public:
     inline void  use();
     inline void  disable();
     inline GLint getUniformLocation(const char *varName);
+    /// location of the uniform wrapped in UniformHandle, invalid handle when there is no such uniform
+    inline UniformHandle uniformHandle(const char *varName);
+
+    /// connects the uniform block with the binding point (glBindBufferRange index)
+    /// @return false when there is no such block in the program
+    bool uniformBlockBinding(const char *blockName, GLuint binding);
 
     //
     // some useful glUniform* methods, returns false when no 'varName' found in shader
@@ -62,12 +107,34 @@ public:
     /// sends single 4x4 matrix
     inline bool uniformMatrix4f(const char *varName, float *mat, bool transpose = false);
 
+    //
+    // the same methods that use handles, returns false when the handle is invalid
+    //
+
+    inline bool uniform1i(UniformHandle h, int value);
+    inline bool uniform1f(UniformHandle h, float value);
+    inline bool uniform2f(UniformHandle h, float x, float y);
+    inline bool uniform3f(UniformHandle h, float x, float y, float z);
+    inline bool uniform4f(UniformHandle h, float x, float y, float z, float w);
+    inline bool uniform1fv(UniformHandle h, GLuint count, float *values);
+    inline bool uniform2fv(UniformHandle h, float *values);
+    inline bool uniform3fv(UniformHandle h, float *values);
+    inline bool uniform4fv(UniformHandle h, float *values);
+    inline bool uniformMatrix3f(UniformHandle h, float *mat, bool transpose = false);
+    inline bool uniformMatrix4f(UniformHandle h, float *mat, bool transpose = false);
+
 
     GLuint getId() const { return mId; }	
 private:
     void destroy();
     void logProgramInfo();
 
+    /// fills mUniforms, called after successful linking
+    void collectUniforms();
+    /// searches mUniforms, -1 when there is no such uniform
+    GLint findUniformLocation(const char *varName) const;
+    static unsigned int hashName(const char *name, size_t len);
+
     //
     // block copying:
     //
@@ -81,18 +148,18 @@ private:
 
 inline void ShaderProgram::use()
 {
-    glUseProgram(mId);
+    glState::useProgram(mId);
 }
 
 inline void ShaderProgram::disable()
 {
-    glUseProgram(0);
+    glState::useProgram(0);
 }
 
 inline GLint ShaderProgram::getUniformLocation(const char *varName)
 {
     assert(mId > 0 && "create the program id first!");
-    GLint i = glGetUniformLocation(mId, varName);
+    GLint i = findUniformLocation(varName);
 
     // log msg only in the DEBUG version
 #ifdef _DEBUG
@@ -103,6 +170,10 @@ inline GLint ShaderProgram::getUniformLocation(const char *varName)
     return i;
 }
 
+inline UniformHandle ShaderProgram::uniformHandle(const char *varName)
+{
+    return UniformHandle(getUniformLocation(varName));
+}
 
 //
 // useful uniform*
@@ -206,3 +277,73 @@ inline bool ShaderProgram::uniformMatrix4f(const char *varName, float *mat, bool
     glUniformMatrix4fv(i, 1, transpose, mat);
     return true;
 }
+
+//
+// uniform* with handles
+//
+
+inline bool ShaderProgram::uniform1i(UniformHandle h, int value)
+{
+    glUniform1i(h.mLocation, value);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform1f(UniformHandle h, float value)
+{
+    glUniform1f(h.mLocation, value);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform2f(UniformHandle h, float x, float y)
+{
+    glUniform2f(h.mLocation, x, y);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform3f(UniformHandle h, float x, float y, float z)
+{
+    glUniform3f(h.mLocation, x, y, z);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform4f(UniformHandle h, float x, float y, float z, float w)
+{
+    glUniform4f(h.mLocation, x, y, z, w);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform1fv(UniformHandle h, GLuint count, float *values)
+{
+    glUniform1fv(h.mLocation, count, values);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform2fv(UniformHandle h, float *values)
+{
+    glUniform2fv(h.mLocation, 1, values);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform3fv(UniformHandle h, float *values)
+{
+    glUniform3fv(h.mLocation, 1, values);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniform4fv(UniformHandle h, float *values)
+{
+    glUniform4fv(h.mLocation, 1, values);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniformMatrix3f(UniformHandle h, float *mat, bool transpose)
+{
+    glUniformMatrix3fv(h.mLocation, 1, transpose, mat);
+    return h.isValid();
+}
+
+inline bool ShaderProgram::uniformMatrix4f(UniformHandle h, float *mat, bool transpose)
+{
+    glUniformMatrix4fv(h.mLocation, 1, transpose, mat);
+    return h.isValid();
+}
@@ -0,0 +1,101 @@
+/** @file ShaderSources.cpp
+*  @brief GLSL sources embedded in the executable, with files on disk as a development override
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Log.h"
+#include "ShaderSources.h"
+
+// from Shader.cpp:
+const char *readAllTextFromFile(const char *fname);
+
+namespace shaderSources
+{
+    namespace
+    {
+        std::vector<const EmbeddedShader *> sShaders;
+#ifdef _DEBUG
+        bool sFileOverride = true;
+#else
+        bool sFileOverride = false;
+#endif
+
+        ///////////////////////////////////////////////////////////////////////////////
+        const EmbeddedShader *findEmbedded(const char *path)
+        {
+            for (size_t i = 0; i < sShaders.size(); ++i)
+            {
+                if (strcmp(sShaders[i]->mPath, path) == 0)
+                    return sShaders[i];
+            }
+            return NULL;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void registerEmbedded(const EmbeddedShader *table, size_t count)
+    {
+        assert(table || count == 0);
+
+        for (size_t i = 0; i < count; ++i)
+            sShaders.push_back(&table[i]);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void setFileOverride(bool enabled)
+    {
+        sFileOverride = enabled;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool fileOverride()
+    {
+        return sFileOverride;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool load(const char *path, std::string *outSource)
+    {
+        assert(path && outSource);
+
+        const EmbeddedShader *embedded = findEmbedded(path);
+
+        if (sFileOverride || embedded == NULL)
+        {
+            const char *text = readAllTextFromFile(path);
+            if (text != NULL)
+            {
+                if (embedded != NULL && hashSource(text) != embedded->mHash)
+                    LOG("%s: edited file is used instead of the embedded source", logger::fileNameFromPath(path));
+
+                outSource->assign(text);
+                free((void *)text);
+                return true;
+            }
+        }
+
+        if (embedded == NULL)
+            return false;
+
+        outSource->assign(embedded->mSource);
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    unsigned long long hashSource(const char *source)
+    {
+        assert(source);
+
+        unsigned long long h = 0xcbf29ce484222325ULL;
+        for (; *source; ++source)
+        {
+            h ^= (unsigned char)*source;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+} // namespace shaderSources
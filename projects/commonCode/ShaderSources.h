@@ -0,0 +1,37 @@
+/** @file ShaderSources.h
+*  @brief GLSL sources embedded in the executable, with files on disk as a development override
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/// one entry of a table generated by tools/embedShaders.py
+struct EmbeddedShader
+{
+    const char        *mPath;     //!< the same path the code loads, "shaders/waterUpdate.fs" for instance
+    const char        *mSource;
+    unsigned long long mHash;     //!< shaderSources::hashSource of mSource
+};
+
+/** where Shader::loadFromFile and shaderLoader get the sources from
+*
+* the application registers its generated table at startup, then the sources do not depend
+* on the working directory and no file is opened. With the file override (default in debug builds)
+* a file that exists on disk wins, so shaders can be edited without rebuilding.
+*/
+namespace shaderSources
+{
+    /// the table has to live as long as the application (it is static data of the generated file)
+    void registerEmbedded(const EmbeddedShader *table, size_t count);
+
+    /// when true files on disk are used before the embedded sources
+    void setFileOverride(bool enabled);
+    bool fileOverride();
+
+    /// @return false when there is neither an embedded source nor a file
+    bool load(const char *path, std::string *outSource);
+
+    /// FNV-1a of the text, the same as the generator computes
+    unsigned long long hashSource(const char *source);
+} // namespace shaderSources
@@ -6,9 +6,18 @@
 */
 
 #include "commonCode.h"
-#include "soil.h"
+#include "SOIL.h"
 
 #include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "MappedFile.h"
+
+// core since 4.2, but not in the generated loader
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM       0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
 
 namespace textureLoader
 {
@@ -21,7 +30,7 @@ namespace textureLoader
         if (texId == 0)
             return 0;
 
-        glBindTexture(GL_TEXTURE_2D, texId);
+        glState::bindTexture(GL_TEXTURE_2D, texId);
         CHECK_OPENGL_ERRORS();
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapType);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapType);
@@ -35,6 +44,42 @@ namespace textureLoader
         return texId;
     }
 
+    GLuint mipLevelCount(GLuint w, GLuint h)
+    {
+        GLuint size = w > h ? w : h;
+        GLuint levels = 1;
+        while (size > 1)
+        {
+            size >>= 1;
+            levels++;
+        }
+        return levels;
+    }
+
+    GLuint createEmptyTexture2DMipmaps(GLuint w, GLuint h, GLuint levels, GLenum internalFormat, 
+        GLenum wrapType /*= GL_CLAMP_TO_EDGE*/, GLenum minFiletr /*= GL_LINEAR_MIPMAP_LINEAR*/, GLenum magFilter /*= GL_LINEAR*/)
+    {
+        assert(levels > 0 && levels <= mipLevelCount(w, h));
+
+        GLuint texId;
+        glGenTextures(1, &texId);
+
+        if (texId == 0)
+            return 0;
+
+        glState::bindTexture(GL_TEXTURE_2D, texId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFiletr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, w, h);
+        CHECK_OPENGL_ERRORS();
+
+        return texId;
+    }
+
     GLuint createEmptyCubeMap(GLuint w, GLuint h, GLenum internalFormat, GLenum format, GLenum dataType,
         GLenum wrapType /*= GL_CLAMP_TO_EDGE*/, GLenum minFiletr /*= GL_LINEAR*/, GLenum magFilter /*= GL_LINEAR*/)
     {
@@ -44,7 +89,7 @@ namespace textureLoader
         if (texId == 0)
             return 0;
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texId);
+        glState::bindTexture(GL_TEXTURE_CUBE_MAP, texId);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, wrapType);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, wrapType);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, wrapType);
@@ -58,15 +103,356 @@ namespace textureLoader
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, internalFormat, w, h, 0, format, dataType, NULL);
         glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, internalFormat, w, h, 0, format, dataType, NULL);
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glState::bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
         return texId;
     }
 
     GLuint loadTexture(const char *fileName, bool genMipMaps, bool invertY)
     {
-        return SOIL_load_OGL_texture(fileName, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
+#ifdef NO_SOIL
+        (void)genMipMaps; (void)invertY;
+        LOG_ERROR("cannot load the texture %s: built without SOIL", fileName);
+        return 0;
+#else
+        GLuint texId = SOIL_load_OGL_texture(fileName, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
             (genMipMaps ? SOIL_FLAG_GL_MIPMAPS : 0) | (invertY ? SOIL_FLAG_INVERT_Y : 0));
+
+        // SOIL binds textures on its own
+        glState::invalidate();
+        return texId;
+#endif
+    }
+
+    //
+    // compressed containers
+    //
+
+    namespace
+    {
+        const GLuint MAX_LEVELS = 16;
+
+        /// levels of a compressed image, pointers go into the mapped file
+        struct CompressedImage
+        {
+            GLenum mFormat;
+            GLuint mWidth;
+            GLuint mHeight;
+            GLuint mLevelCount;
+            const unsigned char *mLevelData[MAX_LEVELS];
+            GLsizei              mLevelSize[MAX_LEVELS];
+        };
+
+        ///////////////////////////////////////////////////////////////////////////////
+        unsigned int readU32(const unsigned char *p)
+        {
+            // both containers are little endian, like all the platforms we run on
+            return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        unsigned int fourCC(const char *code)
+        {
+            return readU32((const unsigned char *)code);
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        GLsizei blockSize(GLenum format)
+        {
+            switch (format)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RED_RGTC1:
+            case GL_COMPRESSED_SIGNED_RED_RGTC1:
+                return 8;
+            case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_RG_RGTC2:
+            case GL_COMPRESSED_SIGNED_RG_RGTC2:
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                return 16;
+            }
+            return 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        bool isS3TC(GLenum format)
+        {
+            return (format >= GL_COMPRESSED_RGB_S3TC_DXT1_EXT && format <= GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ||
+                   (format >= GL_COMPRESSED_SRGB_S3TC_DXT1_EXT && format <= GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT);
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        bool hasS3TC()
+        {
+            // BC4/BC5 (RGTC) and BC7 (BPTC) are core, DXT is still an extension
+            static int sSupported = -1;
+            if (sSupported < 0)
+            {
+                GLint count = 0;
+                glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+                sSupported = 0;
+                for (GLint i = 0; i < count && sSupported == 0; ++i)
+                {
+                    const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+                    if (ext && strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0)
+                        sSupported = 1;
+                }
+            }
+            return sSupported == 1;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        GLsizei levelSize(GLenum format, GLuint w, GLuint h)
+        {
+            return (GLsizei)(((w + 3) / 4) * ((h + 3) / 4)) * blockSize(format);
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        GLenum formatFromDXGI(unsigned int dxgi)
+        {
+            switch (dxgi)
+            {
+            case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;          // BC1_UNORM
+            case 72: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;    // BC1_UNORM_SRGB
+            case 74: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;          // BC2_UNORM
+            case 75: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;    // BC2_UNORM_SRGB
+            case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;          // BC3_UNORM
+            case 78: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;    // BC3_UNORM_SRGB
+            case 80: return GL_COMPRESSED_RED_RGTC1;                   // BC4_UNORM
+            case 81: return GL_COMPRESSED_SIGNED_RED_RGTC1;            // BC4_SNORM
+            case 83: return GL_COMPRESSED_RG_RGTC2;                    // BC5_UNORM
+            case 84: return GL_COMPRESSED_SIGNED_RG_RGTC2;             // BC5_SNORM
+            case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;             // BC7_UNORM
+            case 99: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;       // BC7_UNORM_SRGB
+            }
+            return 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        GLenum formatFromFourCC(unsigned int code)
+        {
+            if (code == fourCC("DXT1")) return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            if (code == fourCC("DXT3")) return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            if (code == fourCC("DXT5")) return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            if (code == fourCC("ATI1") || code == fourCC("BC4U")) return GL_COMPRESSED_RED_RGTC1;
+            if (code == fourCC("ATI2") || code == fourCC("BC5U")) return GL_COMPRESSED_RG_RGTC2;
+            return 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        /// fills the levels one after another, starting at data + offset
+        bool collectLevels(const MappedFile &file, size_t offset, GLuint levelCount, CompressedImage *img)
+        {
+            GLuint w = img->mWidth, h = img->mHeight;
+            img->mLevelCount = 0;
+            for (GLuint i = 0; i < levelCount && i < MAX_LEVELS; ++i)
+            {
+                const GLsizei size = levelSize(img->mFormat, w, h);
+                if (offset + size > file.size())
+                    return false;
+
+                img->mLevelData[i] = file.data() + offset;
+                img->mLevelSize[i] = size;
+                img->mLevelCount++;
+                offset += size;
+
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+            return img->mLevelCount > 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        bool parseDds(const MappedFile &file, CompressedImage *img)
+        {
+            // "DDS " + DDS_HEADER (124 bytes), DDS_PIXELFORMAT starts at 72 in the header (76 in the file)
+            const size_t HEADER_SIZE = 4 + 124;
+            const size_t DX10_SIZE   = 20;
+            const unsigned int DDPF_FOURCC = 0x4;
+
+            if (file.size() < HEADER_SIZE)
+                return false;
+
+            const unsigned char *h = file.data() + 4;
+            if (readU32(h) != 124)
+                return false;
+
+            img->mHeight = readU32(h + 8);
+            img->mWidth  = readU32(h + 12);
+            GLuint levelCount = readU32(h + 24);
+            if (levelCount == 0)
+                levelCount = 1;
+
+            const unsigned int pfFlags  = readU32(h + 72 + 4);
+            const unsigned int pfFourCC = readU32(h + 72 + 8);
+            if ((pfFlags & DDPF_FOURCC) == 0)
+            {
+                LOG_ERROR("only compressed DDS files are supported");
+                return false;
+            }
+
+            size_t offset = HEADER_SIZE;
+            if (pfFourCC == fourCC("DX10"))
+            {
+                if (file.size() < HEADER_SIZE + DX10_SIZE)
+                    return false;
+
+                const unsigned char *dx10 = file.data() + HEADER_SIZE;
+                const unsigned int dxgiFormat = readU32(dx10);
+                const unsigned int dimension  = readU32(dx10 + 4);
+                const unsigned int arraySize  = readU32(dx10 + 12);
+                if (dimension != 3 || arraySize > 1)    // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+                {
+                    LOG_ERROR("only single 2D textures are supported");
+                    return false;
+                }
+
+                img->mFormat = formatFromDXGI(dxgiFormat);
+                if (img->mFormat == 0)
+                    LOG_ERROR("DXGI format %u is not supported", dxgiFormat);
+                offset += DX10_SIZE;
+            }
+            else
+            {
+                img->mFormat = formatFromFourCC(pfFourCC);
+                if (img->mFormat == 0)
+                    LOG_ERROR("DDS fourCC %.4s is not supported", (const char *)(h + 72 + 8));
+            }
+
+            return img->mFormat != 0 && collectLevels(file, offset, levelCount, img);
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////
+        bool parseKtx(const MappedFile &file, CompressedImage *img)
+        {
+            static const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+            const size_t HEADER_SIZE = 12 + 13*4;
+
+            if (file.size() < HEADER_SIZE || memcmp(file.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+                return false;
+
+            const unsigned char *h = file.data() + 12;
+            if (readU32(h) != 0x04030201)
+            {
+                LOG_ERROR("big endian KTX files are not supported");
+                return false;
+            }
+
+            const unsigned int glType       = readU32(h + 4);
+            const unsigned int faceCount    = readU32(h + 40);
+            const unsigned int arrayCount   = readU32(h + 36);
+            const unsigned int depth        = readU32(h + 32);
+            const unsigned int keyValueSize = readU32(h + 48);
+
+            img->mFormat = readU32(h + 16);
+            img->mWidth  = readU32(h + 24);
+            img->mHeight = readU32(h + 28);
+            GLuint levelCount = readU32(h + 44);
+            if (levelCount == 0)
+                levelCount = 1;      // "generate mipmaps" is not possible for compressed data
+
+            if (glType != 0 || blockSize(img->mFormat) == 0)
+            {
+                LOG_ERROR("KTX internal format 0x%x is not supported", img->mFormat);
+                return false;
+            }
+            if (faceCount != 1 || arrayCount > 0 || depth > 0)
+            {
+                LOG_ERROR("only single 2D textures are supported");
+                return false;
+            }
+
+            // every level is prefixed with its size and padded to 4 bytes
+            size_t offset = HEADER_SIZE + keyValueSize;
+            GLuint w = img->mWidth, hgt = img->mHeight;
+            img->mLevelCount = 0;
+            for (GLuint i = 0; i < levelCount && i < MAX_LEVELS; ++i)
+            {
+                if (offset + 4 > file.size())
+                    return false;
+                const GLsizei size = (GLsizei)readU32(file.data() + offset);
+                offset += 4;
+                if (size != levelSize(img->mFormat, w, hgt) || offset + size > file.size())
+                    return false;
+
+                img->mLevelData[i] = file.data() + offset;
+                img->mLevelSize[i] = size;
+                img->mLevelCount++;
+                offset += (size + 3) & ~3;
+
+                w   = w > 1 ? w / 2 : 1;
+                hgt = hgt > 1 ? hgt / 2 : 1;
+            }
+            return img->mLevelCount > 0;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    GLuint loadCompressedTexture(const char *fileName, GLenum wrapType /*= GL_REPEAT*/)
+    {
+        assert(fileName);
+
+        MappedFile file;
+        if (file.open(fileName) == false)
+        {
+            LOG("cannot open compressed texture %s", logger::fileNameFromPath(fileName));
+            return 0;
+        }
+
+        CompressedImage img;
+        img.mLevelCount = 0;
+        const bool parsed = file.size() >= 4 && readU32(file.data()) == fourCC("DDS ") ? parseDds(file, &img) : parseKtx(file, &img);
+        if (!parsed || img.mWidth == 0 || img.mHeight == 0)
+        {
+            LOG_ERROR("%s is not a valid DDS/KTX file", logger::fileNameFromPath(fileName));
+            return 0;
+        }
+
+        if (isS3TC(img.mFormat) && !hasS3TC())
+        {
+            LOG_ERROR("%s: S3TC (BC1-BC3) is not supported by the driver", logger::fileNameFromPath(fileName));
+            return 0;
+        }
+
+        GLuint texId;
+        glGenTextures(1, &texId);
+        if (texId == 0)
+            return 0;
+
+        glState::bindTexture(GL_TEXTURE_2D, texId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, img.mLevelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        // the chain may be incomplete (tools often stop at 4x4)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, img.mLevelCount - 1);
+
+        GLuint w = img.mWidth, h = img.mHeight;
+        for (GLuint i = 0; i < img.mLevelCount; ++i)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, img.mFormat, w, h, 0, img.mLevelSize[i], img.mLevelData[i]);
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+
+        if (glGetError() != GL_NO_ERROR)
+        {
+            LOG_ERROR("cannot upload %s", logger::fileNameFromPath(fileName));
+            glState::bindTexture(GL_TEXTURE_2D, 0);
+            glDeleteTextures(1, &texId);
+            glState::invalidate();
+            return 0;
+        }
+
+        LOG_SUCCESS("compressed texture %s loaded (%dx%d, %d levels)", logger::fileNameFromPath(fileName), img.mWidth, img.mHeight, img.mLevelCount);
+        return texId;
     }
 
-} // namespce textureLoader
+} // namespce textureLoader
\ No newline at end of file
@@ -15,10 +15,25 @@ namespace textureLoader
     GLuint createEmptyTexture2D(GLuint w, GLuint h, GLenum internalFormat, GLenum format, GLenum dataType, 
         GLenum wrapType, GLenum minFiletr = GL_LINEAR, GLenum magFilter = GL_LINEAR);
 
+    /// creates immutable texture2D (glTexStorage2D) with the given number of mip levels, 
+    /// levels can be rendered to one by one (FrameBuffer::attachTextureAsColorTarget with a level)
+    GLuint createEmptyTexture2DMipmaps(GLuint w, GLuint h, GLuint levels, GLenum internalFormat, 
+        GLenum wrapType, GLenum minFiletr = GL_LINEAR_MIPMAP_LINEAR, GLenum magFilter = GL_LINEAR);
+
+    /// number of levels in the full mip chain of w x h texture
+    GLuint mipLevelCount(GLuint w, GLuint h);
+
     /// creates empty cube map texture
     GLuint createEmptyCubeMap(GLuint w, GLuint h, GLenum internalFormat, GLenum format, GLenum dataType,
         GLenum wrapType, GLenum minFiletr = GL_LINEAR, GLenum magFilter = GL_LINEAR);
 
     GLuint loadTextureFromFile(const char *fileName, bool genMipMaps);
 
+    /// loads a pre-compressed and pre-mipmapped texture: .dds (legacy or DX10 header) or .ktx (version 1)
+    /// with BC1, BC2, BC3, BC4, BC5 or BC7 data. The file is memory mapped and the levels go 
+    /// straight to glCompressedTexImage2D, no decoding and no mipmap generation at runtime.
+    /// Rows are not flipped (unlike SOIL_FLAG_INVERT_Y), so the images have to be stored bottom-up.
+    /// @return 0 when the file is missing, broken or its format is not supported
+    GLuint loadCompressedTexture(const char *fileName, GLenum wrapType = GL_REPEAT);
+
 } // namespace textureLoader
@@ -0,0 +1,363 @@
+/** @file TextureStreamer.cpp
+*  @brief textures decoded on worker threads and uploaded in small parts every frame
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+#include <algorithm>
+
+#include "Init.h"
+#include "Log.h"
+#include "TextureStreamer.h"
+#include "GLState.h"
+#include "SOIL.h"
+
+namespace
+{
+    const GLsizeiptr BYTES_PER_PIXEL = 4;
+
+    ///////////////////////////////////////////////////////////////////////////////
+    GLsizei mipLevelCount(int width, int height)
+    {
+        GLsizei levels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2)
+            levels++;
+        return levels;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void flipRows(unsigned char *pixels, int width, int height)
+    {
+        const size_t rowSize = (size_t)width * BYTES_PER_PIXEL;
+        std::vector<unsigned char> tmp(rowSize);
+        for (int y = 0; y < height / 2; ++y)
+        {
+            unsigned char *top    = pixels + (size_t)y * rowSize;
+            unsigned char *bottom = pixels + (size_t)(height - 1 - y) * rowSize;
+            memcpy(&tmp[0], top, rowSize);
+            memcpy(top, bottom, rowSize);
+            memcpy(bottom, &tmp[0], rowSize);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// RGBA8, rows from the top, NULL when the file cannot be decoded
+    unsigned char *decodeImage(const char *fileName, int *width, int *height)
+    {
+#ifdef NO_SOIL
+        (void)width; (void)height;
+        LOG_ERROR("cannot load the texture %s: built without SOIL", fileName);
+        return NULL;
+#else
+        int channels = 0;
+        unsigned char *pixels = SOIL_load_image(fileName, width, height, &channels, SOIL_LOAD_RGBA);
+        if (pixels == NULL)
+            LOG_ERROR("cannot load the texture %s: %s", fileName, SOIL_last_result());
+        return pixels;
+#endif
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void freeImage(unsigned char *pixels)
+    {
+#ifdef NO_SOIL
+        (void)pixels;
+#else
+        SOIL_free_image_data(pixels);
+#endif
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureStreamer::TextureStreamer() :
+    mQuit(false),
+    mUploadBuffer(0),
+    mUploadBufferSize(0),
+    mPlaceholder(0),
+    mUploadBudget(2*1024*1024)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureStreamer::~TextureStreamer()
+{
+    shutdown();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TextureStreamer::init(unsigned int workerCount)
+{
+    assert(workerCount > 0);
+
+    shutdown();
+
+    // grey 2x2, the same for all pending requests
+    const unsigned char grey[2*2*4] = { 128, 128, 128, 255,  128, 128, 128, 255,
+                                        128, 128, 128, 255,  128, 128, 128, 255 };
+    glGenTextures(1, &mPlaceholder);
+    glState::bindTexture(GL_TEXTURE_2D, mPlaceholder);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 2, 2);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glState::bindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &mUploadBuffer);
+    CHECK_OPENGL_ERRORS();
+
+    mQuit = false;
+    for (unsigned int i = 0; i < workerCount; ++i)
+        mWorkers.push_back(std::thread(&TextureStreamer::workerLoop, this));
+
+    return mPlaceholder != 0 && mUploadBuffer != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TextureStreamer::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+        mDecodeQueue.clear();
+    }
+    mWakeUp.notify_all();
+
+    for (size_t i = 0; i < mWorkers.size(); ++i)
+        mWorkers[i].join();
+    mWorkers.clear();
+
+    for (size_t i = 0; i < mRequests.size(); ++i)
+    {
+        if (mRequests[i]->mPixels)
+            freeImage(mRequests[i]->mPixels);
+        if (mRequests[i]->mTexture)
+            glDeleteTextures(1, &mRequests[i]->mTexture);
+        delete mRequests[i];
+    }
+    mRequests.clear();
+
+    if (mUploadBuffer)
+    {
+        glDeleteBuffers(1, &mUploadBuffer);
+        mUploadBuffer = 0;
+        mUploadBufferSize = 0;
+    }
+    if (mPlaceholder)
+    {
+        glDeleteTextures(1, &mPlaceholder);
+        mPlaceholder = 0;
+    }
+    glState::invalidate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureStreamer::Handle TextureStreamer::request(const char *fileName, bool repeat, bool mipmaps)
+{
+    assert(fileName);
+    assert(mWorkers.size() > 0 && "call init first!");
+
+    Request *req = new Request();
+    req->mFileName     = fileName;
+    req->mRepeat       = repeat;
+    req->mMipmaps      = mipmaps;
+    req->mPixels       = NULL;
+    req->mWidth        = 0;
+    req->mHeight       = 0;
+    req->mTexture      = 0;
+    req->mUploadedRows = 0;
+    req->mState        = State::QUEUED;
+
+    Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        handle = (Handle)mRequests.size();
+        mRequests.push_back(req);
+        mDecodeQueue.push_back(handle);
+    }
+    mWakeUp.notify_one();
+
+    return handle;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TextureStreamer::update()
+{
+    size_t budget = mUploadBudget;
+
+    // oldest requests first, so that textures become resident one by one
+    for (size_t i = 0; i < mRequests.size() && budget > 0; ++i)
+    {
+        Request *req = mRequests[i];
+
+        State s;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            s = req->mState;
+        }
+
+        if (s == State::DECODED)
+        {
+            if (createTexture(req) == false)
+            {
+                LOG_ERROR("cannot create the texture for %s", req->mFileName.c_str());
+                freeImage(req->mPixels);
+                req->mPixels = NULL;
+
+                std::lock_guard<std::mutex> lock(mMutex);
+                req->mState = State::FAILED;
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            req->mState = s = State::UPLOADING;
+        }
+
+        if (s == State::UPLOADING)
+            uploadRows(req, &budget);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLuint TextureStreamer::texture(Handle handle) const
+{
+    return state(handle) == State::RESIDENT ? mRequests[handle]->mTexture : mPlaceholder;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureStreamer::State TextureStreamer::state(Handle handle) const
+{
+    if (handle >= mRequests.size())
+        return State::FAILED;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRequests[handle]->mState;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+size_t TextureStreamer::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    size_t count = 0;
+    for (size_t i = 0; i < mRequests.size(); ++i)
+    {
+        if (mRequests[i]->mState != State::RESIDENT && mRequests[i]->mState != State::FAILED)
+            count++;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TextureStreamer::workerLoop()
+{
+    for (;;)
+    {
+        Request *req = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mQuit && mDecodeQueue.empty())
+                mWakeUp.wait(lock);
+
+            if (mQuit)
+                return;
+
+            req = mRequests[mDecodeQueue.front()];
+            mDecodeQueue.pop_front();
+        }
+
+        // only this thread touches the request until its state changes
+        int width = 0, height = 0;
+        unsigned char *pixels = decodeImage(req->mFileName.c_str(), &width, &height);
+        if (pixels)
+            flipRows(pixels, width, height);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        req->mPixels = pixels;
+        req->mWidth  = width;
+        req->mHeight = height;
+        req->mState  = pixels ? State::DECODED : State::FAILED;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TextureStreamer::createTexture(Request *req)
+{
+    if (req->mWidth <= 0 || req->mHeight <= 0)
+        return false;
+
+    const GLsizei levels = req->mMipmaps ? mipLevelCount(req->mWidth, req->mHeight) : 1;
+    const GLint wrap = req->mRepeat ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+
+    // immutable storage, only the data is uploaded later
+    glGenTextures(1, &req->mTexture);
+    glState::bindTexture(GL_TEXTURE_2D, req->mTexture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, req->mWidth, req->mHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, req->mMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glState::bindTexture(GL_TEXTURE_2D, 0);
+
+    req->mUploadedRows = 0;
+
+    return req->mTexture != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TextureStreamer::uploadRows(Request *req, size_t *budget)
+{
+    const size_t rowSize = (size_t)req->mWidth * BYTES_PER_PIXEL;
+
+    // at least one row, otherwise a very wide image would never finish
+    int rows = (int)std::min((size_t)(req->mHeight - req->mUploadedRows), std::max(*budget / rowSize, (size_t)1));
+    const GLsizeiptr size = (GLsizeiptr)(rows * rowSize);
+
+    glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadBuffer);
+
+    // orphaning: the driver gives new memory when the previous upload is still in flight
+    if (size > mUploadBufferSize)
+        mUploadBufferSize = size;
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, mUploadBufferSize, NULL, GL_STREAM_DRAW);
+
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst == NULL)
+    {
+        glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        LOG_ERROR("cannot map the texture upload buffer!");
+        *budget = 0;
+        return;
+    }
+    memcpy(dst, req->mPixels + (size_t)req->mUploadedRows * rowSize, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glState::bindTexture(GL_TEXTURE_2D, req->mTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, req->mUploadedRows, req->mWidth, rows, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // SOIL, AntTweakBar and others upload from client memory, they must not see our buffer
+    glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    req->mUploadedRows += rows;
+    *budget = (size_t)size >= *budget ? 0 : *budget - (size_t)size;
+
+    if (req->mUploadedRows >= req->mHeight)
+    {
+        if (req->mMipmaps)
+            glGenerateMipmap(GL_TEXTURE_2D);
+        glState::bindTexture(GL_TEXTURE_2D, 0);
+        CHECK_OPENGL_ERRORS();
+
+        freeImage(req->mPixels);
+        req->mPixels = NULL;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        req->mState = State::RESIDENT;
+    }
+    else
+        glState::bindTexture(GL_TEXTURE_2D, 0);
+}
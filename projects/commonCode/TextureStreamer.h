@@ -0,0 +1,96 @@
+/** @file TextureStreamer.h
+*  @brief textures decoded on worker threads and uploaded in small parts every frame
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+/** loads textures without stalling the main thread
+*
+* request() returns at once, the file is decoded (SOIL) on one of the worker threads.
+* update() - called once per frame on the GL thread - uploads decoded images through a pixel
+* unpack buffer, at most mUploadBudget bytes per frame, so even big images cost only a few
+* rows per frame. Until the whole texture is uploaded texture() returns a small placeholder,
+* so the caller can use the result every frame without checking anything.
+*
+* all textures are RGBA8, flipped so that the first row is at the bottom (like SOIL_FLAG_INVERT_Y)
+*/
+class TextureStreamer
+{
+public:
+    typedef unsigned int Handle;
+    static const Handle INVALID_HANDLE = 0xFFFFFFFF;
+
+    enum class State
+    {
+        QUEUED,      //!< waiting for a worker
+        DECODED,     //!< pixels are in memory, waiting for upload
+        UPLOADING,
+        RESIDENT,
+        FAILED       //!< the placeholder stays
+    };
+private:
+    struct Request
+    {
+        std::string    mFileName;
+        bool           mRepeat;
+        bool           mMipmaps;
+
+        // written by the worker, read by the GL thread after mState is DECODED:
+        unsigned char *mPixels;
+        int            mWidth;
+        int            mHeight;
+
+        GLuint         mTexture;
+        int            mUploadedRows;
+        State          mState;       //!< guarded by mMutex while QUEUED
+    };
+
+    std::vector<Request *>   mRequests;     //!< index = handle
+    std::deque<Handle>       mDecodeQueue;
+    std::vector<std::thread> mWorkers;
+    mutable std::mutex       mMutex;
+    std::condition_variable  mWakeUp;
+    bool                     mQuit;
+
+    GLuint     mUploadBuffer;
+    GLsizeiptr mUploadBufferSize;
+    GLuint     mPlaceholder;
+public:
+    /// bytes uploaded in one update(), default is 2MB
+    size_t mUploadBudget;
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    /// creates the placeholder and starts the workers, call it on the GL thread
+    bool init(unsigned int workerCount = 2);
+    /// stops the workers, deletes all textures
+    void shutdown();
+
+    /// queues the file, never waits
+    Handle request(const char *fileName, bool repeat = true, bool mipmaps = true);
+
+    /// uploads the next part of decoded images, call it once per frame on the GL thread
+    void update();
+
+    /// GL texture of the request, the placeholder until it is resident
+    GLuint texture(Handle handle) const;
+    State state(Handle handle) const;
+    /// requests that are not resident (or failed) yet
+    size_t pendingCount() const;
+private:
+    void workerLoop();
+    bool createTexture(Request *req);
+    void uploadRows(Request *req, size_t *budget);
+
+    // block copying:
+    TextureStreamer(const TextureStreamer &);
+    TextureStreamer & operator=(const TextureStreamer &);
+};
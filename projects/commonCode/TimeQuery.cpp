@@ -66,4 +66,102 @@ void TimerQuery::deleteQuery()
     if (mQuery > 0) 
         glDeleteQueries(1, &mQuery); 
     mQuery = 0; 
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncTimerQuery
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+AsyncTimerQuery::AsyncTimerQuery() :
+    mHead(0),
+    mPending(0),
+    mStarted(false),
+    mTime(0.0),
+    mHasResult(false)
+{
+    for (GLuint i = 0; i < RING_SIZE; ++i)
+        mQueries[i] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+AsyncTimerQuery::~AsyncTimerQuery()
+{
+    deleteQueries();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AsyncTimerQuery::init()
+{
+    deleteQueries();
+    glGenQueries(RING_SIZE, mQueries);
+
+    mHead = 0;
+    mPending = 0;
+    mStarted = false;
+    mTime = 0.0;
+    mHasResult = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AsyncTimerQuery::begin()
+{
+    assert(mQueries[0] > 0 && "call init first!");
+    assert(!mStarted);
+
+    if (mPending == RING_SIZE)
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[mHead]);
+    mStarted = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AsyncTimerQuery::end()
+{
+    if (!mStarted)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    mStarted = false;
+
+    mHead = (mHead + 1) % RING_SIZE;
+    mPending++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool AsyncTimerQuery::poll()
+{
+    bool newResult = false;
+
+    while (mPending > 0)
+    {
+        const GLuint oldest = (mHead + RING_SIZE - mPending) % RING_SIZE;
+
+        GLint available = 0;
+        glGetQueryObjectiv(mQueries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 t;
+        glGetQueryObjectui64v(mQueries[oldest], GL_QUERY_RESULT, &t);
+        mPending--;
+
+        const double msec = (double)t/1000000.0;
+        mTime = mHasResult ? 0.8*mTime + 0.2*msec : msec;
+        mHasResult = true;
+        newResult = true;
+    }
+
+    return newResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AsyncTimerQuery::deleteQueries()
+{
+    if (mQueries[0] > 0)
+        glDeleteQueries(RING_SIZE, mQueries);
+
+    for (GLuint i = 0; i < RING_SIZE; ++i)
+        mQueries[i] = 0;
+}
@@ -5,6 +5,7 @@
 *	@date May 2012
 */
 
+#pragma once
 
 /** simple wrapper for the GL_TIME_QUERY from OpenGL */
 class TimerQuery
@@ -50,6 +51,47 @@ private:
     void deleteQuery();
 };
 
+/** GL_TIME_ELAPSED queries in a ring, results are collected a few frames later
+* without waiting for the GPU, so it can be used every frame (e.g. to drive quality settings)
+*
+* usage: begin(), end(), then poll() once per frame
+*/
+class AsyncTimerQuery
+{
+public:
+    static const GLuint RING_SIZE = 4;
+private:
+    GLuint mQueries[RING_SIZE];
+    GLuint mHead;       //!< next query to begin
+    GLuint mPending;    //!< queries that ended but were not read yet
+    bool   mStarted;
+    double mTime;       //!< the latest result in miliseconds, smoothed
+    bool   mHasResult;
+public:
+    AsyncTimerQuery();
+    ~AsyncTimerQuery();
+
+    void init();
+
+    /// does nothing when all queries are still in flight, the measurement is skipped then
+    void begin();
+    void end();
+
+    /// reads all finished queries, never waits
+    /// @return true if there was a new result
+    bool poll();
+
+    bool   hasResult() const { return mHasResult; }
+    /// exponential average of the results, in miliseconds
+    double getTime() const { return mTime; }
+private:
+    void deleteQueries();
+
+    // block copying:
+    AsyncTimerQuery(const AsyncTimerQuery &);
+    AsyncTimerQuery & operator=(const AsyncTimerQuery &);
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // inline:
 
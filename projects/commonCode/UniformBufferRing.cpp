@@ -0,0 +1,148 @@
+/** @file UniformBufferRing.cpp
+*  @brief ring of uniform buffer ranges for per frame/per draw constants
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "commonCode.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "UniformBufferRing.h"
+#include "GLState.h"
+
+///////////////////////////////////////////////////////////////////////////////
+UniformBufferRing::UniformBufferRing() :
+    mBuffer(0),
+    mPartSize(0),
+    mAlignment(256),
+    mCurrentPart(0),
+    mOffset(0),
+    mInFrame(false)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UniformBufferRing::~UniformBufferRing()
+{
+    destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool UniformBufferRing::init(GLuint blocksPerFrame, GLsizeiptr maxBlockSize, GLuint partCount)
+{
+    assert(blocksPerFrame > 0 && maxBlockSize > 0 && partCount > 0);
+
+    destroy();
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mAlignment);
+    if (mAlignment <= 0)
+        mAlignment = 256;
+
+    // every block starts at an aligned offset
+    mPartSize = blocksPerFrame * alignSize(maxBlockSize);
+    mFences.assign(partCount, (GLsync)0);
+    mCurrentPart = partCount - 1;   // the first beginFrame moves to 0
+    mOffset = 0;
+
+    glGenBuffers(1, &mBuffer);
+    glState::bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, mPartSize * partCount, NULL, GL_STREAM_DRAW);
+    glState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECK_OPENGL_ERRORS();
+
+    return mBuffer != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UniformBufferRing::destroy()
+{
+    for (size_t i = 0; i < mFences.size(); ++i)
+    {
+        if (mFences[i])
+            glDeleteSync(mFences[i]);
+    }
+    mFences.clear();
+
+    if (mBuffer)
+    {
+        glDeleteBuffers(1, &mBuffer);
+        glState::invalidate();
+    }
+    mBuffer = 0;
+    mPartSize = 0;
+    mInFrame = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UniformBufferRing::beginFrame()
+{
+    assert(mBuffer > 0 && "call init first!");
+
+    if (mInFrame)
+        endFrame();
+
+    mCurrentPart = (mCurrentPart + 1) % (GLuint)mFences.size();
+    mOffset = 0;
+    mInFrame = true;
+
+    // with enough parts this fence is signaled long ago
+    GLsync &fence = mFences[mCurrentPart];
+    if (fence)
+    {
+        const GLuint64 ONE_SECOND = 1000000000;
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, ONE_SECOND);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+            LOG_ERROR("uniform buffer ring: waiting for the GPU failed!");
+
+        glDeleteSync(fence);
+        fence = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UniformBufferRing::endFrame()
+{
+    if (!mInFrame)
+        return;
+
+    GLsync &fence = mFences[mCurrentPart];
+    if (fence)
+        glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    mInFrame = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool UniformBufferRing::upload(GLuint binding, const void *data, GLsizeiptr size)
+{
+    assert(mInFrame && "call beginFrame first!");
+
+    if (mOffset + size > mPartSize)
+    {
+        LOG_ERROR("uniform buffer ring: part is full, %d bytes do not fit", (int)size);
+        return false;
+    }
+
+    const GLintptr start = mCurrentPart * mPartSize + mOffset;
+
+    glState::bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    void *ptr = glMapBufferRange(GL_UNIFORM_BUFFER, start, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (ptr == NULL)
+    {
+        LOG_ERROR("uniform buffer ring: cannot map the buffer!");
+        glState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+        return false;
+    }
+
+    memcpy(ptr, data, size);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glState::bindBufferRange(GL_UNIFORM_BUFFER, binding, mBuffer, start, size);
+
+    mOffset += alignSize(size);
+    return true;
+}
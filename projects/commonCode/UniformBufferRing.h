@@ -0,0 +1,55 @@
+/** @file UniformBufferRing.h
+*  @brief ring of uniform buffer ranges for per frame/per draw constants
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** one uniform buffer split into several parts, each part holds blocks of one frame
+*
+* blocks are written with unsynchronized mapping and bound with glBindBufferRange,
+* the part is reused only when the fence placed after its frame is signaled.
+* GL 4.2 has no persistent mapping (ARB_buffer_storage), so every upload is a short
+* glMapBufferRange/glUnmapBuffer pair that never waits for the GPU.
+*
+* usage: beginFrame(), upload() as many blocks as needed, draw, endFrame()
+*/
+class UniformBufferRing
+{
+private:
+    GLuint     mBuffer;
+    GLsizeiptr mPartSize;
+    GLint      mAlignment;      //!< GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::vector<GLsync> mFences;
+
+    GLuint     mCurrentPart;
+    GLsizeiptr mOffset;         //!< inside the current part
+    bool       mInFrame;
+public:
+    UniformBufferRing();
+    ~UniformBufferRing();
+
+    /// @param blocksPerFrame how many blocks are uploaded between beginFrame and endFrame
+    /// @param maxBlockSize size of the biggest block in bytes
+    /// @param partCount how many frames can be in flight
+    bool init(GLuint blocksPerFrame, GLsizeiptr maxBlockSize, GLuint partCount = 3);
+    void destroy();
+
+    /// moves to the next part, waits (only if needed) until the GPU is done with it
+    void beginFrame();
+    /// places a fence after the draws that use the current part
+    void endFrame();
+
+    /// copies the block and binds it to the binding point
+    /// @return false when the current part is full
+    bool upload(GLuint binding, const void *data, GLsizeiptr size);
+
+    GLuint bufferName() const { return mBuffer; }
+private:
+    GLsizeiptr alignSize(GLsizeiptr size) const { return (size + mAlignment - 1) / mAlignment * mAlignment; }
+
+    // block copying:
+    UniformBufferRing(const UniformBufferRing &);
+    UniformBufferRing & operator=(const UniformBufferRing &);
+};
@@ -16,9 +16,13 @@
 #include <string>
 
 #include "gl_core_4_2.h"
-#include "wgl_wgl.h"
 
+// no window system in the headless build (see HeadlessContext.h)
+#ifndef USE_HEADLESS_EGL
+#include "wgl_wgl.h"
 #include "freeglut.h"
+#endif
+
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
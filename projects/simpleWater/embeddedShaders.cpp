@@ -0,0 +1,1021 @@
+/** @file embeddedShaders.cpp
+*  @brief GLSL sources embedded in the executable
+*
+*  GENERATED by tools/embedShaders.py in the pre-build step, do not edit
+*/
+
+#include "stdafx.h"
+
+#include "ShaderSources.h"
+
+namespace
+{
+    // buoyancyForces.fs
+    const char SOURCE_0[] =
+        "// buoyancyForces.fs\n"
+        "// fragment shader that outputs force of one body sample, results are summed with additive blending\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// input: force or torque of the sample\n"
+        "flat in vec4 vForce;\n"
+        "\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tvFragColor = vForce;\n"
+        "}\n";
+
+    // buoyancyForces.vs
+    const char SOURCE_1[] =
+        "// buoyancyForces.vs\n"
+        "// vertex shader that calculates buoyancy force (and torque) of a single body sample point,\n"
+        "// the point is then moved to the texel of its body and accumulated there with additive blending\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// water height map values (R - height)\n"
+        "uniform sampler2D texture0;\n"
+        "// xy - offset to the neighbours (offset scale / size of the water), z - normal scale\n"
+        "// the same as in waterUpdateNormals.fs, so the normal map pass is not needed\n"
+        "uniform vec3 normalParams;\n"
+        "\n"
+        "// xy - min corner of the water on the XZ plane, zw - 1/size of the water\n"
+        "uniform vec4 worldRect;\n"
+        "// x - water level, y - world units per unit of water height, z - fluid density * gravity\n"
+        "uniform vec3 waterParams;\n"
+        "// number of bodies = width of the output texture\n"
+        "uniform float bodyCount;\n"
+        "\n"
+        "// attrib: sample position in world space + area that the sample represents\n"
+        "layout(location = 0) in vec4 vPositionArea;\n"
+        "// attrib: sample position relative to the center of mass of its body + body index\n"
+        "layout(location = 1) in vec4 vArmBody;\n"
+        "\n"
+        "// output: force (or torque for the second instance), w - submerged area\n"
+        "flat out vec4 vForce;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tvec2 uv = (vPositionArea.xz - worldRect.xy) * worldRect.zw;\n"
+        "\n"
+        "\tfloat waterY = waterParams.x + texture(texture0, uv).r * waterParams.y;\n"
+        "\tfloat depth  = waterY - vPositionArea.y;\n"
+        "\n"
+        "\tif (depth <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))\n"
+        "\t{\n"
+        "\t\t// not in the water: put the point outside the viewport so that nothing is blended\n"
+        "\t\tvForce      = vec4(0.0);\n"
+        "\t\tgl_Position = vec4(2.0, 2.0, 0.0, 1.0);\n"
+        "\t\treturn;\n"
+        "\t}\n"
+        "\n"
+        "\t// normal from four neighbours (dh/dx, -dh/dz, scale), converted into world space (Y up)\n"
+        "\tfloat yn = texture(texture0, uv + vec2(0.0, normalParams.y)).r;\n"
+        "\tfloat yw = texture(texture0, uv + vec2(normalParams.x, 0.0)).r;\n"
+        "\tfloat ys = texture(texture0, uv - vec2(0.0, normalParams.y)).r;\n"
+        "\tfloat ye = texture(texture0, uv - vec2(normalParams.x, 0.0)).r;\n"
+        "\tvec3 n = vec3(yw - ye, ys - yn, normalParams.z);\n"
+        "\tvec3 normal = normalize(vec3(-n.x, n.z, n.y));\n"
+        "\n"
+        "\tvec3 force = normal * (waterParams.z * vPositionArea.w * depth);\n"
+        "\n"
+        "\t// instance 0 - force, instance 1 - torque\n"
+        "\tvForce = gl_InstanceID == 0 \? vec4(force, vPositionArea.w) : vec4(cross(vArmBody.xyz, force), 0.0);\n"
+        "\n"
+        "\t// one texel per body, row selected by the instance\n"
+        "\tgl_Position = vec4((vArmBody.w + 0.5) / bodyCount * 2.0 - 1.0, gl_InstanceID == 0 \? -0.5 : 0.5, 0.0, 1.0);\n"
+        "}\n";
+
+    // environment.fs
+    const char SOURCE_2[] =
+        "#version 330\n"
+        "\n"
+        "uniform sampler2D texture0;\n"
+        "\n"
+        "in vec3 vNormalVS;\n"
+        "in vec3 vToLightVS;\n"
+        "in vec2 vTexCoord;\n"
+        "\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\t// no culling, back faces get the same light\n"
+        "\tfloat diffuse = abs(dot(normalize(vNormalVS), normalize(vToLightVS)));\n"
+        "\n"
+        "\tvec3 tex = texture(texture0, vTexCoord).rgb;\n"
+        "\tvFragColor = vec4(tex * (0.2 + 0.8*diffuse), 1.0);\n"
+        "}\n";
+
+    // environment.vs
+    const char SOURCE_3[] =
+        "#version 330\n"
+        "\n"
+        "// environment around the water, lit from the camera, clipped by a world space plane\n"
+        "// (reflection pass keeps what is above the water, refraction pass what is below)\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "// world space plane, points with dot(plane, pos) < 0 are clipped\n"
+        "uniform vec4 clipPlane;\n"
+        "\n"
+        "layout(location = 0) in vec3 vVertex; \n"
+        "layout(location = 1) in vec3 vNormal; \n"
+        "layout(location = 2) in vec2 vTexCoord0;\n"
+        "\n"
+        "out vec3 vNormalVS;\n"
+        "out vec3 vToLightVS;\n"
+        "out vec2 vTexCoord;\n"
+        "\n"
+        "out float gl_ClipDistance[1];\n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "\tvec4 posVS = modelviewMatrix * vec4(vVertex, 1.0);\n"
+        "\n"
+        "\tvNormalVS  = normalMatrix * vNormal;\n"
+        "\tvToLightVS = lightPos.xyz - posVS.xyz;\n"
+        "\tvTexCoord  = vTexCoord0;\n"
+        "\n"
+        "\tgl_ClipDistance[0] = dot(clipPlane, vec4(vVertex, 1.0));\n"
+        "\tgl_Position = projectionMatrix * posVS;\n"
+        "}\n";
+
+    // projectedGrid.vs
+    const char SOURCE_4[] =
+        "#version 330\n"
+        "\n"
+        "// projected grid: vertices of a regular screen space grid are moved to the point\n"
+        "// where their view ray hits the water plane, then displaced by the (tiled) water height.\n"
+        "// Output is the same as in renderSurface.vs so that renderSurface.fs can be used\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "// parameters of the rendered surface, see uniformBlocks.h\n"
+        "layout(std140) uniform SurfaceParams\n"
+        "{\n"
+        "\tvec4  waterColor;\n"
+        "\tfloat refractionFactor;\n"
+        "\tfloat heightScale;\n"
+        "\tfloat tessEdgePixels;\n"
+        "\tint   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map\n"
+        "\tvec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale\n"
+        "\tint   planarTargets;    // 1 - reflection and refraction come from the planar targets\n"
+        "};\n"
+        "\n"
+        "// NDC rectangle covered by the grid: min x, max x, min y, max y\n"
+        "uniform vec4 gridRange;\n"
+        "// x - water level, y - max distance from the eye, z - tiles of the water texture per world unit\n"
+        "uniform vec3 gridPlane;\n"
+        "\n"
+        "// water data: R - height, G - velocity\n"
+        "uniform sampler2D heightMap;\n"
+        "\n"
+        "layout(location = 0) in vec2 vGridPos;   // from 0 to 1 in both directions\n"
+        "\n"
+        "out Vertex\n"
+        "{\n"
+        "\tvec3 vPosTS;\t\t// vertex position in Tangent Space\n"
+        "\tvec3 vEyePosTS;\t\t// eye pos in Tangent Space\n"
+        "\tvec3 vLightPosTS;   // light pos in Tangent Space\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexOut;\n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "\tfloat waterLevel  = gridPlane.x;\n"
+        "\tfloat maxDistance = gridPlane.y;\n"
+        "\n"
+        "\t//\n"
+        "\t// view ray of the grid vertex\n"
+        "\t//\n"
+        "\tvec2 ndc = vec2(mix(gridRange.x, gridRange.y, vGridPos.x), mix(gridRange.z, gridRange.w, vGridPos.y));\n"
+        "\tvec4 nearPos = invViewProjection * vec4(ndc, -1.0, 1.0);\n"
+        "\tvec4 farPos  = invViewProjection * vec4(ndc,  1.0, 1.0);\n"
+        "\tvec3 origin  = nearPos.xyz / nearPos.w;\n"
+        "\tvec3 dir     = farPos.xyz / farPos.w - origin;\n"
+        "\n"
+        "\t//\n"
+        "\t// intersection with the plane, rays that miss it (above the horizon) or hit it too far\n"
+        "\t// are clamped to maxDistance so that the grid ends at the horizon\n"
+        "\t//\n"
+        "\tvec2 flatDir = length(dir.xz) > 0.0 \? normalize(dir.xz) : vec2(0.0, 1.0);\n"
+        "\tvec3 pos     = vec3(origin.x + flatDir.x*maxDistance, waterLevel, origin.z + flatDir.y*maxDistance);\n"
+        "\tif (dir.y < 0.0)\n"
+        "\t{\n"
+        "\t\tfloat t = (waterLevel - origin.y) / dir.y;\n"
+        "\t\tvec3 hit = origin + dir*t;\n"
+        "\t\tif (t > 0.0 && distance(hit.xz, origin.xz) < maxDistance)\n"
+        "\t\t\tpos = hit;\n"
+        "\t}\n"
+        "\n"
+        "\t//\n"
+        "\t// displacement, faded out in the distance where one grid cell covers many texels\n"
+        "\t//\n"
+        "\tvec2 tex = pos.xz * 0.5 * gridPlane.z + 0.5;\n"
+        "\tfloat fade = 1.0 - smoothstep(0.25*maxDistance, maxDistance, distance(pos.xz, origin.xz));\n"
+        "\tpos.y += textureLod(heightMap, tex, 0.0).r * heightScale * fade;\n"
+        "\n"
+        "\tvertexOut.vTexCoord0 = tex;\n"
+        "\n"
+        "\tvec4 posVS = modelviewMatrix * vec4(pos, 1.0);\n"
+        "\n"
+        "\t//\n"
+        "\t// tangent frame of the flat surface, details come from the normal map\n"
+        "\t//\n"
+        "\tvec3 T = normalize(normalMatrix * vec3(1.0, 0.0, 0.0));\n"
+        "\tvec3 N = normalize(normalMatrix * vec3(0.0, 1.0, 0.0));\n"
+        "\tvec3 B = -normalize(cross(N, T));\n"
+        "\tmat3 TBN = mat3(T, B, N);\n"
+        "\n"
+        "\tvertexOut.vPosTS      = posVS.xyz * TBN;\n"
+        "\tvertexOut.vEyePosTS   = vec3(0.0) * TBN;\n"
+        "\tvertexOut.vLightPosTS = lightPos.xyz * TBN;\n"
+        "\n"
+        "\tgl_Position = projectionMatrix * posVS;\n"
+        "}\n";
+
+    // renderSurface.fs
+    const char SOURCE_5[] =
+        "#version 400\n"
+        "\n"
+        "in Vertex\n"
+        "{\n"
+        "\tvec3 vPosTS;\t\t// vertex position in Tangent Space\n"
+        "\tvec3 vEyePosTS;\t\t// eye pos in Tangent Space\n"
+        "\tvec3 vLightPosTS;   // light pos in Tangent Space\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexIn;\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "// parameters of the rendered surface, see uniformBlocks.h\n"
+        "layout(std140) uniform SurfaceParams\n"
+        "{\n"
+        "\tvec4  waterColor;\n"
+        "\tfloat refractionFactor;\n"
+        "\tfloat heightScale;\n"
+        "\tfloat tessEdgePixels;\n"
+        "\tint   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map\n"
+        "\tvec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale\n"
+        "\tint   planarTargets;    // 1 - reflection and refraction come from the planar targets\n"
+        "};\n"
+        "\n"
+        "uniform sampler2D texture0;\n"
+        "uniform sampler2D normalMap;\n"
+        "// water data (R - height), used instead of normalMap when fusedNormals is set\n"
+        "uniform sampler2D heightMap;\n"
+        "// planar targets, sampled at the screen position\n"
+        "uniform sampler2D reflectionMap;\n"
+        "uniform sampler2D refractionMap;\n"
+        "\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "const float SHININESS = 64.0;\n"
+        "\n"
+        "// normal from the gradient of the bilinear patch around uv, one gather instead of four taps.\n"
+        "// The scale is the same as in waterUpdateNormals.fs: its central difference spans 2*offset texels\n"
+        "vec3 normalFromHeights(vec2 uv)\n"
+        "{\n"
+        "\t// x - (0, 1), y - (1, 1), z - (1, 0), w - (0, 0)\n"
+        "\tvec4 h = textureGather(heightMap, uv, 0);\n"
+        "\tvec2 f = fract(uv * heightMapParams.xy - 0.5);\n"
+        "\n"
+        "\tfloat dhdx = mix(h.z - h.w, h.y - h.x, f.y);\n"
+        "\tfloat dhdy = mix(h.x - h.w, h.y - h.z, f.x);\n"
+        "\n"
+        "\tfloat scale = 2.0 * heightMapParams.z;\n"
+        "\treturn normalize(vec3(dhdx * scale, -dhdy * scale, heightMapParams.w));\n"
+        "}\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\t//\n"
+        "\t// read normal\n"
+        "\t//\n"
+        "\tvec3 norm;\n"
+        "\tfloat shininess = SHININESS;\n"
+        "\tif (fusedNormals != 0)\n"
+        "\t{\n"
+        "\t\tnorm = normalFromHeights(vertexIn.vTexCoord0);\n"
+        "\t}\n"
+        "\telse\n"
+        "\t{\n"
+        "\t\tvec4 texNorm = texture(normalMap, vertexIn.vTexCoord0);\n"
+        "\t\tnorm = normalize(texNorm.rgb*2.0-1.0);\n"
+        "\n"
+        "\t\t// Toksvig: alpha is the length of the averaged normal, the more the normals\n"
+        "\t\t// in the filtered area differ the wider (and weaker) the highlight is\n"
+        "\t\tfloat len = clamp(texNorm.a, 0.001, 1.0);\n"
+        "\t\tshininess = SHININESS * len / mix(SHININESS, 1.0, len);\n"
+        "\t}\n"
+        "\n"
+        "\t//\n"
+        "\t// lighting\n"
+        "\t//\n"
+        "\tvec3 ambient  = vec3(0.1);\n"
+        "\tvec3 diffuse  = vec3(0.0);\n"
+        "\tvec3 specular = vec3(0.0);\n"
+        "\t\n"
+        "\tvec3 eye = normalize(vertexIn.vEyePosTS - vertexIn.vPosTS);\n"
+        "\tvec3 light = normalize(vertexIn.vLightPosTS - vertexIn.vPosTS);\n"
+        "\t\n"
+        "\tvec3 halfv = normalize(eye + light);\n"
+        "\n"
+        "\t// diffuse\n"
+        "\tfloat diffElem = max(0.0, dot(norm, light));\n"
+        "\tdiffuse += vec3(diffElem);\n"
+        "\n"
+        "\t// specular\n"
+        "\tfloat specularElem = pow(max(0.0, dot(norm, halfv)), shininess);\n"
+        "\tspecular = vec3(specularElem * (1.0 + shininess) / (1.0 + SHININESS));\n"
+        "\n"
+        "\t//\n"
+        "\t// final\n"
+        "\t//\n"
+        "\n"
+        "\tif (planarTargets != 0)\n"
+        "\t{\n"
+        "\t\tvec2 screenPos = gl_FragCoord.xy * viewport.zw;\n"
+        "\t\tvec2 offset    = norm.xy * refractionFactor;\n"
+        "\n"
+        "\t\tvec3 refraction = texture(refractionMap, screenPos + offset).rgb;\n"
+        "\t\tvec3 reflection = texture(reflectionMap, screenPos + offset).rgb;\n"
+        "\n"
+        "\t\t// Schlick, water F0 = 0.02\n"
+        "\t\tfloat cosTheta = max(dot(norm, eye), 0.0);\n"
+        "\t\tfloat fresnel  = 0.02 + 0.98 * pow(1.0 - cosTheta, 5.0);\n"
+        "\n"
+        "\t\tvFragColor.rgb = mix(waterColor.rgb * refraction, reflection, fresnel) + specular;\n"
+        "\t\tvFragColor.a = waterColor.a;\n"
+        "\t\treturn;\n"
+        "\t}\n"
+        "\n"
+        "\tvec3 tex = texture(texture0, vertexIn.vTexCoord0+norm.xy*refractionFactor).rgb;\n"
+        "\n"
+        "    vFragColor.rgb = waterColor.rgb * tex * (ambient + diffuse) + specular;\n"
+        "\tvFragColor.a = waterColor.a;\n"
+        "}";
+
+    // renderSurface.vs
+    const char SOURCE_6[] =
+        "#version 330\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "layout(location = 0) in vec3 vVertex; \n"
+        "layout(location = 1) in vec3 vNormal; \n"
+        "layout(location = 2) in vec2 vTexCoord0;\n"
+        "\n"
+        "out Vertex\n"
+        "{\n"
+        "\tvec3 vPosTS;\t\t// vertex position in Tangent Space\n"
+        "\tvec3 vEyePosTS;\t\t// eye pos in Tangent Space\n"
+        "\tvec3 vLightPosTS;   // light pos in Tangent Space\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexOut;\n"
+        "     \n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "    vertexOut.vTexCoord0 = vTexCoord0;      \t\n"
+        "    \n"
+        "\tvec4 v = vec4(vVertex, 1.0);       \n"
+        "    \n"
+        "\tvec4 pos = modelviewMatrix * v;\n"
+        "\n"
+        "\t//\n"
+        "\t// compute tangent frame\n"
+        "\t//\n"
+        "\tvec3 T = normalize(normalMatrix * vec3(1.0, 0.0, 0.0));\n"
+        "\tvec3 N = normalize(normalMatrix * vNormal);\n"
+        "\tvec3 B = -normalize(cross(N, T));\n"
+        "\tmat3 TBN = mat3(T, B, N);\n"
+        "\n"
+        "\tvertexOut.vPosTS      = pos.xyz    * TBN;\t\t// note the order... not TBN * pos\n"
+        "\tvertexOut.vEyePosTS   = vec3(0.0) * TBN;\n"
+        "\tvertexOut.vLightPosTS = lightPos.xyz * TBN;\n"
+        "\t\n"
+        "\tgl_Position = projectionMatrix * modelviewMatrix * v;         \n"
+        "}";
+
+    // renderSurfaceDebug.fs
+    const char SOURCE_7[] =
+        "#version 330\n"
+        "\n"
+        "in Vertex\n"
+        "{\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexIn;\n"
+        "\n"
+        "uniform sampler2D texture0;\n"
+        "\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    vFragColor = texture(texture0, vertexIn.vTexCoord0);\n"
+        "}";
+
+    // renderSurfaceDebug.vs
+    const char SOURCE_8[] =
+        "#version 330\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "layout(location = 0) in vec3 vVertex; \n"
+        "layout(location = 1) in vec3 vNormal; \n"
+        "layout(location = 2) in vec2 vTexCoord0;\n"
+        "\n"
+        "out Vertex\n"
+        "{\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexOut;\n"
+        "     \n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "    vertexOut.vTexCoord0 = vTexCoord0;      \t\n"
+        "    \n"
+        "\tvec4 v = vec4(vVertex, 1.0);       \n"
+        "\t\n"
+        "\tgl_Position = projectionMatrix * modelviewMatrix * v;         \n"
+        "}";
+
+    // renderSurfaceTess.tcs
+    const char SOURCE_9[] =
+        "#version 400\n"
+        "\n"
+        "// tessellation control shader of the water mesh:\n"
+        "// every edge is divided so that its triangles have about tessEdgePixels on the screen\n"
+        "\n"
+        "layout(vertices = 4) out;\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "// parameters of the rendered surface, see uniformBlocks.h\n"
+        "layout(std140) uniform SurfaceParams\n"
+        "{\n"
+        "\tvec4  waterColor;\n"
+        "\tfloat refractionFactor;\n"
+        "\tfloat heightScale;\n"
+        "\tfloat tessEdgePixels;\n"
+        "\tint   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map\n"
+        "\tvec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale\n"
+        "\tint   planarTargets;    // 1 - reflection and refraction come from the planar targets\n"
+        "};\n"
+        "\n"
+        "// max water height that is expected, only used to not cull displaced patches\n"
+        "const float MAX_WATER_HEIGHT = 4.0;\n"
+        "const float MAX_TESS_LEVEL   = 64.0;\n"
+        "\n"
+        "in vec3 vPosition[];\n"
+        "in vec2 vTexCoord[];\n"
+        "\n"
+        "out vec3 tcPosition[];\n"
+        "out vec2 tcTexCoord[];\n"
+        "\n"
+        "// size of the edge on the screen (in pixels) divided by the wanted size.\n"
+        "// The edge is treated as a sphere, so the result does not depend on its orientation\n"
+        "// and both patches that share the edge get exactly the same level - no cracks\n"
+        "float edgeLevel(vec3 a, vec3 b)\n"
+        "{\n"
+        "\tvec3  center   = (modelviewMatrix * vec4((a + b) * 0.5, 1.0)).xyz;\n"
+        "\tfloat diameter = distance(a, b);\n"
+        "\n"
+        "\t// projectionMatrix[1][1] = cot(fov/2)\n"
+        "\tfloat pixels = diameter * projectionMatrix[1][1] * 0.5 * viewport.y / max(-center.z, 0.001);\n"
+        "\treturn clamp(pixels / tessEdgePixels, 1.0, MAX_TESS_LEVEL);\n"
+        "}\n"
+        "\n"
+        "// true if all corners (lowest and highest possible water) are outside one of the clip planes\n"
+        "bool outsideFrustum()\n"
+        "{\n"
+        "\tmat4  mvp    = projectionMatrix * modelviewMatrix;\n"
+        "\tfloat margin = MAX_WATER_HEIGHT * heightScale;\n"
+        "\n"
+        "\tvec4 c[8];\n"
+        "\tfor (int i = 0; i < 4; ++i)\n"
+        "\t{\n"
+        "\t\tc[i]     = mvp * vec4(vPosition[i] + vec3(0.0, margin, 0.0), 1.0);\n"
+        "\t\tc[i + 4] = mvp * vec4(vPosition[i] - vec3(0.0, margin, 0.0), 1.0);\n"
+        "\t}\n"
+        "\n"
+        "\tbvec4 allOut1 = bvec4(true);\t// -x, +x, -y, +y\n"
+        "\tbool  allOut2 = true;\t\t\t// far plane\n"
+        "\tbool  allOut3 = true;\t\t\t// near plane\n"
+        "\tfor (int i = 0; i < 8; ++i)\n"
+        "\t{\n"
+        "\t\t// && is not component-wise in GLSL\n"
+        "\t\tbvec4 out1 = bvec4(c[i].x < -c[i].w, c[i].x > c[i].w, c[i].y < -c[i].w, c[i].y > c[i].w);\n"
+        "\t\tallOut1 = bvec4(allOut1.x && out1.x, allOut1.y && out1.y, allOut1.z && out1.z, allOut1.w && out1.w);\n"
+        "\t\tallOut2 = allOut2 && (c[i].z > c[i].w);\n"
+        "\t\tallOut3 = allOut3 && (c[i].z < -c[i].w);\n"
+        "\t}\n"
+        "\n"
+        "\treturn any(allOut1) || allOut2 || allOut3;\n"
+        "}\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\ttcPosition[gl_InvocationID] = vPosition[gl_InvocationID];\n"
+        "\ttcTexCoord[gl_InvocationID] = vTexCoord[gl_InvocationID];\n"
+        "\n"
+        "\tif (gl_InvocationID == 0)\n"
+        "\t{\n"
+        "\t\tif (outsideFrustum())\n"
+        "\t\t{\n"
+        "\t\t\t// the patch is discarded\n"
+        "\t\t\tgl_TessLevelOuter[0] = 0.0;\n"
+        "\t\t\tgl_TessLevelOuter[1] = 0.0;\n"
+        "\t\t\tgl_TessLevelOuter[2] = 0.0;\n"
+        "\t\t\tgl_TessLevelOuter[3] = 0.0;\n"
+        "\t\t\tgl_TessLevelInner[0] = 0.0;\n"
+        "\t\t\tgl_TessLevelInner[1] = 0.0;\n"
+        "\t\t}\n"
+        "\t\telse\n"
+        "\t\t{\n"
+        "\t\t\t// corners: 0 - (u0, v0), 1 - (u1, v0), 2 - (u1, v1), 3 - (u0, v1)\n"
+        "\t\t\tgl_TessLevelOuter[0] = edgeLevel(vPosition[3], vPosition[0]);\t// u = 0\n"
+        "\t\t\tgl_TessLevelOuter[1] = edgeLevel(vPosition[0], vPosition[1]);\t// v = 0\n"
+        "\t\t\tgl_TessLevelOuter[2] = edgeLevel(vPosition[1], vPosition[2]);\t// u = 1\n"
+        "\t\t\tgl_TessLevelOuter[3] = edgeLevel(vPosition[2], vPosition[3]);\t// v = 1\n"
+        "\t\t\tgl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);\n"
+        "\t\t\tgl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);\n"
+        "\t\t}\n"
+        "\t}\n"
+        "}\n";
+
+    // renderSurfaceTess.tes
+    const char SOURCE_10[] =
+        "#version 400\n"
+        "\n"
+        "// tessellation evaluation shader of the water mesh: displaces vertices by the water height,\n"
+        "// outputs the same data as renderSurface.vs so that renderSurface.fs can be used\n"
+        "\n"
+        "layout(quads, fractional_even_spacing, ccw) in;\n"
+        "\n"
+        "// per frame camera, see uniformBlocks.h\n"
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "\tmat4 projectionMatrix;\n"
+        "\tmat4 modelviewMatrix;\n"
+        "\tmat3 normalMatrix;\n"
+        "\tvec4 lightPos;       // light pos in view space, w is not used\n"
+        "\tvec4 viewport;       // width, height, 1/width, 1/height\n"
+        "\tmat4 invViewProjection;\n"
+        "};\n"
+        "\n"
+        "// parameters of the rendered surface, see uniformBlocks.h\n"
+        "layout(std140) uniform SurfaceParams\n"
+        "{\n"
+        "\tvec4  waterColor;\n"
+        "\tfloat refractionFactor;\n"
+        "\tfloat heightScale;\n"
+        "\tfloat tessEdgePixels;\n"
+        "\tint   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map\n"
+        "\tvec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale\n"
+        "\tint   planarTargets;    // 1 - reflection and refraction come from the planar targets\n"
+        "};\n"
+        "\n"
+        "// water data: R - height, G - velocity\n"
+        "uniform sampler2D heightMap;\n"
+        "\n"
+        "in vec3 tcPosition[];\n"
+        "in vec2 tcTexCoord[];\n"
+        "\n"
+        "out Vertex\n"
+        "{\n"
+        "\tvec3 vPosTS;\t\t// vertex position in Tangent Space\n"
+        "\tvec3 vEyePosTS;\t\t// eye pos in Tangent Space\n"
+        "\tvec3 vLightPosTS;   // light pos in Tangent Space\n"
+        "\tvec2 vTexCoord0;\n"
+        "} vertexOut;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tvec2 uv  = gl_TessCoord.xy;\n"
+        "\tvec3 pos = mix(mix(tcPosition[0], tcPosition[1], uv.x), mix(tcPosition[3], tcPosition[2], uv.x), uv.y);\n"
+        "\tvec2 tex = mix(mix(tcTexCoord[0], tcTexCoord[1], uv.x), mix(tcTexCoord[3], tcTexCoord[2], uv.x), uv.y);\n"
+        "\n"
+        "\tpos.y += textureLod(heightMap, tex, 0.0).r * heightScale;\n"
+        "\n"
+        "\tvertexOut.vTexCoord0 = tex;\n"
+        "\n"
+        "\tvec4 posVS = modelviewMatrix * vec4(pos, 1.0);\n"
+        "\n"
+        "\t//\n"
+        "\t// tangent frame of the flat surface, details come from the normal map\n"
+        "\t//\n"
+        "\tvec3 T = normalize(normalMatrix * vec3(1.0, 0.0, 0.0));\n"
+        "\tvec3 N = normalize(normalMatrix * vec3(0.0, 1.0, 0.0));\n"
+        "\tvec3 B = -normalize(cross(N, T));\n"
+        "\tmat3 TBN = mat3(T, B, N);\n"
+        "\n"
+        "\tvertexOut.vPosTS      = posVS.xyz * TBN;\n"
+        "\tvertexOut.vEyePosTS   = vec3(0.0) * TBN;\n"
+        "\tvertexOut.vLightPosTS = lightPos.xyz * TBN;\n"
+        "\n"
+        "\tgl_Position = projectionMatrix * posVS;\n"
+        "}\n";
+
+    // renderSurfaceTess.vs
+    const char SOURCE_11[] =
+        "#version 400\n"
+        "\n"
+        "// vertex shader of the tessellated water mesh, only passes the patch corners\n"
+        "\n"
+        "layout(location = 0) in vec3 vVertex; \n"
+        "layout(location = 1) in vec3 vNormal; \n"
+        "layout(location = 2) in vec2 vTexCoord0;\n"
+        "\n"
+        "out vec3 vPosition;\t\t// model space, not displaced yet\n"
+        "out vec2 vTexCoord;\n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "\tvPosition = vVertex;\n"
+        "\tvTexCoord = vTexCoord0;\n"
+        "}\n";
+
+    // waterDraw.fs
+    const char SOURCE_12[] =
+        "// waterDraw.fs\n"
+        "// fragment shader that draws on the water height map surface, it\n"
+        "// changes height of the water at given position\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// input: standard texture coord\n"
+        "in vec2 vVaryingTexCoord0;\n"
+        "\n"
+        "// input: pressure that will be aplied to the water surface\n"
+        "//        it is a new water height at given position\n"
+        "in float vVaryingPressure;\n"
+        "\n"
+        "//\n"
+        "// output: RGBA color (but only R is set - new height)\n"
+        "//\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    vFragColor = vec4(vVaryingPressure, 0.0, 0.0, 0.0);\n"
+        "}";
+
+    // waterNormalsDownsample.fs
+    const char SOURCE_13[] =
+        "// waterNormalsDownsample.fs\n"
+        "// fragment shader that builds one mip level of the water normal map from the previous one\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// uniform: normal map, only the previous level is visible (base level = max level)\n"
+        "uniform sampler2D texture0;\n"
+        "\n"
+        "// input: standard texture coord - not used, texels are fetched directly\n"
+        "in vec2 vVaryingTexCoord0;\n"
+        "\n"
+        "// input: pressure - not used in this shader\n"
+        "in float vVaryingPressure;\n"
+        "\n"
+        "//\n"
+        "// output: RGB - normalized average normal, A - length of the average of all normals below\n"
+        "//\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "vec3 fetchNormal(ivec2 coord, ivec2 maxCoord)\n"
+        "{\n"
+        "\tvec4 texel = texelFetch(texture0, min(coord, maxCoord), 0);\n"
+        "\t// every source normal stands for the (shorter) average of its own area\n"
+        "\treturn normalize(texel.rgb*2.0 - 1.0) * texel.a;\n"
+        "}\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tivec2 maxCoord = textureSize(texture0, 0) - 1;\n"
+        "\tivec2 coord    = ivec2(gl_FragCoord.xy) * 2;\n"
+        "\n"
+        "\t// 2x2 box, edge texels are repeated for odd sizes\n"
+        "\tvec3 sum = fetchNormal(coord, maxCoord)\n"
+        "\t         + fetchNormal(coord + ivec2(1, 0), maxCoord)\n"
+        "\t         + fetchNormal(coord + ivec2(0, 1), maxCoord)\n"
+        "\t         + fetchNormal(coord + ivec2(1, 1), maxCoord);\n"
+        "\n"
+        "\t// bumpy areas give shorter averages, the shader lowers the specular power for them (Toksvig)\n"
+        "\tvec3  average = sum * 0.25;\n"
+        "\tfloat len     = length(average);\n"
+        "\n"
+        "\tvFragColor.rgb = (len > 0.0 \? average / len : vec3(0.0, 0.0, 1.0))*0.5 + vec3(0.5);\n"
+        "\tvFragColor.a   = len;\n"
+        "}\n";
+
+    // waterPassThrough.vs
+    const char SOURCE_14[] =
+        "// waterPassThrough.vs\n"
+        "// vertex shader that is used by all programs in height map water simulation\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// attrib: vertex pos + height\n"
+        "// x, y - position from -1 to 1\n"
+        "// z    - water pressure that is applied to water's height map\n"
+        "//        that way you can draw on the water\n"
+        "layout(location = 0) in vec3 vVertex; \n"
+        "\n"
+        "// attrib: standard texture coords\n"
+        "layout(location = 1) in vec2 vTexCoord0;\n"
+        "\n"
+        "// output: tex coord\n"
+        "out vec2 vVaryingTexCoord0;    \n"
+        "\n"
+        "// output: new height of the water a a given point\n"
+        "out float vVaryingPressure;   \n"
+        "\n"
+        "void main() \n"
+        "{\n"
+        "\tvVaryingTexCoord0 = vTexCoord0;    \n"
+        "\tvVaryingPressure  = vVertex.z;\n"
+        "\t  \n"
+        "    gl_Position = vec4(vVertex.x, vVertex.y, 0.0, 1.0);         \n"
+        "}";
+
+    // waterSplat.fs
+    const char SOURCE_15[] =
+        "// waterSplat.fs\n"
+        "// fragment shader for batched splats, blending is set to (ONE, ONE_MINUS_SRC_ALPHA)\n"
+        "// so that the result is: mix(current, target, weight) for height and velocity * (1 - weight)\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "flat in vec2  vHeightWeight;\n"
+        "flat in float vFalloff;\n"
+        "\n"
+        "//\n"
+        "// output: R - weighted height, G - nothing to add to velocity, A - weight\n"
+        "//\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tfloat w = 1.0;\n"
+        "\tif (vFalloff > 0.0)\n"
+        "\t{\n"
+        "\t\tvec2  d  = gl_PointCoord * 2.0 - 1.0;\n"
+        "\t\tfloat r2 = dot(d, d);\n"
+        "\t\tif (r2 > 1.0)\n"
+        "\t\t\tdiscard;\n"
+        "\t\tw = (1.0 - r2) * (1.0 - r2);\n"
+        "\t}\n"
+        "\n"
+        "\tvFragColor = vec4(vHeightWeight.x * w, 0.0, 0.0, vHeightWeight.y * w);\n"
+        "}\n";
+
+    // waterSplat.vs
+    const char SOURCE_16[] =
+        "// waterSplat.vs\n"
+        "// vertex shader for batched splats (raindrops and floating bodies) drawn as points\n"
+        "// into the water height map\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// attrib: x, y - position from -1 to 1, z - target height, w - weight (how much of the target is applied)\n"
+        "layout(location = 0) in vec4 vSplat;\n"
+        "\n"
+        "// attrib: diameter of the splat in texels\n"
+        "layout(location = 1) in float vDiameter;\n"
+        "\n"
+        "// output: target height premultiplied by the weight, and the weight\n"
+        "flat out vec2 vHeightWeight;\n"
+        "\n"
+        "// output: 1 - splat fades out towards its border, 0 - the whole point has the same weight\n"
+        "flat out float vFalloff;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tvHeightWeight = vec2(vSplat.z * vSplat.w, vSplat.w);\n"
+        "\tvFalloff      = vDiameter > 2.0 \? 1.0 : 0.0;\n"
+        "\n"
+        "\tgl_PointSize = vDiameter;\n"
+        "\tgl_Position  = vec4(vSplat.x, vSplat.y, 0.0, 1.0);\n"
+        "}\n";
+
+    // waterUpdate.fs
+    const char SOURCE_17[] =
+        "// waterUpdate.fs\n"
+        "// fragment shader that updates the water surface, height map algorithm\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "uniform sampler2D texture0;\n"
+        "\n"
+        "// per surface simulation parameters, see uniformBlocks.h\n"
+        "layout(std140) uniform WaterParams\n"
+        "{\n"
+        "\tvec4  density;       // x - fade of velocity, y - gather factor, z - fade of height\n"
+        "\tvec2  texelSize;     // size of a one texel\n"
+        "\tfloat normalScale;   // strength of the normal map in Z direction\n"
+        "\tint   rainSeed;      // procedural rain: different for every step so that drops do not repeat\n"
+        "\tvec2  rainParams;    // procedural rain: x - probability of a drop in one texel, y - max pressure of a drop (0 - no rain)\n"
+        "};\n"
+        "\n"
+        "// input: standard texture coord\n"
+        "in vec2 vVaryingTexCoord0;\n"
+        "\n"
+        "// input: pressure that will be aplied to the water surface\n"
+        "//        it is a new water height at given position - not used in this shader\n"
+        "in float vVaryingPressure;\n"
+        "\n"
+        "//\n"
+        "// output: RGBA, R - new height, G - velocity\n"
+        "//\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "// integer hash (lowbias32), good enough to scatter raindrops\n"
+        "uint hash(uint x)\n"
+        "{\n"
+        "\tx ^= x >> 16;\n"
+        "\tx *= 0x7feb352dU;\n"
+        "\tx ^= x >> 15;\n"
+        "\tx *= 0x846ca68bU;\n"
+        "\tx ^= x >> 16;\n"
+        "\treturn x;\n"
+        "}\n"
+        "\n"
+        "// uses top 24 bits of the hash, returns value from 0 to 1\n"
+        "float hashToFloat(uint h)\n"
+        "{\n"
+        "\treturn float(h >> 8) * (1.0 / 16777216.0);\n"
+        "}\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\tvec2 data  = texture(texture0, vVaryingTexCoord0.xy).rg; \n"
+        "\n"
+        "\t//\n"
+        "\t// get the change of height from four neightbours\n"
+        "\t//\n"
+        "\tfloat y  = data.r;\n"
+        "\tfloat yn = texture(texture0, vVaryingTexCoord0.xy + vec2(0.0, texelSize.y)).r  - y;\n"
+        "\tfloat yw = texture(texture0, vVaryingTexCoord0.xy + vec2(texelSize.x, 0.0)).r  - y;\n"
+        "\tfloat ys = texture(texture0, vVaryingTexCoord0.xy + vec2(0.0, -texelSize.y)).r - y;\n"
+        "\tfloat ye = texture(texture0, vVaryingTexCoord0.xy + vec2(-texelSize.x, 0.0)).r - y;\n"
+        "\n"
+        "\t// add to the current 'velocity'\n"
+        "\tdata.g  += (yn + yw + ys + ye) * density.y;\n"
+        "   \n"
+        "\t// reduce the speed a bit\n"
+        "    data.g *=  density.x;\n"
+        "    \n"
+        "\t// move the 'height', but not with full speed\n"
+        "    data.r = (data.r + data.g) * density.z;\n"
+        "\n"
+        "\t//\n"
+        "\t// procedural rain, the same as drawing a point with waterDraw.fs\n"
+        "\t// compiled in only for surfaces that use it (WaterSurface::computeShader)\n"
+        "\t//\n"
+        "#ifdef PROCEDURAL_RAIN\n"
+        "\tuvec2 texel = uvec2(gl_FragCoord.xy);\n"
+        "\tuint  h     = hash(texel.x + hash(texel.y + hash(uint(rainSeed))));\n"
+        "\tif (hashToFloat(h) < rainParams.x)\n"
+        "\t\tdata = vec2(mix(0.5, 1.0, hashToFloat(hash(h))) * rainParams.y, 0.0);\n"
+        "#endif\n"
+        "    \n"
+        "\tvFragColor = vec4(data.r, data.g, 0.0, 0.0);\n"
+        "}";
+
+    // waterUpdateNormals.fs
+    const char SOURCE_18[] =
+        "// waterUpdateNormals.fs\n"
+        "// fragment shader that is used to calculate normal map of the water\n"
+        "\n"
+        "#version 330\n"
+        "\n"
+        "// uniform: water height map values\n"
+        "uniform sampler2D texture0;\n"
+        "\n"
+        "// per surface simulation parameters, see uniformBlocks.h\n"
+        "layout(std140) uniform WaterParams\n"
+        "{\n"
+        "\tvec4  density;       // x - fade of velocity, y - gather factor, z - fade of height\n"
+        "\tvec2  texelSize;     // size of a one texel\n"
+        "\tfloat normalScale;   // strength of the normal map in Z direction\n"
+        "\tint   rainSeed;      // procedural rain: different for every step so that drops do not repeat\n"
+        "\tvec2  rainParams;    // procedural rain: x - probability of a drop in one texel, y - max pressure of a drop (0 - no rain)\n"
+        "};\n"
+        "\n"
+        "// input: standard texture coord\n"
+        "in vec2 vVaryingTexCoord0;\n"
+        "\n"
+        "// input: pressure that will be aplied to the water surface\n"
+        "//        it is a new water height at given position - not used in this shader\n"
+        "in float vVaryingPressure;\n"
+        "\n"
+        "//\n"
+        "// output: new normal in format XYZ, Y is the top..., A - length (see waterNormalsDownsample.fs)\n"
+        "//\n"
+        "out vec4 vFragColor;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "\t//  \n"
+        "\t// gather all four neighbours:\n"
+        "\t//\n"
+        "    float yn = texture(texture0, vVaryingTexCoord0.xy + vec2(0.0, texelSize.y)).r;\n"
+        "    float yw = texture(texture0, vVaryingTexCoord0.xy + vec2(texelSize.x, 0.0)).r;\n"
+        "    float ys = texture(texture0, vVaryingTexCoord0.xy + vec2(0.0, -texelSize.y)).r;\n"
+        "    float ye = texture(texture0, vVaryingTexCoord0.xy + vec2(-texelSize.x, 0.0)).r;\n"
+        "\n"
+        "\t// normalize:\n"
+        "    vec3 normal = normalize(vec3(yw-ye, ys-yn, normalScale));\n"
+        "   \n"
+        "    // code in the form of color (values from 0 to 1):\n"
+        "    vFragColor.rgb = normal*0.5+vec3(0.5);\n"
+        "    vFragColor.a = 1.0;     // length of the normal, lower in the mip levels\n"
+        "}";
+
+    const EmbeddedShader TABLE[] =
+    {
+        { "shaders/buoyancyForces.fs", SOURCE_0, 0xab0e7579981efeb2ULL },
+        { "shaders/buoyancyForces.vs", SOURCE_1, 0x65d52f208f723988ULL },
+        { "shaders/environment.fs", SOURCE_2, 0x0be3e1818768dae0ULL },
+        { "shaders/environment.vs", SOURCE_3, 0xa9e9b377f2a2f118ULL },
+        { "shaders/projectedGrid.vs", SOURCE_4, 0xd6464b918ea18edcULL },
+        { "shaders/renderSurface.fs", SOURCE_5, 0xf1f157ab6aa155ecULL },
+        { "shaders/renderSurface.vs", SOURCE_6, 0xb42210521bb327cbULL },
+        { "shaders/renderSurfaceDebug.fs", SOURCE_7, 0xbba0dfe0578e219cULL },
+        { "shaders/renderSurfaceDebug.vs", SOURCE_8, 0x9cb955dce44fc60bULL },
+        { "shaders/renderSurfaceTess.tcs", SOURCE_9, 0x4157b6dfff1f47abULL },
+        { "shaders/renderSurfaceTess.tes", SOURCE_10, 0x1ecbc8080657998eULL },
+        { "shaders/renderSurfaceTess.vs", SOURCE_11, 0xd485b91164a6ce4aULL },
+        { "shaders/waterDraw.fs", SOURCE_12, 0x619d585d847a95efULL },
+        { "shaders/waterNormalsDownsample.fs", SOURCE_13, 0x1d2e6195d15c8797ULL },
+        { "shaders/waterPassThrough.vs", SOURCE_14, 0xfc334ac3ee68eb77ULL },
+        { "shaders/waterSplat.fs", SOURCE_15, 0xd29eb00085718e52ULL },
+        { "shaders/waterSplat.vs", SOURCE_16, 0x9eb96117e08ffc20ULL },
+        { "shaders/waterUpdate.fs", SOURCE_17, 0x8d7eefabed16965cULL },
+        { "shaders/waterUpdateNormals.fs", SOURCE_18, 0xadf76ad1cc407ca9ULL },
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void registerEmbeddedShaders()
+{
+    shaderSources::registerEmbedded(TABLE, sizeof(TABLE)/sizeof(TABLE[0]));
+}
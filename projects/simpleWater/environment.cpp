@@ -0,0 +1,149 @@
+/** @file environment.cpp
+*  @brief simple scene around the water: pool bottom and a few pillars
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "GLState.h"
+
+#include "environment.h"
+#include "uniformBlocks.h"
+
+///////////////////////////////////////////////////////////////////////////////
+Environment::Environment() :
+    mVBO(0),
+    mVAO(0),
+    mVertexCount(0)
+{
+    mPoolDepth = -0.5f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Environment::~Environment()
+{
+    glDeleteBuffers(1, &mVBO);
+    glDeleteVertexArrays(1, &mVAO);
+    glState::invalidate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Environment::init()
+{
+    if (!shaderLoader::loadAndBuildShaderPairFromFile(&mShader, "shaders/environment.vs", "shaders/environment.fs"))
+        return false;
+
+    mShader.use();
+    mShader.uniform1i("texture0", 0);
+    mShader.uniformBlockBinding("Camera", uniformBlocks::CAMERA_BINDING);
+    mClipPlaneUniform = mShader.uniformHandle("clipPlane");
+    mShader.disable();
+
+    //
+    // pool bottom under the whole water and four pillars at the corners
+    //
+    std::vector<float> vertices;
+
+    const glm::vec3 bottom[4] = { glm::vec3(-1.0f, mPoolDepth, -1.0f), glm::vec3(-1.0f, mPoolDepth, 1.0f),
+                                  glm::vec3( 1.0f, mPoolDepth,  1.0f), glm::vec3( 1.0f, mPoolDepth, -1.0f) };
+    addFace(&vertices, bottom, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f));
+
+    const float pillar = 0.15f;
+    for (int i = 0; i < 4; ++i)
+    {
+        const float x = (i & 1) ? 1.0f : -1.0f - pillar;
+        const float z = (i & 2) ? 1.0f : -1.0f - pillar;
+        addBox(&vertices, glm::vec3(x, mPoolDepth, z), glm::vec3(x + pillar, 0.6f, z + pillar));
+    }
+
+    mVertexCount = (GLsizei)(vertices.size() / 8);
+
+    const GLsizei STRIDE = sizeof(float)*8;
+
+    glGenVertexArrays(1, &mVAO);
+    glState::bindVertexArray(mVAO);
+
+    glGenBuffers(1, &mVBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STRIDE, (const void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*3));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*6));
+
+    glState::bindVertexArray(0);
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Environment::draw(GLuint texture, const glm::vec4 &clipPlane)
+{
+    assert(mVAO > 0 && "call init first!");
+
+    mShader.use();
+    mShader.uniform4f(mClipPlaneUniform, clipPlane.x, clipPlane.y, clipPlane.z, clipPlane.w);
+
+    glState::bindTextureToUnit(0, GL_TEXTURE_2D, texture);
+
+    glEnable(GL_CLIP_DISTANCE0);
+    glState::bindVertexArray(mVAO);
+    glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
+    glDisable(GL_CLIP_DISTANCE0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Environment::draw(GLuint texture)
+{
+    // plane that clips nothing
+    draw(texture, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Environment::addBox(std::vector<float> *vertices, const glm::vec3 &a, const glm::vec3 &b)
+{
+    const glm::vec2 texScale(1.0f, 4.0f);
+
+    const glm::vec3 xNeg[4] = { glm::vec3(a.x, a.y, a.z), glm::vec3(a.x, a.y, b.z), glm::vec3(a.x, b.y, b.z), glm::vec3(a.x, b.y, a.z) };
+    const glm::vec3 xPos[4] = { glm::vec3(b.x, a.y, b.z), glm::vec3(b.x, a.y, a.z), glm::vec3(b.x, b.y, a.z), glm::vec3(b.x, b.y, b.z) };
+    const glm::vec3 zNeg[4] = { glm::vec3(b.x, a.y, a.z), glm::vec3(a.x, a.y, a.z), glm::vec3(a.x, b.y, a.z), glm::vec3(b.x, b.y, a.z) };
+    const glm::vec3 zPos[4] = { glm::vec3(a.x, a.y, b.z), glm::vec3(b.x, a.y, b.z), glm::vec3(b.x, b.y, b.z), glm::vec3(a.x, b.y, b.z) };
+    const glm::vec3 yPos[4] = { glm::vec3(a.x, b.y, a.z), glm::vec3(a.x, b.y, b.z), glm::vec3(b.x, b.y, b.z), glm::vec3(b.x, b.y, a.z) };
+
+    addFace(vertices, xNeg, glm::vec3(-1.0f, 0.0f, 0.0f), texScale);
+    addFace(vertices, xPos, glm::vec3( 1.0f, 0.0f, 0.0f), texScale);
+    addFace(vertices, zNeg, glm::vec3(0.0f, 0.0f, -1.0f), texScale);
+    addFace(vertices, zPos, glm::vec3(0.0f, 0.0f,  1.0f), texScale);
+    addFace(vertices, yPos, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Environment::addFace(std::vector<float> *vertices, const glm::vec3 corners[4], const glm::vec3 &normal, const glm::vec2 &texScale)
+{
+    const glm::vec2 tex[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+    const int order[6] = { 0, 1, 2, 0, 2, 3 };
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const glm::vec3 &p = corners[order[i]];
+        const glm::vec2  t = tex[order[i]] * texScale;
+
+        vertices->push_back(p.x);
+        vertices->push_back(p.y);
+        vertices->push_back(p.z);
+        vertices->push_back(normal.x);
+        vertices->push_back(normal.y);
+        vertices->push_back(normal.z);
+        vertices->push_back(t.x);
+        vertices->push_back(t.y);
+    }
+}
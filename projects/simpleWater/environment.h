@@ -0,0 +1,45 @@
+/** @file environment.h
+*  @brief simple scene around the water: pool bottom and a few pillars
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** geometry that can be seen through the water (refraction) and in the water (reflection)
+*
+* everything is in one VBO (position, normal, tex coord) and drawn with one call,
+* the shader clips the geometry with a world space plane, so the same draw is used
+* for the main view and for the planar passes.
+* "Camera" block is used (see uniformBlocks.h), texture on unit 0.
+*/
+class Environment
+{
+private:
+    GLuint mVBO;
+    GLuint mVAO;
+    GLsizei mVertexCount;
+
+    ShaderProgram mShader;
+    UniformHandle mClipPlaneUniform;
+public:
+    /// world Y of the pool bottom
+    float mPoolDepth;
+public:
+    Environment();
+    ~Environment();
+
+    bool init();
+
+    /// @param clipPlane world space plane (a, b, c, d), points with a*x + b*y + c*z + d < 0 are clipped
+    void draw(GLuint texture, const glm::vec4 &clipPlane);
+    /// draws everything
+    void draw(GLuint texture);
+private:
+    void addBox(std::vector<float> *vertices, const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+    void addFace(std::vector<float> *vertices, const glm::vec3 corners[4], const glm::vec3 &normal, const glm::vec2 &texScale);
+
+    // block copying:
+    Environment(const Environment &);
+    Environment & operator=(const Environment &);
+};
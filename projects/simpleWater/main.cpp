@@ -11,10 +11,13 @@
 
 #include "Shader.h"
 #include "ShaderProgram.h"
-#include "shaderLoader.h"
+#include "ShaderLoader.h"
+#include "GLState.h"
+#include "FrameCapture.h"
+#include "HeadlessContext.h"
 
 
-#ifdef DO_NOT_SHOW_CONSOLE
+#if defined(DO_NOT_SHOW_CONSOLE) && !defined(USE_HEADLESS_EGL)
 	#pragma comment( linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"" )
 #endif
 
@@ -31,10 +34,14 @@ unsigned int Globals::sMainWindowHeight = WND_START_HEIGHT;
 
 TwBar *Globals::sMainTweakBar = NULL;
 
+FrameCapture *Globals::sFrameCapture = NULL;
+
 ///////////////////////////////////////////////////////////////////////////////
 bool initApp();
 void cleanUp();
 
+#ifndef USE_HEADLESS_EGL
+
 // window:
 void mainChangeSize(int w, int h);
 
@@ -96,6 +103,9 @@ int main(int argc, char **argv)
 
 	CHECK_OPENGL_ERRORS();
 
+	FrameCapture frameCapture;
+	Globals::sFrameCapture = &frameCapture;
+
 	//
 	// init whole application:
 	//
@@ -113,12 +123,19 @@ int main(int argc, char **argv)
 	//
 	// finish:
 	//
+	frameCapture.stop();
 	cleanUp();
 	TwTerminate();
 
 	return(0);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void mainQuit()
+{
+	glutLeaveMainLoop();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void mainChangeSize(int w, int h)
 {
@@ -163,16 +180,119 @@ void mainIdle()
 {
 	double deltaTime;
 	utils::updateTimer(&deltaTime, &Globals::sAppTime);
+
+	bool doUpdate = true;
+	FrameCapture &capture = *Globals::sFrameCapture;
+	if (capture.isCapturing())
+	{
+		// fixed step per captured frame, the clip does not depend on the wall clock;
+		// when the encoder lags behind the scene stops instead of waiting for it
+		capture.update();
+		doUpdate = capture.isReady();
+		deltaTime = capture.frameTime();
+	}
 	
 	utils::calculateFps(&Globals::sFps);
 
 	// call Update:
-	updateScene(deltaTime);
+	if (doUpdate)
+		updateScene(deltaTime);
 
 	// render frame:
 	renderScene();
 
+	// without the UI
+	if (doUpdate && capture.isCapturing())
+		capture.captureFrame();
+
 	TwDraw();
+	// AntTweakBar changes the state on its own
+	glState::invalidate();
 
 	glutSwapBuffers();
 }
+
+#else
+
+// set by mainQuit, ends the frame loop
+static bool sQuit = false;
+
+///////////////////////////////////////////////////////////////////////////////
+// entry point without a window: simpleWater [frames] [capture prefix]
+// renders the given number of frames (default 600) with a fixed 1/60 s step into an
+// offscreen target, optionally written to "prefix.y4m"; no input, no AntTweakBar
+// simpleWater --check only runs runChecks after the init
+int main(int argc, char **argv)
+{
+	const bool checks = argc > 1 && strcmp(argv[1], "--check") == 0;
+	const int frames = argc > 1 && !checks ? atoi(argv[1]) : 600;
+	const char *capturePrefix = argc > 2 ? argv[2] : NULL;
+
+	if (headless::init() == false)
+		return 1;
+
+	if (utils::initGL(false) == false ||
+		headless::createTarget(WND_START_WIDTH, WND_START_HEIGHT) == false)
+	{
+		headless::shutdown();
+		return 1;
+	}
+
+	FrameCapture frameCapture;
+	Globals::sFrameCapture = &frameCapture;
+
+	if (initApp() == false)
+	{
+		LOG_ERROR("cannot init application...");
+		cleanUp();
+		headless::shutdown();
+		return 1;
+	}
+	changeSize(WND_START_WIDTH, WND_START_HEIGHT);
+
+	if (checks)
+	{
+		const bool ok = runChecks();
+		cleanUp();
+		headless::shutdown();
+		return ok ? 0 : 1;
+	}
+
+	if (capturePrefix)
+		frameCapture.start(capturePrefix, FrameCapture::Format::Y4M, WND_START_WIDTH, WND_START_HEIGHT);
+
+	const double frameTime = 1.0/60.0;
+	int frame = 0;
+	for (; frame < frames && sQuit == false; ++frame)
+	{
+		// nothing to show, so here waiting for the encoder is fine: every frame is captured
+		while (frameCapture.isCapturing() && frameCapture.isReady() == false)
+			frameCapture.update();
+
+		Globals::sAppTime += frameTime;
+		updateScene(frameTime);
+		renderScene();
+
+		if (frameCapture.isCapturing())
+			frameCapture.captureFrame();
+		else
+			glFinish();
+	}
+
+	LOG("headless run finished: %d frames, %.2f s of simulated time", frame, Globals::sAppTime);
+
+	frameCapture.stop();
+	cleanUp();
+	headless::shutdown();
+
+	// quitting before the last frame means something failed (see mainQuit callers)
+	return(frame < frames ? 1 : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void mainQuit()
+{
+	sQuit = true;
+}
+
+#endif // USE_HEADLESS_EGL
@@ -14,6 +14,8 @@
 
 #define DO_NOT_SHOW_CONSOLE
 
+class FrameCapture;
+
 struct Globals 
 {
     static double sAppTime; // global app time in seconds
@@ -23,11 +25,18 @@ struct Globals
     static unsigned int sMainWindowHeight;
 
     static TwBar *sMainTweakBar;
+
+    /// when capturing, every frame is one fixed step of the simulated time (see mainIdle)
+    static FrameCapture *sFrameCapture;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 bool initApp();
 void cleanUp();
+/// self checks of the initialized app (headless: simpleWater --check), false when one fails
+bool runChecks();
+/// leaves the main loop (glut or the headless frame loop)
+void mainQuit();
 
 // window:
 void changeSize(int w, int h);
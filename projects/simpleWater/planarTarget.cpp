@@ -0,0 +1,135 @@
+/** @file planarTarget.cpp
+*  @brief render target for planar reflection/refraction with dynamic resolution
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "Texture.h"
+#include "GLState.h"
+
+#include "planarTarget.h"
+
+///////////////////////////////////////////////////////////////////////////////
+PlanarTarget::PlanarTarget() :
+    mColorTex(0),
+    mScreenWidth(0),
+    mScreenHeight(0),
+    mWidth(0),
+    mHeight(0),
+    mResizeCooldown(0)
+{
+    mDynamicResolution = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PlanarTarget::~PlanarTarget()
+{
+    destroyTarget();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PlanarTarget::init(int screenWidth, int screenHeight)
+{
+    mScreenWidth  = screenWidth;
+    mScreenHeight = screenHeight;
+    return createTarget();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PlanarTarget::setScreenSize(int screenWidth, int screenHeight)
+{
+    if (screenWidth == mScreenWidth && screenHeight == mScreenHeight)
+        return;
+
+    mScreenWidth  = screenWidth;
+    mScreenHeight = screenHeight;
+    createTarget();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PlanarTarget::begin()
+{
+    assert(mColorTex > 0 && "call init first!");
+
+    glState::getViewport(mSavedViewport);
+
+    mFbo.bind(true);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    mTimer.begin();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PlanarTarget::end()
+{
+    mTimer.end();
+
+    FrameBuffer::bindSystemFrameBuffer();
+    glState::viewport(mSavedViewport[0], mSavedViewport[1], mSavedViewport[2], mSavedViewport[3]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PlanarTarget::update()
+{
+    const bool newResult = mTimer.poll();
+    if (mResizeCooldown > 0)
+    {
+        mResizeCooldown--;
+        return;
+    }
+
+    if (newResult && mDynamicResolution)
+    {
+        if (mScaler.update(mTimer.getTime()))
+            createTarget();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PlanarTarget::createTarget()
+{
+    destroyTarget();
+
+    // the results are a few frames late and smoothed: measurements of the previous size
+    // would push the scaler further, so it waits until the new size is timed
+    mTimer.init();
+    mResizeCooldown = 2 * AsyncTimerQuery::RING_SIZE;
+
+    mWidth  = std::max((int)(mScreenWidth * mScaler.scale()), 1);
+    mHeight = std::max((int)(mScreenHeight * mScaler.scale()), 1);
+
+    mColorTex = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_CLAMP_TO_EDGE);
+
+    mFbo.createAndBind();
+    mFbo.attachTextureAsColorTarget(0, mColorTex, mWidth, mHeight, GL_TEXTURE_2D);
+    mFbo.createAndAttachDepthRenderbuffer(mWidth, mHeight);
+    mFbo.setDrawBuffers();
+    bool complete = mFbo.check();
+
+    FrameBuffer::bindSystemFrameBuffer();
+
+    if (!complete)
+    {
+        LOG_ERROR("cannot create planar target %dx%d!", mWidth, mHeight);
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PlanarTarget::destroyTarget()
+{
+    mFbo.destroy();
+
+    if (mColorTex > 0)
+    {
+        glDeleteTextures(1, &mColorTex);
+        glState::invalidate();
+    }
+    mColorTex = 0;
+}
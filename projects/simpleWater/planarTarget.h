@@ -0,0 +1,66 @@
+/** @file planarTarget.h
+*  @brief render target for planar reflection/refraction with dynamic resolution
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include "Framebuffer.h"
+#include "TimeQuery.h"
+#include "ResolutionScaler.h"
+
+/** color texture + depth renderbuffer rendered at a part of the screen resolution
+*
+* the pass between begin() and end() is timed on the GPU, mScaler lowers the resolution
+* when the pass goes over its budget and raises it back when there is headroom.
+* Texture coords do not depend on the resolution, so the water shader samples it
+* with the screen position (gl_FragCoord * 1/viewport).
+*/
+class PlanarTarget
+{
+private:
+    FrameBuffer mFbo;
+    GLuint mColorTex;
+
+    int mScreenWidth;
+    int mScreenHeight;
+    int mWidth;
+    int mHeight;
+
+    AsyncTimerQuery mTimer;
+    /// frames left before the scaler gets timings again, see createTarget
+    int mResizeCooldown;
+    int mSavedViewport[4];
+public:
+    ResolutionScaler mScaler;
+    /// when false the resolution stays at mScaler's current scale
+    bool mDynamicResolution;
+public:
+    PlanarTarget();
+    ~PlanarTarget();
+
+    bool init(int screenWidth, int screenHeight);
+    /// call it when the window changes its size
+    void setScreenSize(int screenWidth, int screenHeight);
+
+    /// binds and clears the target, starts the timer
+    void begin();
+    /// stops the timer, binds the system framebuffer back
+    void end();
+    /// collects the timings and updates the resolution, call it once per frame
+    void update();
+
+    GLuint colorTexName() const { return mColorTex; }
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    /// GPU time of the pass in miliseconds (a few frames late)
+    double gpuTime() const { return mTimer.getTime(); }
+private:
+    bool createTarget();
+    void destroyTarget();
+
+    // block copying:
+    PlanarTarget(const PlanarTarget &);
+    PlanarTarget & operator=(const PlanarTarget &);
+};
@@ -0,0 +1,191 @@
+/** @file projectedGrid.cpp
+*  @brief projected grid renderer for water planes without bounds
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "GLState.h"
+
+#include "projectedGrid.h"
+#include "uniformBlocks.h"
+
+///////////////////////////////////////////////////////////////////////////////
+ProjectedGrid::ProjectedGrid() :
+    mColumns(0),
+    mRows(0),
+    mIndexCount(0),
+    mVBO(0),
+    mIBO(0),
+    mVAO(0)
+{
+    mWaterLevel  = 0.0f;
+    mMaxDistance = 50.0f;
+    mTileScale   = 1.0f;
+    mMargin      = 0.05f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ProjectedGrid::~ProjectedGrid()
+{
+    destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ProjectedGrid::init(GLuint columns, GLuint rows)
+{
+    assert(columns > 1 && rows > 1);
+
+    destroy();
+
+    mColumns = columns;
+    mRows    = rows;
+
+    //
+    // shader
+    //
+    if (mShader.getId() == 0)
+    {
+        if (!shaderLoader::loadAndBuildShaderPairFromFile(&mShader, "shaders/projectedGrid.vs", "shaders/renderSurface.fs"))
+            return false;
+
+        mShader.use();
+        mShader.uniform1i("texture0", 0);
+        mShader.uniform1i("normalMap", 1);
+        mShader.uniform1i("heightMap", 2);
+        mShader.uniform1i("reflectionMap", 3);
+        mShader.uniform1i("refractionMap", 4);
+        mShader.uniformBlockBinding("Camera", uniformBlocks::CAMERA_BINDING);
+        mShader.uniformBlockBinding("SurfaceParams", uniformBlocks::SURFACE_BINDING);
+        mGridRangeUniform = mShader.uniformHandle("gridRange");
+        mGridPlaneUniform = mShader.uniformHandle("gridPlane");
+        mShader.disable();
+    }
+
+    //
+    // vertices: only the position in the grid, everything else is computed in the shader
+    //
+    std::vector<float> vertices;
+    vertices.reserve(mColumns * mRows * 2);
+    for (GLuint y = 0; y < mRows; ++y)
+    {
+        for (GLuint x = 0; x < mColumns; ++x)
+        {
+            vertices.push_back((float)x / (float)(mColumns - 1));
+            vertices.push_back((float)y / (float)(mRows - 1));
+        }
+    }
+
+    std::vector<GLuint> indices;
+    indices.reserve((mColumns - 1) * (mRows - 1) * 6);
+    for (GLuint y = 0; y < mRows - 1; ++y)
+    {
+        for (GLuint x = 0; x < mColumns - 1; ++x)
+        {
+            const GLuint first = y * mColumns + x;
+            indices.push_back(first);
+            indices.push_back(first + 1);
+            indices.push_back(first + mColumns);
+
+            indices.push_back(first + 1);
+            indices.push_back(first + 1 + mColumns);
+            indices.push_back(first + mColumns);
+        }
+    }
+    mIndexCount = (GLuint)indices.size();
+
+    glGenVertexArrays(1, &mVAO);
+    glState::bindVertexArray(mVAO);
+
+    glGenBuffers(1, &mVBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    glGenBuffers(1, &mIBO);
+    glState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*2, (const void *)0);
+
+    glState::bindVertexArray(0);
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ProjectedGrid::draw(const glm::mat4 &projection, const glm::mat4 &modelview)
+{
+    assert(mVAO > 0 && "call init first!");
+
+    glm::vec4 range;
+    if (computeRange(projection, modelview, &range) == false)
+        return false;
+
+    mShader.use();
+    mShader.uniform4f(mGridRangeUniform, range.x, range.y, range.z, range.w);
+    mShader.uniform3f(mGridPlaneUniform, mWaterLevel, mMaxDistance, mTileScale);
+
+    glState::bindVertexArray(mVAO);
+    glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (const void *)0);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ProjectedGrid::computeRange(const glm::mat4 &projection, const glm::mat4 &modelview, glm::vec4 *outRange) const
+{
+    // whole screen by default:
+    *outRange = glm::vec4(-1.0f - mMargin, 1.0f + mMargin, -1.0f - mMargin, 1.0f + mMargin);
+
+    const glm::mat4 invModelview = glm::inverse(modelview);
+    const glm::vec3 eye = glm::vec3(invModelview[3]);
+
+    // under the water the plane can cover any part of the screen
+    if (eye.y <= mWaterLevel)
+        return true;
+
+    // looking straight down: the horizon is not on the screen
+    glm::vec3 forward = glm::vec3(invModelview * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+    glm::vec2 flatForward(forward.x, forward.z);
+    if (glm::length(flatForward) < 0.0001f)
+        return true;
+    flatForward = glm::normalize(flatForward);
+
+    //
+    // horizon (the end of the grid) in front of the camera, the camera is assumed not to roll
+    // so the horizon is a horizontal line on the screen
+    //
+    glm::vec4 horizon(eye.x + flatForward.x*mMaxDistance, mWaterLevel, eye.z + flatForward.y*mMaxDistance, 1.0f);
+    glm::vec4 clip = projection * modelview * horizon;
+    if (clip.w <= 0.0f)
+        return true;
+
+    const float horizonY = clip.y / clip.w;
+    if (horizonY < -1.0f - mMargin)
+        return false;
+
+    outRange->w = std::min(horizonY + mMargin, 1.0f + mMargin);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ProjectedGrid::destroy()
+{
+    if (mVAO == 0)
+        return;
+
+    glDeleteBuffers(1, &mVBO);
+    glDeleteBuffers(1, &mIBO);
+    glDeleteVertexArrays(1, &mVAO);
+    glState::invalidate();
+
+    mVBO = mIBO = mVAO = 0;
+    mIndexCount = 0;
+}
@@ -0,0 +1,61 @@
+/** @file projectedGrid.h
+*  @brief projected grid renderer for water planes without bounds
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** regular grid in screen space that is projected on the water plane every frame
+*
+* vertex count is the same for any view, vertices are dense near the camera and sparse at the horizon,
+* nothing is drawn outside the screen. The water textures are repeated over the plane
+* (use WaterSurface::setTileable), the grid is displaced in the vertex shader (projectedGrid.vs)
+* and lit by renderSurface.fs.
+*
+* textures have to be bound before draw: 0 - texture0, 1 - normal map, 2 - water data, 3/4 - reflection/refraction,
+* "Camera" and "SurfaceParams" blocks are used (see uniformBlocks.h)
+*/
+class ProjectedGrid
+{
+private:
+    GLuint mColumns;
+    GLuint mRows;
+    GLuint mIndexCount;
+
+    GLuint mVBO;
+    GLuint mIBO;
+    GLuint mVAO;
+
+    ShaderProgram mShader;
+    UniformHandle mGridRangeUniform;
+    UniformHandle mGridPlaneUniform;
+public:
+    /// world Y of the water plane
+    float mWaterLevel;
+    /// the grid ends at this distance from the eye (on the plane), default is 50
+    float mMaxDistance;
+    /// repeats of the water textures per world unit, 1 - one repeat covers -1..1 like the quad
+    float mTileScale;
+    /// extra NDC space around the screen so that displaced vertices do not open gaps at the edges
+    float mMargin;
+public:
+    ProjectedGrid();
+    ~ProjectedGrid();
+
+    /// @param columns, rows vertices of the grid, something close to the screen size / 8 is enough
+    bool init(GLuint columns, GLuint rows);
+
+    /// fits the grid between the screen edges and the horizon and draws it
+    /// @return false if the plane is not visible at all
+    bool draw(const glm::mat4 &projection, const glm::mat4 &modelview);
+
+    GLuint vertexCount() const { return mColumns * mRows; }
+private:
+    bool computeRange(const glm::mat4 &projection, const glm::mat4 &modelview, glm::vec4 *outRange) const;
+    void destroy();
+
+    // block copying:
+    ProjectedGrid(const ProjectedGrid &);
+    ProjectedGrid & operator=(const ProjectedGrid &);
+};
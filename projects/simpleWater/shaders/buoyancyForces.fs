@@ -0,0 +1,14 @@
+// buoyancyForces.fs
+// fragment shader that outputs force of one body sample, results are summed with additive blending
+
+#version 330
+
+// input: force or torque of the sample
+flat in vec4 vForce;
+
+out vec4 vFragColor;
+
+void main()
+{
+	vFragColor = vForce;
+}
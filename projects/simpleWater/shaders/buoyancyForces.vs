@@ -0,0 +1,58 @@
+// buoyancyForces.vs
+// vertex shader that calculates buoyancy force (and torque) of a single body sample point,
+// the point is then moved to the texel of its body and accumulated there with additive blending
+
+#version 330
+
+// water height map values (R - height)
+uniform sampler2D texture0;
+// xy - offset to the neighbours (offset scale / size of the water), z - normal scale
+// the same as in waterUpdateNormals.fs, so the normal map pass is not needed
+uniform vec3 normalParams;
+
+// xy - min corner of the water on the XZ plane, zw - 1/size of the water
+uniform vec4 worldRect;
+// x - water level, y - world units per unit of water height, z - fluid density * gravity
+uniform vec3 waterParams;
+// number of bodies = width of the output texture
+uniform float bodyCount;
+
+// attrib: sample position in world space + area that the sample represents
+layout(location = 0) in vec4 vPositionArea;
+// attrib: sample position relative to the center of mass of its body + body index
+layout(location = 1) in vec4 vArmBody;
+
+// output: force (or torque for the second instance), w - submerged area
+flat out vec4 vForce;
+
+void main()
+{
+	vec2 uv = (vPositionArea.xz - worldRect.xy) * worldRect.zw;
+
+	float waterY = waterParams.x + texture(texture0, uv).r * waterParams.y;
+	float depth  = waterY - vPositionArea.y;
+
+	if (depth <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+	{
+		// not in the water: put the point outside the viewport so that nothing is blended
+		vForce      = vec4(0.0);
+		gl_Position = vec4(2.0, 2.0, 0.0, 1.0);
+		return;
+	}
+
+	// normal from four neighbours (dh/dx, -dh/dz, scale), converted into world space (Y up)
+	float yn = texture(texture0, uv + vec2(0.0, normalParams.y)).r;
+	float yw = texture(texture0, uv + vec2(normalParams.x, 0.0)).r;
+	float ys = texture(texture0, uv - vec2(0.0, normalParams.y)).r;
+	float ye = texture(texture0, uv - vec2(normalParams.x, 0.0)).r;
+	vec3 n = vec3(yw - ye, ys - yn, normalParams.z);
+	vec3 normal = normalize(vec3(-n.x, n.z, n.y));
+
+	vec3 force = normal * (waterParams.z * vPositionArea.w * depth);
+
+	// instance 0 - force, instance 1 - torque
+	vForce = gl_InstanceID == 0 ? vec4(force, vPositionArea.w) : vec4(cross(vArmBody.xyz, force), 0.0);
+
+	// one texel per body, row selected by the instance
+	gl_Position = vec4((vArmBody.w + 0.5) / bodyCount * 2.0 - 1.0, gl_InstanceID == 0 ? -0.5 : 0.5, 0.0, 1.0);
+}
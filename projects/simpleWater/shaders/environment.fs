@@ -0,0 +1,18 @@
+#version 330
+
+uniform sampler2D texture0;
+
+in vec3 vNormalVS;
+in vec3 vToLightVS;
+in vec2 vTexCoord;
+
+out vec4 vFragColor;
+
+void main()
+{
+	// no culling, back faces get the same light
+	float diffuse = abs(dot(normalize(vNormalVS), normalize(vToLightVS)));
+
+	vec3 tex = texture(texture0, vTexCoord).rgb;
+	vFragColor = vec4(tex * (0.2 + 0.8*diffuse), 1.0);
+}
@@ -0,0 +1,40 @@
+#version 330
+
+// environment around the water, lit from the camera, clipped by a world space plane
+// (reflection pass keeps what is above the water, refraction pass what is below)
+
+// per frame camera, see uniformBlocks.h
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 modelviewMatrix;
+	mat3 normalMatrix;
+	vec4 lightPos;       // light pos in view space, w is not used
+	vec4 viewport;       // width, height, 1/width, 1/height
+	mat4 invViewProjection;
+};
+
+// world space plane, points with dot(plane, pos) < 0 are clipped
+uniform vec4 clipPlane;
+
+layout(location = 0) in vec3 vVertex; 
+layout(location = 1) in vec3 vNormal; 
+layout(location = 2) in vec2 vTexCoord0;
+
+out vec3 vNormalVS;
+out vec3 vToLightVS;
+out vec2 vTexCoord;
+
+out float gl_ClipDistance[1];
+
+void main() 
+{
+	vec4 posVS = modelviewMatrix * vec4(vVertex, 1.0);
+
+	vNormalVS  = normalMatrix * vNormal;
+	vToLightVS = lightPos.xyz - posVS.xyz;
+	vTexCoord  = vTexCoord0;
+
+	gl_ClipDistance[0] = dot(clipPlane, vec4(vVertex, 1.0));
+	gl_Position = projectionMatrix * posVS;
+}
@@ -0,0 +1,100 @@
+#version 330
+
+// projected grid: vertices of a regular screen space grid are moved to the point
+// where their view ray hits the water plane, then displaced by the (tiled) water height.
+// Output is the same as in renderSurface.vs so that renderSurface.fs can be used
+
+// per frame camera, see uniformBlocks.h
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 modelviewMatrix;
+	mat3 normalMatrix;
+	vec4 lightPos;       // light pos in view space, w is not used
+	vec4 viewport;       // width, height, 1/width, 1/height
+	mat4 invViewProjection;
+};
+
+// parameters of the rendered surface, see uniformBlocks.h
+layout(std140) uniform SurfaceParams
+{
+	vec4  waterColor;
+	float refractionFactor;
+	float heightScale;
+	float tessEdgePixels;
+	int   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map
+	vec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale
+	int   planarTargets;    // 1 - reflection and refraction come from the planar targets
+};
+
+// NDC rectangle covered by the grid: min x, max x, min y, max y
+uniform vec4 gridRange;
+// x - water level, y - max distance from the eye, z - tiles of the water texture per world unit
+uniform vec3 gridPlane;
+
+// water data: R - height, G - velocity
+uniform sampler2D heightMap;
+
+layout(location = 0) in vec2 vGridPos;   // from 0 to 1 in both directions
+
+out Vertex
+{
+	vec3 vPosTS;		// vertex position in Tangent Space
+	vec3 vEyePosTS;		// eye pos in Tangent Space
+	vec3 vLightPosTS;   // light pos in Tangent Space
+	vec2 vTexCoord0;
+} vertexOut;
+
+void main() 
+{
+	float waterLevel  = gridPlane.x;
+	float maxDistance = gridPlane.y;
+
+	//
+	// view ray of the grid vertex
+	//
+	vec2 ndc = vec2(mix(gridRange.x, gridRange.y, vGridPos.x), mix(gridRange.z, gridRange.w, vGridPos.y));
+	vec4 nearPos = invViewProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPos  = invViewProjection * vec4(ndc,  1.0, 1.0);
+	vec3 origin  = nearPos.xyz / nearPos.w;
+	vec3 dir     = farPos.xyz / farPos.w - origin;
+
+	//
+	// intersection with the plane, rays that miss it (above the horizon) or hit it too far
+	// are clamped to maxDistance so that the grid ends at the horizon
+	//
+	vec2 flatDir = length(dir.xz) > 0.0 ? normalize(dir.xz) : vec2(0.0, 1.0);
+	vec3 pos     = vec3(origin.x + flatDir.x*maxDistance, waterLevel, origin.z + flatDir.y*maxDistance);
+	if (dir.y < 0.0)
+	{
+		float t = (waterLevel - origin.y) / dir.y;
+		vec3 hit = origin + dir*t;
+		if (t > 0.0 && distance(hit.xz, origin.xz) < maxDistance)
+			pos = hit;
+	}
+
+	//
+	// displacement, faded out in the distance where one grid cell covers many texels
+	//
+	vec2 tex = pos.xz * 0.5 * gridPlane.z + 0.5;
+	float fade = 1.0 - smoothstep(0.25*maxDistance, maxDistance, distance(pos.xz, origin.xz));
+	pos.y += textureLod(heightMap, tex, 0.0).r * heightScale * fade;
+
+	vertexOut.vTexCoord0 = tex;
+
+	vec4 posVS = modelviewMatrix * vec4(pos, 1.0);
+
+	//
+	// tangent frame of the flat surface, details come from the normal map
+	//
+	vec3 T = normalize(normalMatrix * vec3(1.0, 0.0, 0.0));
+	vec3 N = normalize(normalMatrix * vec3(0.0, 1.0, 0.0));
+	vec3 B = -normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+
+	vertexOut.vPosTS      = posVS.xyz * TBN;
+	vertexOut.vEyePosTS   = vec3(0.0) * TBN;
+	vertexOut.vLightPosTS = lightPos.xyz * TBN;
+
+	gl_Position = projectionMatrix * posVS;
+}
@@ -1,4 +1,4 @@
-#version 330
+#version 400
 
 in Vertex
 {
@@ -8,22 +8,77 @@ in Vertex
 	vec2 vTexCoord0;
 } vertexIn;
 
-uniform float refractionFactor;
+// per frame camera, see uniformBlocks.h
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 modelviewMatrix;
+	mat3 normalMatrix;
+	vec4 lightPos;       // light pos in view space, w is not used
+	vec4 viewport;       // width, height, 1/width, 1/height
+	mat4 invViewProjection;
+};
 
-uniform vec4 waterColor;
+// parameters of the rendered surface, see uniformBlocks.h
+layout(std140) uniform SurfaceParams
+{
+	vec4  waterColor;
+	float refractionFactor;
+	float heightScale;
+	float tessEdgePixels;
+	int   fusedNormals;     // 1 - normals are derived from the heights, there is no normal map
+	vec4  heightMapParams;  // x, y - size of the height map, z - offset scale, w - normal scale
+	int   planarTargets;    // 1 - reflection and refraction come from the planar targets
+};
 
 uniform sampler2D texture0;
 uniform sampler2D normalMap;
+// water data (R - height), used instead of normalMap when fusedNormals is set
+uniform sampler2D heightMap;
+// planar targets, sampled at the screen position
+uniform sampler2D reflectionMap;
+uniform sampler2D refractionMap;
 
 out vec4 vFragColor;
 
+const float SHININESS = 64.0;
+
+// normal from the gradient of the bilinear patch around uv, one gather instead of four taps.
+// The scale is the same as in waterUpdateNormals.fs: its central difference spans 2*offset texels
+vec3 normalFromHeights(vec2 uv)
+{
+	// x - (0, 1), y - (1, 1), z - (1, 0), w - (0, 0)
+	vec4 h = textureGather(heightMap, uv, 0);
+	vec2 f = fract(uv * heightMapParams.xy - 0.5);
+
+	float dhdx = mix(h.z - h.w, h.y - h.x, f.y);
+	float dhdy = mix(h.x - h.w, h.y - h.z, f.x);
+
+	float scale = 2.0 * heightMapParams.z;
+	return normalize(vec3(dhdx * scale, -dhdy * scale, heightMapParams.w));
+}
+
 void main()
 {
 	//
 	// read normal
 	//
-	vec3 texNorm = texture(normalMap, vertexIn.vTexCoord0).rgb;
-	vec3 norm = normalize(texNorm*2.0-1.0);
+	vec3 norm;
+	float shininess = SHININESS;
+	if (fusedNormals != 0)
+	{
+		norm = normalFromHeights(vertexIn.vTexCoord0);
+	}
+	else
+	{
+		vec4 texNorm = texture(normalMap, vertexIn.vTexCoord0);
+		norm = normalize(texNorm.rgb*2.0-1.0);
+
+		// Toksvig: alpha is the length of the averaged normal, the more the normals
+		// in the filtered area differ the wider (and weaker) the highlight is
+		float len = clamp(texNorm.a, 0.001, 1.0);
+		shininess = SHININESS * len / mix(SHININESS, 1.0, len);
+	}
 
 	//
 	// lighting
@@ -42,13 +97,30 @@ void main()
 	diffuse += vec3(diffElem);
 
 	// specular
-	float specularElem = pow(max(0.0, dot(norm, halfv)), 64.0);
-	specular = vec3(specularElem);
+	float specularElem = pow(max(0.0, dot(norm, halfv)), shininess);
+	specular = vec3(specularElem * (1.0 + shininess) / (1.0 + SHININESS));
 
 	//
 	// final
 	//
 
+	if (planarTargets != 0)
+	{
+		vec2 screenPos = gl_FragCoord.xy * viewport.zw;
+		vec2 offset    = norm.xy * refractionFactor;
+
+		vec3 refraction = texture(refractionMap, screenPos + offset).rgb;
+		vec3 reflection = texture(reflectionMap, screenPos + offset).rgb;
+
+		// Schlick, water F0 = 0.02
+		float cosTheta = max(dot(norm, eye), 0.0);
+		float fresnel  = 0.02 + 0.98 * pow(1.0 - cosTheta, 5.0);
+
+		vFragColor.rgb = mix(waterColor.rgb * refraction, reflection, fresnel) + specular;
+		vFragColor.a = waterColor.a;
+		return;
+	}
+
 	vec3 tex = texture(texture0, vertexIn.vTexCoord0+norm.xy*refractionFactor).rgb;
 
     vFragColor.rgb = waterColor.rgb * tex * (ambient + diffuse) + specular;
@@ -1,11 +1,15 @@
 #version 330
 
-uniform mat4 modelviewMatrix;
-uniform mat3 normalMatrix;
-uniform mat4 projectionMatrix;
-
-// light pos in view space
-uniform vec3 lightPos;
+// per frame camera, see uniformBlocks.h
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 modelviewMatrix;
+	mat3 normalMatrix;
+	vec4 lightPos;       // light pos in view space, w is not used
+	vec4 viewport;       // width, height, 1/width, 1/height
+	mat4 invViewProjection;
+};
 
 layout(location = 0) in vec3 vVertex; 
 layout(location = 1) in vec3 vNormal; 
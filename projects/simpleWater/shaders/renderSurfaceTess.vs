@@ -0,0 +1,16 @@
+#version 400
+
+// vertex shader of the tessellated water mesh, only passes the patch corners
+
+layout(location = 0) in vec3 vVertex; 
+layout(location = 1) in vec3 vNormal; 
+layout(location = 2) in vec2 vTexCoord0;
+
+out vec3 vPosition;		// model space, not displaced yet
+out vec2 vTexCoord;
+
+void main() 
+{
+	vPosition = vVertex;
+	vTexCoord = vTexCoord0;
+}
@@ -0,0 +1,44 @@
+// waterNormalsDownsample.fs
+// fragment shader that builds one mip level of the water normal map from the previous one
+
+#version 330
+
+// uniform: normal map, only the previous level is visible (base level = max level)
+uniform sampler2D texture0;
+
+// input: standard texture coord - not used, texels are fetched directly
+in vec2 vVaryingTexCoord0;
+
+// input: pressure - not used in this shader
+in float vVaryingPressure;
+
+//
+// output: RGB - normalized average normal, A - length of the average of all normals below
+//
+out vec4 vFragColor;
+
+vec3 fetchNormal(ivec2 coord, ivec2 maxCoord)
+{
+	vec4 texel = texelFetch(texture0, min(coord, maxCoord), 0);
+	// every source normal stands for the (shorter) average of its own area
+	return normalize(texel.rgb*2.0 - 1.0) * texel.a;
+}
+
+void main()
+{
+	ivec2 maxCoord = textureSize(texture0, 0) - 1;
+	ivec2 coord    = ivec2(gl_FragCoord.xy) * 2;
+
+	// 2x2 box, edge texels are repeated for odd sizes
+	vec3 sum = fetchNormal(coord, maxCoord)
+	         + fetchNormal(coord + ivec2(1, 0), maxCoord)
+	         + fetchNormal(coord + ivec2(0, 1), maxCoord)
+	         + fetchNormal(coord + ivec2(1, 1), maxCoord);
+
+	// bumpy areas give shorter averages, the shader lowers the specular power for them (Toksvig)
+	vec3  average = sum * 0.25;
+	float len     = length(average);
+
+	vFragColor.rgb = (len > 0.0 ? average / len : vec3(0.0, 0.0, 1.0))*0.5 + vec3(0.5);
+	vFragColor.a   = len;
+}
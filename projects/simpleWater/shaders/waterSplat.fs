@@ -0,0 +1,28 @@
+// waterSplat.fs
+// fragment shader for batched splats, blending is set to (ONE, ONE_MINUS_SRC_ALPHA)
+// so that the result is: mix(current, target, weight) for height and velocity * (1 - weight)
+
+#version 330
+
+flat in vec2  vHeightWeight;
+flat in float vFalloff;
+
+//
+// output: R - weighted height, G - nothing to add to velocity, A - weight
+//
+out vec4 vFragColor;
+
+void main()
+{
+	float w = 1.0;
+	if (vFalloff > 0.0)
+	{
+		vec2  d  = gl_PointCoord * 2.0 - 1.0;
+		float r2 = dot(d, d);
+		if (r2 > 1.0)
+			discard;
+		w = (1.0 - r2) * (1.0 - r2);
+	}
+
+	vFragColor = vec4(vHeightWeight.x * w, 0.0, 0.0, vHeightWeight.y * w);
+}
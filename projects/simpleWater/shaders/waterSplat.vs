@@ -0,0 +1,26 @@
+// waterSplat.vs
+// vertex shader for batched splats (raindrops and floating bodies) drawn as points
+// into the water height map
+
+#version 330
+
+// attrib: x, y - position from -1 to 1, z - target height, w - weight (how much of the target is applied)
+layout(location = 0) in vec4 vSplat;
+
+// attrib: diameter of the splat in texels
+layout(location = 1) in float vDiameter;
+
+// output: target height premultiplied by the weight, and the weight
+flat out vec2 vHeightWeight;
+
+// output: 1 - splat fades out towards its border, 0 - the whole point has the same weight
+flat out float vFalloff;
+
+void main()
+{
+	vHeightWeight = vec2(vSplat.z * vSplat.w, vSplat.w);
+	vFalloff      = vDiameter > 2.0 ? 1.0 : 0.0;
+
+	gl_PointSize = vDiameter;
+	gl_Position  = vec4(vSplat.x, vSplat.y, 0.0, 1.0);
+}
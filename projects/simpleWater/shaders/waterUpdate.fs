@@ -5,8 +5,15 @@
 
 uniform sampler2D texture0;
 
-uniform vec3 density;
-uniform vec2 texelSize;
+// per surface simulation parameters, see uniformBlocks.h
+layout(std140) uniform WaterParams
+{
+	vec4  density;       // x - fade of velocity, y - gather factor, z - fade of height
+	vec2  texelSize;     // size of a one texel
+	float normalScale;   // strength of the normal map in Z direction
+	int   rainSeed;      // procedural rain: different for every step so that drops do not repeat
+	vec2  rainParams;    // procedural rain: x - probability of a drop in one texel, y - max pressure of a drop (0 - no rain)
+};
 
 // input: standard texture coord
 in vec2 vVaryingTexCoord0;
@@ -20,6 +27,23 @@ in float vVaryingPressure;
 //
 out vec4 vFragColor;
 
+// integer hash (lowbias32), good enough to scatter raindrops
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+// uses top 24 bits of the hash, returns value from 0 to 1
+float hashToFloat(uint h)
+{
+	return float(h >> 8) * (1.0 / 16777216.0);
+}
+
 void main()
 {
 	vec2 data  = texture(texture0, vVaryingTexCoord0.xy).rg; 
@@ -41,6 +65,17 @@ void main()
     
 	// move the 'height', but not with full speed
     data.r = (data.r + data.g) * density.z;
+
+	//
+	// procedural rain, the same as drawing a point with waterDraw.fs
+	// compiled in only for surfaces that use it (WaterSurface::computeShader)
+	//
+#ifdef PROCEDURAL_RAIN
+	uvec2 texel = uvec2(gl_FragCoord.xy);
+	uint  h     = hash(texel.x + hash(texel.y + hash(uint(rainSeed))));
+	if (hashToFloat(h) < rainParams.x)
+		data = vec2(mix(0.5, 1.0, hashToFloat(hash(h))) * rainParams.y, 0.0);
+#endif
     
 	vFragColor = vec4(data.r, data.g, 0.0, 0.0);
 }
\ No newline at end of file
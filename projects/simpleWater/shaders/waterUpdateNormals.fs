@@ -6,11 +6,15 @@
 // uniform: water height map values
 uniform sampler2D texture0;
 
-// uniform: size of a one texel
-uniform vec2 texelSize;
-
-// strength of the norma map in Z direction
-uniform float normalScale;
+// per surface simulation parameters, see uniformBlocks.h
+layout(std140) uniform WaterParams
+{
+	vec4  density;       // x - fade of velocity, y - gather factor, z - fade of height
+	vec2  texelSize;     // size of a one texel
+	float normalScale;   // strength of the normal map in Z direction
+	int   rainSeed;      // procedural rain: different for every step so that drops do not repeat
+	vec2  rainParams;    // procedural rain: x - probability of a drop in one texel, y - max pressure of a drop (0 - no rain)
+};
 
 // input: standard texture coord
 in vec2 vVaryingTexCoord0;
@@ -20,7 +24,7 @@ in vec2 vVaryingTexCoord0;
 in float vVaryingPressure;
 
 //
-// output: new normal in format XYZ, Y is the top...
+// output: new normal in format XYZ, Y is the top..., A - length (see waterNormalsDownsample.fs)
 //
 out vec4 vFragColor;
 
@@ -39,5 +43,5 @@ void main()
    
     // code in the form of color (values from 0 to 1):
     vFragColor.rgb = normal*0.5+vec3(0.5);
-    vFragColor.a = 0.0;
+    vFragColor.a = 1.0;     // length of the normal, lower in the mip levels
 }
\ No newline at end of file
@@ -8,7 +8,10 @@
 *   - shaders for water update
 *   - shaders for simple normal mapping light, on a quad with water texture
 *   - water is displayed as a quad (only four vertices) + normalmapping + some simple texture
-*   - there is no environment around
+*     or as a grid of patches that is tessellated (screen space LOD) and displaced by the water height
+*     or as a projected grid: screen space grid on an unbounded plane with the water tiled over it
+*   - simple environment (pool bottom, pillars) seen through the planar reflection and refraction targets,
+*     their resolution is scaled to hold a GPU time budget
 *
 *	@author Bartlomiej Filipek 
 */
@@ -21,10 +24,26 @@
 
 #include "Shader.h"
 #include "ShaderProgram.h"
-#include "shaderLoader.h"
+#include "ShaderLoader.h"
+#include "ProgramCache.h"
 #include "TimeQuery.h"
+#include "GLState.h"
+#include "Frustum.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+#include "FrameCapture.h"
 
 #include "waterSurface.h"
+#include "waterReadback.h"
+#include "waterQuery.h"
+#include "waterBuoyancy.h"
+#include "waterSnapshot.h"
+#include "waterRecording.h"
+#include "waterMesh.h"
+#include "projectedGrid.h"
+#include "planarTarget.h"
+#include "environment.h"
+#include "uniformBlocks.h"
 
 
 using namespace std;
@@ -37,33 +56,128 @@ using namespace std;
 #define MEASURE_GL_TIME
 
 #ifdef MEASURE_GL_TIME
-TimerQuery gTimeQuery;
 float gWaterUpdateTime;
 #endif
+int gGridSize;
 
 // is aimation enabled?
 bool gAnimate;
 
+// GL calls sent/filtered by glState in the last frame:
+int gGLCallsIssued;
+int gGLCallsFiltered;
+
+// chunks of the tessellated mesh that passed the frustum test in the last frame:
+int gVisibleChunks;
+
+// levels of the normal map generated in the last step:
+int gNormalMipLevels;
+
 // water:
 struct SimpleWater
 {
     static const int GRID_SIZE = 512;
+    static const int PATCHES_PER_SIDE = 32;
+    static const int PATCHES_PER_CHUNK = 4;
+    static const int PROJECTED_GRID_COLUMNS = 160;
+    static const int PROJECTED_GRID_ROWS = 256;
+
+    enum MeshType
+    {
+        MESH_QUAD = 0,
+        MESH_TESSELLATED,
+        MESH_PROJECTED_GRID
+    };
 
     WaterSurface  mSurface;
     GLuint        mVaoSurface;
     GLuint        mVboSurface;
-    GLuint        mVaoRain;
-    GLuint        mVboRain;
     glm::vec4     mSurfaceColor;
-    GLuint        mTexture;
+    GLuint        mTexture;         //!< placeholder until the streamed texture is uploaded
+    TextureStreamer         mTextureStreamer;
+    TextureStreamer::Handle mTextureHandle;
     int           mRainProbability;
     float         mRainForce;
+    bool          mGpuRain;
     float		  mRefractionFactor;
     ShaderProgram mSurfaceShader;
     ShaderProgram mDebugShader;
+
+    // surface programs are built while the app already runs, the water is not drawn until they are ready:
+    shaderLoader::ProgramBatch mShaderBatch;
+    bool          mShadersReady;
+
+    // tessellated and displaced surface:
+    WaterMesh     mMesh;
+    ShaderProgram mSurfaceTessShader;
+    MeshType      mMeshType;
+    float         mHeightScale;
+    float         mTessEdgePixels;
+
+    // normals from the heights in the surface shader, the normals pass is skipped:
+    bool          mFusedNormals;
+    // mip chain of the normal map, only the levels that the view needs:
+    bool          mNormalMips;
+
+    // camera and surface blocks, updated every frame:
+    UniformBufferRing mFrameUniforms;
     bool          mRenderDebug;
+
+    // open sea, the surface is repeated:
+    ProjectedGrid mProjectedGrid;
+
+    // 's' saves the water state, 'l' restores it:
+    WaterSnapshotWriter mSnapshotWriter;
+    // 'r' records every step, 'p' replays the recording instead of simulating:
+    WaterRecorder mRecorder;
+    WaterPlayer   mPlayer;
 } gSimpleWater;
 
+const char *WATER_SNAPSHOT_FILE  = "water.snapshot";
+const char *WATER_RECORDING_FILE = "water.rec";
+// 'c' captures a clip of the window (fixed 60 steps per second):
+const char *CAPTURE_PREFIX = "capture";
+
+// planar reflection & refraction of the environment:
+struct PlanarWater
+{
+    Environment  mEnvironment;
+    PlanarTarget mReflection;
+    PlanarTarget mRefraction;
+    bool         mEnabled;
+    bool         mDynamicResolution;
+
+    // for the GUI:
+    float        mReflectionScale;
+    float        mRefractionScale;
+    float        mReflectionTime;
+    float        mRefractionTime;
+} gPlanar;
+
+// CPU copy of the water:
+struct CpuWater
+{
+    static const int DOWNSAMPLE_LEVEL = 1;
+
+    WaterReadback mReadback;
+    WaterQuery    mQuery;
+    bool          mEnabled;
+    int           mLatency;      // in simulation steps
+    float         mProbeHeight;  // water height in the middle of the surface
+} gCpuWater;
+
+// floating body that moves on a circle, forces are calculated on the GPU:
+struct FloatingBody
+{
+    static const int SAMPLES_PER_SIDE = 4;
+
+    WaterBuoyancy mBuoyancy;
+    glm::vec3     mPosition;
+    float         mSize;
+    bool          mEnabled;
+    glm::vec3     mForce;       // the latest result, a few frames late
+} gBody;
+
 //
 // transformations & camera
 //
@@ -72,13 +186,21 @@ glm::mat4 gModelViewMatrix;
 glm::mat3 gNormalMatrix;
 glm::mat4 gProjectionMatrix;
 
+// embeddedShaders.cpp, generated by tools/embedShaders.py
+void registerEmbeddedShaders();
+
+#ifndef USE_HEADLESS_EGL
+// the variables of AntTweakBar, not in the headless build
+void initTweakBar();
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 bool initApp() 
 {
     // 
     // bacis OpenGL init
     //
-    glEnable(GL_DEPTH_TEST);
+    glState::setDepthTest(true);
     glClearColor(0.2f, 0.3f, 0.5f, 0.0f);
 
     // random...
@@ -90,35 +212,51 @@ bool initApp()
     gCamPos = glm::vec3(0.0f, 2.0f, 2.0f);
 
     //
-    // shaders
+    // shaders, sources are in the executable (files in shaders/ override them in debug builds),
+    // binaries of the linked programs are kept between runs
     //
-    if (!shaderLoader::loadAndBuildShaderPairFromFile(&gSimpleWater.mSurfaceShader, "shaders/renderSurface.vs", "shaders/renderSurface.fs"))
+    registerEmbeddedShaders();
+    programCache::init("shaderCache");
+    shaderLoader::initParallelCompile();
+
+    // only submitted here, see surfaceShadersReady()
+    gSimpleWater.mShadersReady = false;
+    if (!gSimpleWater.mShaderBatch.add(&gSimpleWater.mSurfaceShader, "shaders/renderSurface.vs", NULL, NULL, NULL, "shaders/renderSurface.fs") ||
+        !gSimpleWater.mShaderBatch.add(&gSimpleWater.mDebugShader, "shaders/renderSurfaceDebug.vs", NULL, NULL, NULL, "shaders/renderSurfaceDebug.fs") ||
+        !gSimpleWater.mShaderBatch.add(&gSimpleWater.mSurfaceTessShader, "shaders/renderSurfaceTess.vs", "shaders/renderSurfaceTess.tcs", 
+                                       "shaders/renderSurfaceTess.tes", NULL, "shaders/renderSurface.fs"))
     {
+        gSimpleWater.mShaderBatch.finish();
         return false;
     }
 
-    if (!shaderLoader::loadAndBuildShaderPairFromFile(&gSimpleWater.mDebugShader, "shaders/renderSurfaceDebug.vs", "shaders/renderSurfaceDebug.fs"))
-    {
+    // reflected camera, camera and one surface per frame
+    if (gSimpleWater.mFrameUniforms.init(3, std::max(sizeof(uniformBlocks::Camera), sizeof(uniformBlocks::Surface))) == false)
         return false;
-    }
-
-#ifdef _DEBUG
-    gSimpleWater.mSurfaceShader.validate();
-    gSimpleWater.mDebugShader.validate();
-#endif
 
     //
     // texture
     //
-    gSimpleWater.mTexture = SOIL_load_OGL_texture("data/checkerboard.jpg", SOIL_LOAD_AUTO,
-        SOIL_CREATE_NEW_ID,
-        SOIL_FLAG_GL_MIPMAPS | SOIL_FLAG_INVERT_Y);
-    if (gSimpleWater.mTexture == 0)
+    if (gSimpleWater.mTextureStreamer.init() == false)
     {
-        LOG_ERROR("cannot load water texture!");
+        LOG_ERROR("cannot create the texture streamer!");
         return false;
     }
 
+    // pre-compressed version (BCn with mipmaps) is ready at once, otherwise the jpg is 
+    // decoded in the background and the placeholder is drawn for the first few frames
+    gSimpleWater.mTexture = textureLoader::loadCompressedTexture("data/checkerboard.dds");
+    if (gSimpleWater.mTexture == 0)
+        gSimpleWater.mTexture = textureLoader::loadCompressedTexture("data/checkerboard.ktx");
+
+    if (gSimpleWater.mTexture != 0)
+        gSimpleWater.mTextureHandle = TextureStreamer::INVALID_HANDLE;
+    else
+    {
+        gSimpleWater.mTextureHandle = gSimpleWater.mTextureStreamer.request("data/checkerboard.jpg", true, true);
+        gSimpleWater.mTexture       = gSimpleWater.mTextureStreamer.texture(gSimpleWater.mTextureHandle);
+    }
+
     //
     // water simulation
     //
@@ -127,6 +265,18 @@ bool initApp()
         LOG_ERROR("Cannot init water surface simulation");
         return false;
     }
+
+    if (gBody.mBuoyancy.init(1, FloatingBody::SAMPLES_PER_SIDE*FloatingBody::SAMPLES_PER_SIDE) == false)
+    {
+        LOG_ERROR("Cannot init buoyancy");
+        return false;
+    }
+
+    if (gCpuWater.mReadback.init(gSimpleWater.mSurface, CpuWater::DOWNSAMPLE_LEVEL) == false)
+    {
+        LOG_ERROR("Cannot init water readback");
+        return false;
+    }
     //
     // water geometry
     //
@@ -156,11 +306,11 @@ bool initApp()
     // VAO setup
     //
     glGenVertexArrays(1, &gSimpleWater.mVaoSurface); 
-    glBindVertexArray(gSimpleWater.mVaoSurface);
+    glState::bindVertexArray(gSimpleWater.mVaoSurface);
 
     // vbo:
     glGenBuffers(1, &gSimpleWater.mVboSurface);
-    glBindBuffer(GL_ARRAY_BUFFER, gSimpleWater.mVboSurface);
+    glState::bindBuffer(GL_ARRAY_BUFFER, gSimpleWater.mVboSurface);
     glBufferData(GL_ARRAY_BUFFER, STRIDE * 4, quadData, GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
@@ -170,73 +320,216 @@ bool initApp()
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*6));
 
-    //
-    // VAO for Rain
-    //
-    glGenVertexArrays(1, &gSimpleWater.mVaoRain); 
-    glBindVertexArray(gSimpleWater.mVaoRain);
+    glState::bindVertexArray(0);
 
-    // vbo:
-    glGenBuffers(1, &gSimpleWater.mVboRain);
-    glBindBuffer(GL_ARRAY_BUFFER, gSimpleWater.mVboRain);
-    glBufferData(GL_ARRAY_BUFFER, 3 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    if (gSimpleWater.mMesh.init(SimpleWater::PATCHES_PER_SIDE, SimpleWater::PATCHES_PER_CHUNK) == false)
+    {
+        LOG_ERROR("Cannot init water mesh");
+        return false;
+    }
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STRIDE, (const void *)0);
+    if (gSimpleWater.mProjectedGrid.init(SimpleWater::PROJECTED_GRID_COLUMNS, SimpleWater::PROJECTED_GRID_ROWS) == false)
+    {
+        LOG_ERROR("Cannot init projected grid");
+        return false;
+    }
+
+    //
+    // environment & planar targets, the budgets are for a mid range GPU
+    //
+    if (gPlanar.mEnvironment.init() == false)
+    {
+        LOG_ERROR("Cannot init environment");
+        return false;
+    }
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gPlanar.mReflection.mScaler.mBudget = 1.5f;
+    gPlanar.mRefraction.mScaler.mBudget = 1.0f;
+    if (gPlanar.mReflection.init(Globals::sMainWindowWidth, Globals::sMainWindowHeight) == false ||
+        gPlanar.mRefraction.init(Globals::sMainWindowWidth, Globals::sMainWindowHeight) == false)
+    {
+        LOG_ERROR("Cannot init planar targets");
+        return false;
+    }
 
     //
-    // GUI & HUD & Timer
+    // default settings, the tweak bar (initTweakBar) only shows them
     //
+    gGLCallsIssued = gGLCallsFiltered = 0;
+    gAnimate = true;
+
+    gSimpleWater.mRenderDebug = false;
+    gSimpleWater.mSurfaceColor = glm::vec4(0.2f, 0.5f, 0.99f, 1.0f);
+    gSimpleWater.mRainProbability = 50;
+    gSimpleWater.mRainForce = 0.5f;
+    gSimpleWater.mGpuRain = false;
+    gSimpleWater.mRefractionFactor = 0.05f;
 
+    gSimpleWater.mMeshType = SimpleWater::MESH_TESSELLATED;
+    gVisibleChunks = 0;
+
+    gSimpleWater.mSurface.mDynamicResolution = false;
+    gSimpleWater.mSurface.mMinSize = SimpleWater::GRID_SIZE / 4;
+    gSimpleWater.mSurface.mMaxSize = SimpleWater::GRID_SIZE * 2;
+    gGridSize = SimpleWater::GRID_SIZE;
+
+    gSimpleWater.mHeightScale = 0.05f;
+    gSimpleWater.mFusedNormals = false;
+    gSimpleWater.mNormalMips = true;
+    gNormalMipLevels = 1;
+    gSimpleWater.mTessEdgePixels = 16.0f;
+
+    gPlanar.mEnabled = true;
+    gPlanar.mDynamicResolution = true;
+    gPlanar.mReflectionScale = gPlanar.mRefractionScale = 1.0f;
+    gPlanar.mReflectionTime  = gPlanar.mRefractionTime  = 0.0f;
+
+    gCpuWater.mEnabled = false;
+    gCpuWater.mLatency = 0;
+    gCpuWater.mProbeHeight = 0.0f;
+
+    gBody.mEnabled = false;
+    gBody.mSize = 0.1f;
+    gBody.mForce = glm::vec3(0.0f);
+
+#ifndef USE_HEADLESS_EGL
+    initTweakBar();
+#endif
+
+    return true;
+}
+
+#ifndef USE_HEADLESS_EGL
+///////////////////////////////////////////////////////////////////////////////
+// GUI & HUD & Timer
+void initTweakBar()
+{
 #ifdef MEASURE_GL_TIME
-    gTimeQuery.init();
     TwAddVarRO(Globals::sMainTweakBar, "water update (ms)", TW_TYPE_FLOAT, &gWaterUpdateTime, NULL);
 #endif
 
-    TwAddSeparator(Globals::sMainTweakBar, "", "");		
+    TwAddVarRO(Globals::sMainTweakBar, "GL state calls", TW_TYPE_INT32, &gGLCallsIssued, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "GL redundant calls", TW_TYPE_INT32, &gGLCallsFiltered, NULL);
 
-    TwAddVarRW(Globals::sMainTweakBar, "camera", TW_TYPE_DIR3F, &gCamPos[0], "");
+    TwAddSeparator(Globals::sMainTweakBar, "", "");
 
-    TwAddSeparator(Globals::sMainTweakBar, "", "");		
+    TwAddVarRW(Globals::sMainTweakBar, "camera", TW_TYPE_DIR3F, &gCamPos[0], "");
 
-    gAnimate = true;
-    TwAddVarRW(Globals::sMainTweakBar, "animate", TW_TYPE_BOOLCPP, &gAnimate, NULL);		
+    TwAddSeparator(Globals::sMainTweakBar, "", "");
 
-    gSimpleWater.mRenderDebug = false;
+    TwAddVarRW(Globals::sMainTweakBar, "animate", TW_TYPE_BOOLCPP, &gAnimate, NULL);
     TwAddVarRW(Globals::sMainTweakBar, "draw debug", TW_TYPE_BOOLCPP, &gSimpleWater.mRenderDebug, NULL);
-
-    gSimpleWater.mSurfaceColor = glm::vec4(0.2f, 0.5f, 0.99f, 1.0f);
     TwAddVarRW(Globals::sMainTweakBar, "water color", TW_TYPE_COLOR4F, glm::value_ptr(gSimpleWater.mSurfaceColor), NULL);
-
-    gSimpleWater.mRainProbability = 50;
     TwAddVarRW(Globals::sMainTweakBar, "rain probability", TW_TYPE_INT32, &gSimpleWater.mRainProbability, "min=0 max=100");
-
-    gSimpleWater.mRainForce = 0.5f;
     TwAddVarRW(Globals::sMainTweakBar, "rain force", TW_TYPE_FLOAT, &gSimpleWater.mRainForce, "min=0.0 max=2.0 step=0.01");
-
-    gSimpleWater.mRefractionFactor = 0.05f;
+    TwAddVarRW(Globals::sMainTweakBar, "GPU rain", TW_TYPE_BOOLCPP, &gSimpleWater.mGpuRain, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "GPU rain drops", TW_TYPE_DOUBLE, &gSimpleWater.mSurface.mRainDropsPerStep, "min=0.0 max=10000.0 step=0.5");
     TwAddVarRW(Globals::sMainTweakBar, "refraction", TW_TYPE_FLOAT, &gSimpleWater.mRefractionFactor, "min=0.0 max=1.0 step=0.005");
-
     TwAddVarRW(Globals::sMainTweakBar, "normal scale", TW_TYPE_DOUBLE, &gSimpleWater.mSurface.mNormalScale, "min=0.05 max=5.0 step=0.05");
     TwAddVarRW(Globals::sMainTweakBar, "offset scale", TW_TYPE_DOUBLE, &gSimpleWater.mSurface.mOffsetScale, "min=0.5 max=5.0 step=0.05");
 
-    return true;
+    TwEnumVal meshTypes[] = { { SimpleWater::MESH_QUAD,           "quad" }, 
+                              { SimpleWater::MESH_TESSELLATED,    "tessellated" }, 
+                              { SimpleWater::MESH_PROJECTED_GRID, "projected grid" } };
+    TwType meshType = TwDefineEnum("MeshType", meshTypes, 3);
+    TwAddVarRW(Globals::sMainTweakBar, "surface mesh", meshType, &gSimpleWater.mMeshType, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "visible chunks", TW_TYPE_INT32, &gVisibleChunks, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "sea tile scale", TW_TYPE_FLOAT, &gSimpleWater.mProjectedGrid.mTileScale, "min=0.01 max=4.0 step=0.01");
+
+    TwAddVarRW(Globals::sMainTweakBar, "dynamic grid", TW_TYPE_BOOLCPP, &gSimpleWater.mSurface.mDynamicResolution, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "grid budget (ms)", TW_TYPE_DOUBLE, &gSimpleWater.mSurface.mStepBudget, "min=0.05 max=10.0 step=0.05");
+    TwAddVarRO(Globals::sMainTweakBar, "grid size", TW_TYPE_INT32, &gGridSize, NULL);
+
+    TwAddVarRW(Globals::sMainTweakBar, "height scale", TW_TYPE_FLOAT, &gSimpleWater.mHeightScale, "min=0.0 max=0.5 step=0.005");
+    TwAddVarRW(Globals::sMainTweakBar, "fused normals", TW_TYPE_BOOLCPP, &gSimpleWater.mFusedNormals, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "normal mipmaps", TW_TYPE_BOOLCPP, &gSimpleWater.mNormalMips, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "normal mip levels", TW_TYPE_INT32, &gNormalMipLevels, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "tess edge (px)", TW_TYPE_FLOAT, &gSimpleWater.mTessEdgePixels, "min=2.0 max=128.0 step=1.0");
+
+    TwAddSeparator(Globals::sMainTweakBar, "", "");
+
+    TwAddVarRW(Globals::sMainTweakBar, "planar reflections", TW_TYPE_BOOLCPP, &gPlanar.mEnabled, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "dynamic resolution", TW_TYPE_BOOLCPP, &gPlanar.mDynamicResolution, NULL);
+    TwAddVarRW(Globals::sMainTweakBar, "reflection budget (ms)", TW_TYPE_FLOAT, &gPlanar.mReflection.mScaler.mBudget, "min=0.1 max=10.0 step=0.1");
+    TwAddVarRW(Globals::sMainTweakBar, "refraction budget (ms)", TW_TYPE_FLOAT, &gPlanar.mRefraction.mScaler.mBudget, "min=0.1 max=10.0 step=0.1");
+    TwAddVarRO(Globals::sMainTweakBar, "reflection scale", TW_TYPE_FLOAT, &gPlanar.mReflectionScale, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "refraction scale", TW_TYPE_FLOAT, &gPlanar.mRefractionScale, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "reflection (ms)", TW_TYPE_FLOAT, &gPlanar.mReflectionTime, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "refraction (ms)", TW_TYPE_FLOAT, &gPlanar.mRefractionTime, NULL);
+
+    TwAddSeparator(Globals::sMainTweakBar, "", "");
+
+    TwAddVarRW(Globals::sMainTweakBar, "CPU readback", TW_TYPE_BOOLCPP, &gCpuWater.mEnabled, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "readback latency (steps)", TW_TYPE_INT32, &gCpuWater.mLatency, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "probe height", TW_TYPE_FLOAT, &gCpuWater.mProbeHeight, NULL);
+
+    TwAddVarRW(Globals::sMainTweakBar, "floating body", TW_TYPE_BOOLCPP, &gBody.mEnabled, NULL);
+    TwAddVarRO(Globals::sMainTweakBar, "body force", TW_TYPE_DIR3F, &gBody.mForce[0], NULL);
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 void cleanUp()
 {
 #ifdef MEASURE_GL_TIME    
-    LOG("Water average GPU time spent on update: %f ms", gTimeQuery.getAverageTime());
+    LOG("Water GPU time spent on update: %f ms", gSimpleWater.mSurface.stepTime());
 #endif
 
     glDeleteBuffers(1, &gSimpleWater.mVboSurface);
     glDeleteVertexArrays(1, &gSimpleWater.mVaoSurface);
-    glDeleteBuffers(1, &gSimpleWater.mVboRain);
-    glDeleteVertexArrays(1, &gSimpleWater.mVaoRain);
+
+    // workers have to be joined while the context is still alive
+    gSimpleWater.mTextureStreamer.shutdown();
+    gSimpleWater.mSnapshotWriter.finish();
+    gSimpleWater.mRecorder.stop();
+    gSimpleWater.mPlayer.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initApp falls back to the jpg, so a DDS/KTX that does not parse would go unnoticed there
+bool checkCompressedTexture(const char *fileName, GLint size, GLint levels)
+{
+    const GLuint texId = textureLoader::loadCompressedTexture(fileName);
+    if (texId == 0)
+    {
+        LOG_ERROR("%s is not loaded", fileName);
+        return false;
+    }
+
+    GLint width = 0, height = 0, compressed = 0, maxLevel = 0, lastWidth = 0;
+    glState::bindTexture(GL_TEXTURE_2D, texId);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, levels - 1, GL_TEXTURE_WIDTH, &lastWidth);
+    glState::bindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texId);
+
+    if (width != size || height != size || !compressed || maxLevel != levels - 1 || lastWidth != 1)
+    {
+        LOG_ERROR("%s: %dx%d with %d levels, expected %dx%d compressed with %d", fileName, width, height, maxLevel + 1, size, size, levels);
+        return false;
+    }
+
+    LOG_SUCCESS("%s: ok", fileName);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool runChecks()
+{
+    bool ok = true;
+
+    // written by tools/makeCheckerboardDds.py
+    if (checkCompressedTexture("data/checkerboard.dds", 256, 9) == false)
+        ok = false;
+
+    // the surface is resized twice and read back, so this is not done in initApp
+    if (waterSnapshot::checkResizedRestore(&gSimpleWater.mSurface, "check.snapshot") == false)
+        ok = false;
+
+    return ok;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -244,15 +537,51 @@ void processNormalKeys(unsigned char key, int x, int y)
 {
     if (key == 27) 
         exit(0);
+
+    // checkpoint of the water, restored without re-simulating from a flat surface
+    if (key == 's')
+    {
+        if (gSimpleWater.mSnapshotWriter.request(gSimpleWater.mSurface, WATER_SNAPSHOT_FILE) == false)
+            LOG("previous water snapshot is still being saved");
+    }
+    else if (key == 'l')
+        waterSnapshot::load(WATER_SNAPSHOT_FILE, &gSimpleWater.mSurface);
+    else if (key == 'r')
+    {
+        if (gSimpleWater.mRecorder.isRecording())
+            gSimpleWater.mRecorder.stop();
+        else
+            gSimpleWater.mRecorder.start(gSimpleWater.mSurface, WATER_RECORDING_FILE);
+    }
+    else if (key == 'c')
+    {
+        FrameCapture *capture = Globals::sFrameCapture;
+        if (capture->isCapturing())
+            capture->stop();
+        else
+            capture->start(CAPTURE_PREFIX, FrameCapture::Format::Y4M, Globals::sMainWindowWidth, Globals::sMainWindowHeight);
+    }
+    else if (key == 'p')
+    {
+        if (gSimpleWater.mPlayer.isOpen())
+            gSimpleWater.mPlayer.close();
+        else
+        {
+            gSimpleWater.mRecorder.stop();
+            gSimpleWater.mPlayer.open(WATER_RECORDING_FILE);
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void pressSpecialKey(int key, int x, int y) 
 {
+#ifndef USE_HEADLESS_EGL
     if (key == GLUT_KEY_UP)
         gCamPos[2] += 0.1f;
     else if (key == GLUT_KEY_DOWN)
         gCamPos[2] -= 0.1f;
+#endif
 }
 
 
@@ -286,10 +615,52 @@ void changeSize(int w, int h)
     float aspect = (float)w/(float)h;
 
     // Set the viewport to be the entire window
-    glViewport(0, 0, w, h);
+    glState::viewport(0, 0, w, h);
 
     // setup projection matrix
     gProjectionMatrix = glm::perspective(45.0f, aspect, 0.1f, 100.0f);
+
+    gPlanar.mReflection.setScreenSize(w, h);
+    gPlanar.mRefraction.setScreenSize(w, h);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// mip levels of the normal map that the camera needs: texels per pixel at the farthest
+// visible point of the water, where the view is also the most grazing
+GLuint normalMipLevelsForView()
+{
+    const WaterSurface &surface = gSimpleWater.mSurface;
+
+    // world size of one texel and the farthest point
+    float texelSize = 2.0f / (float)surface.width();
+    float farthest  = 0.0f;
+    if (gSimpleWater.mMeshType == SimpleWater::MESH_PROJECTED_GRID)
+    {
+        texelSize /= gSimpleWater.mProjectedGrid.mTileScale;
+        farthest   = gSimpleWater.mProjectedGrid.mMaxDistance;
+    }
+    else
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            glm::vec3 corner((i & 1) ? 1.0f : -1.0f, 0.0f, (i & 2) ? 1.0f : -1.0f);
+            farthest = std::max(farthest, glm::length(corner - gCamPos));
+        }
+    }
+
+    int viewport[4];
+    glState::getViewport(viewport);
+
+    // projection[1][1] = 1/tan(fov/2), 1/cos of the view angle = distance/height
+    const float pixelSize  = 2.0f * farthest / (gProjectionMatrix[1][1] * (float)std::max(viewport[3], 1));
+    const float grazing    = farthest / std::max(fabsf(gCamPos.y), 0.01f);
+    const float texelRatio = pixelSize * grazing / texelSize;
+
+    GLuint levels = 1;
+    for (float r = texelRatio; r > 1.0f && levels < surface.maxNormalMipLevels(); r *= 0.5f)
+        levels++;
+
+    return levels;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -306,38 +677,228 @@ void updateScene(double deltaTime)
     float px = sinf(objAngle);
     float py = cosf(objAngle); 
 
+    // nothing is queued for the surface during the replay, the steps come from the file
+    const bool replaying = gSimpleWater.mPlayer.isOpen();
+
+    // with GPU rain nothing has to be queued
+    gSimpleWater.mSurface.mProceduralRain = gSimpleWater.mGpuRain;
+    gSimpleWater.mSurface.mRainPressure   = gSimpleWater.mRainForce > 0.01f ? gSimpleWater.mRainForce * 5.0f : 0.0f;
+
+    if (!replaying && !gSimpleWater.mGpuRain && gSimpleWater.mRainForce > 0.01f && gSimpleWater.mRainProbability > rand()%100)
+    {
+        gSimpleWater.mSurface.addDrop(utils::randFloatRange(-1.0f, 1.0f),                            // pos X (from -1 to 1)
+                                      utils::randFloatRange(-1.0f, 1.0f),                            // pos Y (from -1 to 1)
+                                      utils::randFloatRange(0.5f, 1.0f) * gSimpleWater.mRainForce * 5.0f);  // pressure
+    }
+
+    // the body pushes the water away, volume comes from the latest (delayed) buoyancy force
+    if (gBody.mEnabled && !replaying)
+    {
+        gBody.mPosition = glm::vec3(px * 0.5f, -0.5f * gBody.mSize, py * 0.5f);
+
+        // the body floats on the same displaced water that is rendered
+        gBody.mBuoyancy.mHeightScale = gSimpleWater.mHeightScale;
+
+        const WaterBuoyancy &b = gBody.mBuoyancy;
+        float submergedVolume = gBody.mForce.y / b.mDensityGravity;
+        // world rect is -1..1, the same as the surface, only the height has to be scaled
+        gSimpleWater.mSurface.addBodyFootprint(gBody.mPosition.x, gBody.mPosition.z, 0.5f * gBody.mSize, submergedVolume / b.mHeightScale);
+    }
+
+    // the open sea repeats the surface, so the water has to flow over the edges
+    gSimpleWater.mSurface.setTileable(gSimpleWater.mMeshType == SimpleWater::MESH_PROJECTED_GRID);
+    gSimpleWater.mSurface.setNormalMapEnabled(!gSimpleWater.mFusedNormals);
+    if (gSimpleWater.mNormalMips)
+        gSimpleWater.mSurface.setNormalMipLevels(normalMipLevelsForView());
+    else
+        gSimpleWater.mSurface.setNormalMipLevels(1);
+    gNormalMipLevels = (int)gSimpleWater.mSurface.normalMipLevels();
+
+    if (replaying)
+    {
+        // the previous step stays when the next one is not decoded yet
+        gSimpleWater.mPlayer.nextFrame(&gSimpleWater.mSurface);
+        if (gSimpleWater.mPlayer.ended())
+            gSimpleWater.mPlayer.close();
+    }
+    else
+    {
+        gSimpleWater.mSurface.beginUpdate(); 
+        gSimpleWater.mSurface.endUpdate();
+        gSimpleWater.mRecorder.record(gSimpleWater.mSurface);
+    }
+
 #ifdef MEASURE_GL_TIME    
-    gTimeQuery.begin();
+    // measured by the surface without waiting, the same timer drives the dynamic resolution
+    gWaterUpdateTime = (float)gSimpleWater.mSurface.stepTime();
 #endif
+    gGridSize = (int)gSimpleWater.mSurface.width();
 
-    gSimpleWater.mSurface.beginUpdate(); 
+    //
+    // buoyancy of the floating body, it is a few steps late
+    //
+    if (gBody.mEnabled)
     {
-        if (gSimpleWater.mRainForce > 0.01f && gSimpleWater.mRainProbability > rand()%100)
+        BuoyancySample samples[FloatingBody::SAMPLES_PER_SIDE*FloatingBody::SAMPLES_PER_SIDE];
+        const float step = gBody.mSize / FloatingBody::SAMPLES_PER_SIDE;
+        for (int z = 0; z < FloatingBody::SAMPLES_PER_SIDE; ++z)
         {
-            glPointSize(1.5f);
-            float rainDrop[3] = { utils::randFloatRange(-1.0f, 1.0f),			                         // pos X (from -1 to 1)
-                utils::randFloatRange(-1.0f, 1.0f),                                    // pos Y (from -1 to 1)
-                utils::randFloatRange(0.5f, 1.0f) * gSimpleWater.mRainForce * 5.0f };  // pressure
-
-            glBindVertexArray(gSimpleWater.mVaoRain);
-            glBindBuffer(GL_ARRAY_BUFFER, gSimpleWater.mVboRain);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, 3*sizeof(float), rainDrop);
-            glDrawArrays(GL_POINTS, 0, 1);
-            glBindVertexArray(0);
-        }      
-    }    
-    gSimpleWater.mSurface.endUpdate();
+            for (int x = 0; x < FloatingBody::SAMPLES_PER_SIDE; ++x)
+            {
+                BuoyancySample &s = samples[z*FloatingBody::SAMPLES_PER_SIDE + x];
+                s.mArm      = glm::vec3((x + 0.5f)*step - 0.5f*gBody.mSize, 0.0f, (z + 0.5f)*step - 0.5f*gBody.mSize);
+                s.mPosition = gBody.mPosition + s.mArm;
+                s.mArea     = step*step;
+                s.mBody     = 0.0f;
+            }
+        }
+
+        gBody.mBuoyancy.setSamples(samples, FloatingBody::SAMPLES_PER_SIDE*FloatingBody::SAMPLES_PER_SIDE);
+        gBody.mBuoyancy.calculate(gSimpleWater.mSurface);
+        if (gBody.mBuoyancy.update())
+            gBody.mForce = glm::vec3(gBody.mBuoyancy.force(0));
+    }
 
-#ifdef MEASURE_GL_TIME    
-    gTimeQuery.end();
-    gTimeQuery.updateResults(TimerQuery::WaitOption::WaitForResults);
-    gWaterUpdateTime = (float)gTimeQuery.getTime();
+    //
+    // copy of the water on the CPU, it is a few steps late
+    //
+    if (gCpuWater.mEnabled)
+    {
+        gCpuWater.mReadback.requestAll(gSimpleWater.mSurface);
+        if (gCpuWater.mReadback.update())
+        {
+            gCpuWater.mLatency = (int)(gSimpleWater.mSurface.step() - gCpuWater.mReadback.heightField().mStep);
+
+            glm::vec2 probePos(0.0f, 0.0f);
+            WaterSample probe;
+            gCpuWater.mQuery.setNormalScale(gSimpleWater.mSurface.normalScale());
+            gCpuWater.mQuery.sample(gCpuWater.mReadback.heightField(), &probePos, 1, &probe);
+            gCpuWater.mProbeHeight = probe.mHeight;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// finishes the surface programs that the driver has compiled, sets their uniforms when all are done
+bool surfaceShadersReady()
+{
+    if (gSimpleWater.mShadersReady)
+        return true;
+
+    if (gSimpleWater.mShaderBatch.poll() == false)
+        return false;
+
+    if (gSimpleWater.mShaderBatch.failed())
+    {
+        LOG_ERROR("cannot build the surface shaders!");
+        mainQuit();
+        return false;
+    }
+
+    gSimpleWater.mSurfaceShader.use();
+    gSimpleWater.mSurfaceShader.uniform1i("texture0", 0);
+    gSimpleWater.mSurfaceShader.uniform1i("normalMap", 1);
+    gSimpleWater.mSurfaceShader.uniform1i("heightMap", 2);
+    gSimpleWater.mSurfaceShader.uniform1i("reflectionMap", 3);
+    gSimpleWater.mSurfaceShader.uniform1i("refractionMap", 4);
+    gSimpleWater.mSurfaceShader.uniformBlockBinding("Camera", uniformBlocks::CAMERA_BINDING);
+    gSimpleWater.mSurfaceShader.uniformBlockBinding("SurfaceParams", uniformBlocks::SURFACE_BINDING);
+
+    gSimpleWater.mDebugShader.use();
+    gSimpleWater.mDebugShader.uniform1i("texture0", 0);
+    gSimpleWater.mDebugShader.uniformBlockBinding("Camera", uniformBlocks::CAMERA_BINDING);
+
+    gSimpleWater.mSurfaceTessShader.use();
+    gSimpleWater.mSurfaceTessShader.uniform1i("texture0", 0);
+    gSimpleWater.mSurfaceTessShader.uniform1i("normalMap", 1);
+    gSimpleWater.mSurfaceTessShader.uniform1i("heightMap", 2);
+    gSimpleWater.mSurfaceTessShader.uniform1i("reflectionMap", 3);
+    gSimpleWater.mSurfaceTessShader.uniform1i("refractionMap", 4);
+    gSimpleWater.mSurfaceTessShader.uniformBlockBinding("Camera", uniformBlocks::CAMERA_BINDING);
+    gSimpleWater.mSurfaceTessShader.uniformBlockBinding("SurfaceParams", uniformBlocks::SURFACE_BINDING);
+    glState::useProgram(0);
+
+#ifdef _DEBUG
+    gSimpleWater.mSurfaceShader.validate();
+    gSimpleWater.mDebugShader.validate();
+    gSimpleWater.mSurfaceTessShader.validate();
 #endif
+
+    gSimpleWater.mShadersReady = true;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fillCamera(uniformBlocks::Camera *camera, const glm::mat4 &modelview)
+{
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelview)));
+
+    camera->mProjectionMatrix = gProjectionMatrix;
+    camera->mModelviewMatrix  = modelview;
+    camera->setNormalMatrix(normalMatrix);
+    camera->mLightPos         = glm::vec4(normalMatrix * glm::vec3(0.0f), 1.0f);
+
+    int viewport[4];
+    glState::getViewport(viewport);
+    camera->mViewport = glm::vec4((float)viewport[2], (float)viewport[3], 1.0f/(float)viewport[2], 1.0f/(float)viewport[3]);
+    camera->mInvViewProjection = glm::inverse(gProjectionMatrix * modelview);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reflection and refraction of the environment, the main camera block is bound at the end
+void renderPlanarTargets(const uniformBlocks::Camera &camera)
+{
+    // water level is 0, the planes are moved a bit so that there are no gaps at the waves
+    const float waterLevel = 0.0f;
+    const float clipOffset = 0.02f + 2.0f * gSimpleWater.mHeightScale;
+
+    gPlanar.mReflection.mDynamicResolution = gPlanar.mDynamicResolution;
+    gPlanar.mRefraction.mDynamicResolution = gPlanar.mDynamicResolution;
+    gPlanar.mReflection.update();
+    gPlanar.mRefraction.update();
+
+    //
+    // reflection: camera mirrored by the water plane, only what is above the water
+    //
+    const glm::mat4 mirror = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, waterLevel, 0.0f)) *
+                             glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f)) *
+                             glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -waterLevel, 0.0f));
+
+    uniformBlocks::Camera mirrored;
+    fillCamera(&mirrored, gModelViewMatrix * mirror);
+    gSimpleWater.mFrameUniforms.upload(uniformBlocks::CAMERA_BINDING, &mirrored, sizeof(mirrored));
+
+    gPlanar.mReflection.begin();
+    gPlanar.mEnvironment.draw(gSimpleWater.mTexture, glm::vec4(0.0f, 1.0f, 0.0f, -waterLevel + clipOffset));
+    gPlanar.mReflection.end();
+
+    //
+    // refraction: normal camera, only what is below the water
+    //
+    gSimpleWater.mFrameUniforms.upload(uniformBlocks::CAMERA_BINDING, &camera, sizeof(camera));
+
+    gPlanar.mRefraction.begin();
+    gPlanar.mEnvironment.draw(gSimpleWater.mTexture, glm::vec4(0.0f, -1.0f, 0.0f, waterLevel + clipOffset));
+    gPlanar.mRefraction.end();
+
+    gPlanar.mReflectionScale = gPlanar.mReflection.mScaler.scale();
+    gPlanar.mRefractionScale = gPlanar.mRefraction.mScaler.scale();
+    gPlanar.mReflectionTime  = (float)gPlanar.mReflection.gpuTime();
+    gPlanar.mRefractionTime  = (float)gPlanar.mRefraction.gpuTime();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void renderScene() 
 {
+    // a part of the pending textures every frame, even when the animation is paused
+    gSimpleWater.mTextureStreamer.update();
+    if (gSimpleWater.mTextureHandle != TextureStreamer::INVALID_HANDLE)
+        gSimpleWater.mTexture = gSimpleWater.mTextureStreamer.texture(gSimpleWater.mTextureHandle);
+    gSimpleWater.mSnapshotWriter.update();
+    gSimpleWater.mRecorder.update();
+
+    // the water update turns the depth test off
+    glState::setDepthTest(true);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     //
@@ -346,49 +907,83 @@ void renderScene()
     gModelViewMatrix = glm::lookAt(gCamPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     gNormalMatrix    = glm::transpose(glm::inverse(glm::mat3(gModelViewMatrix)));
 
+    uniformBlocks::Camera camera;
+    fillCamera(&camera, gModelViewMatrix);
+
+    gSimpleWater.mFrameUniforms.beginFrame();
+
+    const bool planar = gPlanar.mEnabled && gSimpleWater.mRenderDebug == false;
+    if (planar)
+        renderPlanarTargets(camera);
+    else
+        gSimpleWater.mFrameUniforms.upload(uniformBlocks::CAMERA_BINDING, &camera, sizeof(camera));
+
+    // the surface programs may be still compiling, the rest of the scene is drawn anyway
+    const bool shadersReady = surfaceShadersReady();
+
     // render something
     if (gSimpleWater.mRenderDebug == false)
     {
-        gSimpleWater.mSurfaceShader.use();
-
-        gSimpleWater.mSurfaceShader.uniformMatrix4f("projectionMatrix", glm::value_ptr(gProjectionMatrix));
-        gSimpleWater.mSurfaceShader.uniformMatrix3f("normalMatrix",     glm::value_ptr(gNormalMatrix));
-        gSimpleWater.mSurfaceShader.uniformMatrix4f("modelviewMatrix",  glm::value_ptr(gModelViewMatrix));
-        gSimpleWater.mSurfaceShader.uniform1i("texture0", 0);
-        gSimpleWater.mSurfaceShader.uniform1i("normalMap", 1);
-        glm::vec3 lightTemp = gNormalMatrix * glm::vec3(0.0f);
-        gSimpleWater.mSurfaceShader.uniform3fv("lightPos", glm::value_ptr(lightTemp));
-        gSimpleWater.mSurfaceShader.uniform4fv("waterColor", glm::value_ptr(gSimpleWater.mSurfaceColor));
-        gSimpleWater.mSurfaceShader.uniform1f("refractionFactor", gSimpleWater.mRefractionFactor);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gSimpleWater.mSurface.normalsTexName()); 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gSimpleWater.mTexture); 
-
-        glBindVertexArray(gSimpleWater.mVaoSurface);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        glBindVertexArray(0);
-
-        gSimpleWater.mSurfaceShader.disable();
+        gPlanar.mEnvironment.draw(gSimpleWater.mTexture);
+
+        uniformBlocks::Surface surface;
+        surface.mWaterColor       = gSimpleWater.mSurfaceColor;
+        surface.mRefractionFactor = gSimpleWater.mRefractionFactor;
+        surface.mHeightScale      = gSimpleWater.mHeightScale;
+        surface.mTessEdgePixels   = gSimpleWater.mTessEdgePixels;
+        surface.mFusedNormals     = gSimpleWater.mSurface.normalMapEnabled() ? 0 : 1;
+        surface.mHeightMapParams  = glm::vec4((float)gSimpleWater.mSurface.width(), (float)gSimpleWater.mSurface.height(), 
+                                              (float)gSimpleWater.mSurface.mOffsetScale, gSimpleWater.mSurface.normalScale());
+        surface.mPlanarTargets    = planar ? 1 : 0;
+        gSimpleWater.mFrameUniforms.upload(uniformBlocks::SURFACE_BINDING, &surface, sizeof(surface));
+
+        if (planar)
+        {
+            glState::bindTextureToUnit(4, GL_TEXTURE_2D, gPlanar.mRefraction.colorTexName()); 
+            glState::bindTextureToUnit(3, GL_TEXTURE_2D, gPlanar.mReflection.colorTexName()); 
+        }
+        glState::bindTextureToUnit(2, GL_TEXTURE_2D, gSimpleWater.mSurface.dataTexName()); 
+        glState::bindTextureToUnit(1, GL_TEXTURE_2D, gSimpleWater.mSurface.normalsTexName()); 
+        glState::bindTextureToUnit(0, GL_TEXTURE_2D, gSimpleWater.mTexture); 
+
+        if (shadersReady)
+        {
+            if (gSimpleWater.mMeshType == SimpleWater::MESH_TESSELLATED)
+            {
+                gSimpleWater.mSurfaceTessShader.use();
+                gSimpleWater.mMesh.draw(Frustum(gProjectionMatrix * gModelViewMatrix), gSimpleWater.mHeightScale);
+                gVisibleChunks = (int)gSimpleWater.mMesh.visibleChunks();
+            }
+            else if (gSimpleWater.mMeshType == SimpleWater::MESH_PROJECTED_GRID)
+            {
+                gSimpleWater.mProjectedGrid.draw(gProjectionMatrix, gModelViewMatrix);
+            }
+            else
+            {
+                gSimpleWater.mSurfaceShader.use();
+                glState::bindVertexArray(gSimpleWater.mVaoSurface);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            }
+        }
     }
-    else
+    else if (shadersReady)
     {
         gSimpleWater.mDebugShader.use();
 
-        gSimpleWater.mDebugShader.uniformMatrix4f("projectionMatrix", glm::value_ptr(gProjectionMatrix));
-        gSimpleWater.mDebugShader.uniformMatrix4f("modelviewMatrix",  glm::value_ptr(gModelViewMatrix));
-        gSimpleWater.mDebugShader.uniform1i("texture0", 0);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gSimpleWater.mSurface.normalsTexName()); 
+        // without the normal map show the heights
+        GLuint debugTex = gSimpleWater.mSurface.normalMapEnabled() ? gSimpleWater.mSurface.normalsTexName() : gSimpleWater.mSurface.dataTexName();
+        glState::bindTextureToUnit(0, GL_TEXTURE_2D, debugTex); 
 
-        glBindVertexArray(gSimpleWater.mVaoSurface);
+        glState::bindVertexArray(gSimpleWater.mVaoSurface);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        glBindVertexArray(0);
-
-        gSimpleWater.mDebugShader.disable();
     }
 
+    gSimpleWater.mFrameUniforms.endFrame();
+
+    // counts from the whole frame: update and render
+    gGLCallsIssued   = (int)glState::stats().mIssued;
+    gGLCallsFiltered = (int)glState::stats().mFiltered;
+    glState::resetStats();
+
     CHECK_OPENGL_ERRORS();
 }
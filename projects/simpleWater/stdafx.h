@@ -18,8 +18,10 @@
 
 // TODO: reference additional headers your program requires here
 #include "gl_core_4_2.h"
+#ifndef USE_HEADLESS_EGL
 #include "gl/gl.h"
 #include "freeglut.h"
+#endif
 #include "SOIL.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -0,0 +1,62 @@
+/** @file uniformBlocks.h
+*  @brief std140 uniform blocks shared by the shaders and the C++ code
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+/** layouts of the blocks must match the declarations in the shaders,
+* vec3 and mat3 are avoided (or padded) because of std140 rules
+*/
+namespace uniformBlocks
+{
+    /// binding points used with glBindBufferRange
+    enum Binding
+    {
+        CAMERA_BINDING       = 0,
+        SURFACE_BINDING      = 1,
+        WATER_PARAMS_BINDING = 2
+    };
+
+    /// "Camera", the same for all programs in the frame
+    struct Camera
+    {
+        glm::mat4 mProjectionMatrix;
+        glm::mat4 mModelviewMatrix;
+        glm::vec4 mNormalMatrix[3];    //!< mat3 in std140: every column is padded to vec4
+        glm::vec4 mLightPos;           //!< view space, w is not used
+        glm::vec4 mViewport;           //!< width, height, 1/width, 1/height
+        glm::mat4 mInvViewProjection;  //!< inverse(projection * modelview), clip space -> world space
+
+        void setNormalMatrix(const glm::mat3 &m)
+        {
+            for (int i = 0; i < 3; ++i)
+                mNormalMatrix[i] = glm::vec4(m[i], 0.0f);
+        }
+    };
+
+    /// "SurfaceParams", parameters of one rendered water surface
+    struct Surface
+    {
+        glm::vec4 mWaterColor;
+        float     mRefractionFactor;
+        float     mHeightScale;        //!< world units per one unit of the water height
+        float     mTessEdgePixels;     //!< tessellated mesh: wanted length of a triangle edge on the screen
+        int       mFusedNormals;       //!< 1 - normals are derived from the heights, there is no normal map
+        glm::vec4 mHeightMapParams;    //!< x, y - size of the height map, z - offset scale, w - normal scale
+        int       mPlanarTargets;      //!< 1 - reflection and refraction come from the planar targets
+        float     mPadding[3];
+    };
+
+    /// "WaterParams", simulation parameters of one WaterSurface
+    struct WaterParams
+    {
+        glm::vec4 mDensity;            //!< x - fade of velocity, y - gather factor, z - fade of height
+        glm::vec2 mTexelSize;
+        float     mNormalScale;
+        int       mRainSeed;
+        glm::vec2 mRainParams;         //!< x - probability of a drop in one texel, y - max pressure
+        float     mPadding[2];
+    };
+}
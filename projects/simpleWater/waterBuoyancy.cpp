@@ -0,0 +1,201 @@
+/** @file waterBuoyancy.cpp
+*  @brief buoyancy forces of floating bodies calculated on the GPU
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "Texture.h"
+#include "Framebuffer.h"
+#include "GLState.h"
+
+#include "waterSurface.h"
+#include "waterBuoyancy.h"
+
+///////////////////////////////////////////////////////////////////////////////
+WaterBuoyancy::WaterBuoyancy() :
+    mMaxBodies(0),
+    mMaxSamples(0),
+    mSampleCount(0),
+    mSamplesVBO(0),
+    mSamplesVAO(0),
+    mForcesTex(0),
+    mResultStep(0)
+{
+    mWaterLevel     = 0.0f;
+    mHeightScale    = 0.05f;
+    mDensityGravity = 9.81f;
+    mWorldRect      = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterBuoyancy::~WaterBuoyancy()
+{
+    glDeleteTextures(1, &mForcesTex);
+    glDeleteBuffers(1, &mSamplesVBO);
+    glDeleteVertexArrays(1, &mSamplesVAO);
+    glState::invalidate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterBuoyancy::init(GLuint maxBodies, GLuint maxSamples, GLuint ringSize)
+{
+    assert(maxBodies > 0 && maxSamples > 0);
+
+    mMaxBodies  = maxBodies;
+    mMaxSamples = maxSamples;
+    mSampleCount = 0;
+
+    mForces.assign(mMaxBodies, glm::vec4(0.0f));
+    mTorques.assign(mMaxBodies, glm::vec4(0.0f));
+
+    if (!shaderLoader::loadAndBuildShaderPairFromFile(&mForcesShader, "shaders/buoyancyForces.vs", "shaders/buoyancyForces.fs"))
+        return false;
+
+    mForcesShader.use();
+    mForcesShader.uniform1i("texture0", 0);
+    mWorldRectUniform   = mForcesShader.uniformHandle("worldRect");
+    mWaterParamsUniform = mForcesShader.uniformHandle("waterParams");
+    mNormalParamsUniform = mForcesShader.uniformHandle("normalParams");
+    mBodyCountUniform   = mForcesShader.uniformHandle("bodyCount");
+    mForcesShader.disable();
+
+    //
+    // sample points
+    //
+    const GLsizei STRIDE = sizeof(BuoyancySample);
+
+    glGenVertexArrays(1, &mSamplesVAO);
+    glState::bindVertexArray(mSamplesVAO);
+
+    glGenBuffers(1, &mSamplesVBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, mSamplesVBO);
+    glBufferData(GL_ARRAY_BUFFER, STRIDE * mMaxSamples, NULL, GL_STREAM_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, STRIDE, (const void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*4));
+
+    glState::bindVertexArray(0);
+
+    //
+    // forces target: row 0 - forces, row 1 - torques
+    //
+    mForcesTex = textureLoader::createEmptyTexture2D(mMaxBodies, 2, GL_RGBA32F, GL_RGBA, GL_FLOAT, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+    mFboForForces.createAndBind();
+    mFboForForces.attachTextureAsColorTarget(0, mForcesTex, mMaxBodies, 2, GL_TEXTURE_2D);
+    mFboForForces.setDrawBuffers();
+    bool complete = mFboForForces.check();
+    FrameBuffer::bindSystemFrameBuffer();
+
+    if (!complete)
+    {
+        LOG_ERROR("cannot create target for buoyancy forces!");
+        return false;
+    }
+
+    if (mReadback.init(ringSize, sizeof(glm::vec4) * 2 * mMaxBodies) == false)
+        return false;
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterBuoyancy::setSamples(const BuoyancySample *samples, GLuint count)
+{
+    assert(mSamplesVBO > 0 && "call init first!");
+
+    if (count > mMaxSamples)
+    {
+        LOG_ERROR("too many buoyancy samples (%d), max is %d", count, mMaxSamples);
+        count = mMaxSamples;
+    }
+
+    mSampleCount = count;
+    if (count == 0)
+        return;
+
+    // orphan the previous data so that we do not wait for the previous pass
+    glState::bindBuffer(GL_ARRAY_BUFFER, mSamplesVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BuoyancySample) * mMaxSamples, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BuoyancySample) * count, samples);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterBuoyancy::calculate(const WaterSurface &surface)
+{
+    if (mSampleCount == 0)
+        return;
+
+    int savedViewport[4];
+    glState::getViewport(savedViewport);
+
+    mFboForForces.bind(true);
+    const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, zero);
+
+    glState::setDepthTest(false);
+    glState::setBlend(true);
+    glState::blendFunc(GL_ONE, GL_ONE);
+
+    mForcesShader.use();
+    mForcesShader.uniform4f(mWorldRectUniform, mWorldRect.x, mWorldRect.y, 1.0f/(mWorldRect.z - mWorldRect.x), 1.0f/(mWorldRect.w - mWorldRect.y));
+    mForcesShader.uniform3f(mWaterParamsUniform, mWaterLevel, mHeightScale, mDensityGravity);
+    mForcesShader.uniform1f(mBodyCountUniform, (float)mMaxBodies);
+    mForcesShader.uniform3f(mNormalParamsUniform, (float)surface.mOffsetScale/(float)surface.width(), 
+                            (float)surface.mOffsetScale/(float)surface.height(), surface.normalScale());
+
+    // normals come from the heights, so the surface's normal map pass can be off
+    glState::bindTextureToUnit(0, GL_TEXTURE_2D, surface.dataTexName());
+
+    // instance 0 writes forces, instance 1 torques
+    glState::bindVertexArray(mSamplesVAO);
+    glDrawArraysInstanced(GL_POINTS, 0, mSampleCount, 2);
+
+    mForcesShader.disable();
+    glState::setBlend(false);
+
+    //
+    // request only the small forces texture
+    //
+    PixelReadback::Region region;
+    region.mWidth  = mMaxBodies;
+    region.mHeight = 2;
+    region.mTag    = surface.step();
+
+    glState::bindFramebuffer(GL_READ_FRAMEBUFFER, mFboForForces.getId());
+    mReadback.readPixels(region, GL_RGBA, GL_FLOAT);
+
+    // restore:
+    FrameBuffer::bindSystemFrameBuffer();
+    glState::viewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    CHECK_OPENGL_ERRORS();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterBuoyancy::update()
+{
+    bool newData = false;
+
+    PixelReadback::Region region;
+    const glm::vec4 *data = NULL;
+    while ((data = (const glm::vec4 *)mReadback.mapOldest(&region)) != NULL)
+    {
+        std::copy(data, data + mMaxBodies, mForces.begin());
+        std::copy(data + mMaxBodies, data + 2*mMaxBodies, mTorques.begin());
+        mResultStep = region.mTag;
+        newData = true;
+
+        mReadback.unmap();
+    }
+
+    return newData;
+}
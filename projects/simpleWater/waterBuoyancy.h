@@ -0,0 +1,86 @@
+/** @file waterBuoyancy.h
+*  @brief buoyancy forces of floating bodies calculated on the GPU
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include "Framebuffer.h"
+#include "PixelReadback.h"
+
+class WaterSurface;
+
+/** one sample point of a floating body, all in world space */
+struct BuoyancySample
+{
+    glm::vec3 mPosition;
+    float     mArea;       //!< part of the body's bottom that the sample represents
+    glm::vec3 mArm;        //!< mPosition - center of mass of the body
+    float     mBody;       //!< index of the body (stored as float, exact up to 2^24)
+};
+
+/** calculates buoyancy forces and torques of many bodies in one draw call
+*
+* every sample point reads the water height (and normal from the neighbouring heights) in the vertex shader and its force
+* is added (blending) to the texel of its body. Only that small texture (two rows:
+* forces and torques, bodyCount texels wide) is read back - asynchronously,
+* so the results are a few frames late.
+*/
+class WaterBuoyancy
+{
+private:
+    GLuint mMaxBodies;
+    GLuint mMaxSamples;
+    GLuint mSampleCount;
+
+    GLuint mSamplesVBO;
+    GLuint mSamplesVAO;
+
+    GLuint        mForcesTex;
+    FrameBuffer   mFboForForces;
+    ShaderProgram mForcesShader;
+    UniformHandle mWorldRectUniform;
+    UniformHandle mWaterParamsUniform;
+    UniformHandle mBodyCountUniform;
+    UniformHandle mNormalParamsUniform;
+
+    PixelReadback mReadback;
+
+    std::vector<glm::vec4> mForces;   //!< w - submerged area
+    std::vector<glm::vec4> mTorques;
+    GLuint mResultStep;
+public:
+    /// water level (world Y) for the zero height of the simulation
+    float mWaterLevel;
+    /// world units per one unit of water height
+    float mHeightScale;
+    /// fluid density * gravity
+    float mDensityGravity;
+    /// XZ rectangle covered by the water (min x, min z, max x, max z), default is -1..1 like the rendered quad
+    glm::vec4 mWorldRect;
+public:
+    WaterBuoyancy();
+    ~WaterBuoyancy();
+
+    bool init(GLuint maxBodies, GLuint maxSamples, GLuint ringSize = 3);
+
+    /// uploads sample points of all bodies for the next calculate() call
+    void setSamples(const BuoyancySample *samples, GLuint count);
+
+    /// runs the GPU pass and requests the readback, call it after WaterSurface::endUpdate
+    void calculate(const WaterSurface &surface);
+
+    /// collects finished readbacks, @return true if new forces arrived
+    bool update();
+
+    /// force of the body from the latest results, w - submerged area
+    const glm::vec4 &force(GLuint body) const  { return mForces[body]; }
+    const glm::vec4 &torque(GLuint body) const { return mTorques[body]; }
+    /// step of the water simulation the latest results come from
+    GLuint resultStep() const { return mResultStep; }
+private:
+    // block copying:
+    WaterBuoyancy(const WaterBuoyancy &);
+    WaterBuoyancy & operator=(const WaterBuoyancy &);
+};
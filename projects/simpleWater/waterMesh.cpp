@@ -0,0 +1,204 @@
+/** @file waterMesh.cpp
+*  @brief grid of patches for the tessellated water surface
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "Frustum.h"
+
+#include "waterMesh.h"
+
+///////////////////////////////////////////////////////////////////////////////
+WaterMesh::WaterMesh() :
+    mPatchesPerSide(0),
+    mIndexCount(0),
+    mVBO(0),
+    mIBO(0),
+    mVAO(0),
+    mVisibleChunks(0)
+{
+    mMaxWaterHeight = 4.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterMesh::~WaterMesh()
+{
+    destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterMesh::init(GLuint patchesPerSide, GLuint patchesPerChunk)
+{
+    assert(patchesPerSide > 0 && patchesPerChunk > 0);
+
+    destroy();
+
+    mPatchesPerSide = patchesPerSide;
+
+    //
+    // vertices, shared by the neighbouring patches
+    //
+    const GLuint vertsPerSide = mPatchesPerSide + 1;
+    std::vector<float> vertices;
+    vertices.reserve(vertsPerSide * vertsPerSide * 8);
+
+    for (GLuint z = 0; z < vertsPerSide; ++z)
+    {
+        const float v = (float)z / (float)mPatchesPerSide;
+        for (GLuint x = 0; x < vertsPerSide; ++x)
+        {
+            const float u = (float)x / (float)mPatchesPerSide;
+
+            vertices.push_back(u * 2.0f - 1.0f);   // pos
+            vertices.push_back(0.0f);
+            vertices.push_back(v * 2.0f - 1.0f);
+            vertices.push_back(0.0f);              // normal (up in Y direction)
+            vertices.push_back(1.0f);
+            vertices.push_back(0.0f);
+            vertices.push_back(u);                 // tex
+            vertices.push_back(v);
+        }
+    }
+
+    //
+    // patches: 0 - (u0, v0), 1 - (u1, v0), 2 - (u1, v1), 3 - (u0, v1)
+    // chunk after chunk, so that every chunk is one range of the index buffer
+    //
+    std::vector<GLuint> indices;
+    indices.reserve(mPatchesPerSide * mPatchesPerSide * 4);
+
+    const float patchSize = 2.0f / (float)mPatchesPerSide;
+    mChunks.clear();
+    for (GLuint cz = 0; cz < mPatchesPerSide; cz += patchesPerChunk)
+    {
+        for (GLuint cx = 0; cx < mPatchesPerSide; cx += patchesPerChunk)
+        {
+            const GLuint endX = std::min(cx + patchesPerChunk, mPatchesPerSide);
+            const GLuint endZ = std::min(cz + patchesPerChunk, mPatchesPerSide);
+
+            Chunk chunk;
+            chunk.mMin = glm::vec2(cx * patchSize - 1.0f, cz * patchSize - 1.0f);
+            chunk.mMax = glm::vec2(endX * patchSize - 1.0f, endZ * patchSize - 1.0f);
+            chunk.mFirstIndex = (GLuint)indices.size();
+
+            for (GLuint z = cz; z < endZ; ++z)
+            {
+                for (GLuint x = cx; x < endX; ++x)
+                {
+                    const GLuint first = z * vertsPerSide + x;
+                    indices.push_back(first);
+                    indices.push_back(first + 1);
+                    indices.push_back(first + 1 + vertsPerSide);
+                    indices.push_back(first + vertsPerSide);
+                }
+            }
+
+            chunk.mIndexCount = (GLsizei)(indices.size() - chunk.mFirstIndex);
+            mChunks.push_back(chunk);
+        }
+    }
+    mIndexCount = (GLuint)indices.size();
+    mVisibleChunks = (GLuint)mChunks.size();
+
+    const GLsizei STRIDE = sizeof(float)*8;
+
+    glGenVertexArrays(1, &mVAO);
+    glState::bindVertexArray(mVAO);
+
+    glGenBuffers(1, &mVBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    // element buffer binding is a part of the VAO state
+    glGenBuffers(1, &mIBO);
+    glState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STRIDE, (const void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*3));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*6));
+
+    glState::bindVertexArray(0);
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterMesh::draw()
+{
+    assert(mVAO > 0 && "call init first!");
+
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+
+    glState::bindVertexArray(mVAO);
+    glDrawElements(GL_PATCHES, mIndexCount, GL_UNSIGNED_INT, (const void *)0);
+
+    mVisibleChunks = (GLuint)mChunks.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterMesh::draw(const Frustum &frustum, float heightScale)
+{
+    assert(mVAO > 0 && "call init first!");
+
+    const float maxY = mMaxWaterHeight * heightScale;
+
+    //
+    // visible chunks, ranges that follow each other in the index buffer are merged
+    //
+    mDrawCounts.clear();
+    mDrawOffsets.clear();
+    mVisibleChunks = 0;
+
+    GLuint rangeEnd = 0;
+    for (size_t i = 0; i < mChunks.size(); ++i)
+    {
+        const Chunk &c = mChunks[i];
+        if (!frustum.isBoxVisible(glm::vec3(c.mMin.x, -maxY, c.mMin.y), glm::vec3(c.mMax.x, maxY, c.mMax.y)))
+            continue;
+
+        if (!mDrawCounts.empty() && rangeEnd == c.mFirstIndex)
+            mDrawCounts.back() += c.mIndexCount;
+        else
+        {
+            mDrawCounts.push_back(c.mIndexCount);
+            mDrawOffsets.push_back((const void *)(sizeof(GLuint) * c.mFirstIndex));
+        }
+
+        rangeEnd = c.mFirstIndex + c.mIndexCount;
+        mVisibleChunks++;
+    }
+
+    if (mDrawCounts.empty())
+        return;
+
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+
+    glState::bindVertexArray(mVAO);
+    glMultiDrawElements(GL_PATCHES, &mDrawCounts[0], GL_UNSIGNED_INT, &mDrawOffsets[0], (GLsizei)mDrawCounts.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterMesh::destroy()
+{
+    if (mVAO == 0)
+        return;
+
+    glDeleteBuffers(1, &mVBO);
+    glDeleteBuffers(1, &mIBO);
+    glDeleteVertexArrays(1, &mVAO);
+    glState::invalidate();
+
+    mVBO = mIBO = mVAO = 0;
+    mIndexCount = 0;
+    mChunks.clear();
+}
@@ -0,0 +1,72 @@
+/** @file waterMesh.h
+*  @brief grid of patches for the tessellated water surface
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+class Frustum;
+
+/** flat grid on the XZ plane (from -1 to 1, the same as the quad) made of quad patches
+*
+* vertex layout is the same as for the quad: position, normal, tex coord (locations 0, 1, 2),
+* tex coords go from 0 to 1 so the water textures cover the whole grid.
+* Patches are subdivided and displaced by the tessellation shaders (renderSurfaceTess.*),
+* so the grid itself can be very coarse.
+*
+* patches are grouped in square chunks, indices of one chunk are stored together.
+* Chunks outside the frustum are skipped, the rest (neighbouring ranges are merged)
+* is drawn with one glMultiDrawElements call.
+*/
+class WaterMesh
+{
+private:
+    struct Chunk
+    {
+        glm::vec2 mMin;          //!< XZ bounds
+        glm::vec2 mMax;
+        GLuint    mFirstIndex;
+        GLsizei   mIndexCount;
+    };
+
+    GLuint mPatchesPerSide;
+    GLuint mIndexCount;
+
+    GLuint mVBO;
+    GLuint mIBO;
+    GLuint mVAO;
+
+    std::vector<Chunk> mChunks;
+    // draw lists, kept between frames to avoid allocations:
+    std::vector<GLsizei>      mDrawCounts;
+    std::vector<const void *> mDrawOffsets;
+    GLuint mVisibleChunks;
+public:
+    /// max absolute water height that is expected, must match MAX_WATER_HEIGHT in renderSurfaceTess.tcs
+    float mMaxWaterHeight;
+public:
+    WaterMesh();
+    ~WaterMesh();
+
+    /// creates the buffers, can be called again to change the resolution
+    /// @param patchesPerChunk side of one culled chunk in patches
+    bool init(GLuint patchesPerSide, GLuint patchesPerChunk = 4);
+
+    /// draws all patches, tessellation program must be in use
+    void draw();
+    /// draws only the chunks that are inside the frustum
+    /// @param heightScale world units per one unit of the water height (the same as for the shaders)
+    void draw(const Frustum &frustum, float heightScale);
+
+    GLuint patchesPerSide() const { return mPatchesPerSide; }
+    GLuint chunkCount() const { return (GLuint)mChunks.size(); }
+    /// chunks drawn in the last draw call
+    GLuint visibleChunks() const { return mVisibleChunks; }
+private:
+    void destroy();
+
+    // block copying:
+    WaterMesh(const WaterMesh &);
+    WaterMesh & operator=(const WaterMesh &);
+};
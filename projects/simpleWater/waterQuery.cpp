@@ -0,0 +1,180 @@
+/** @file waterQuery.cpp
+*  @brief batched height/velocity/normal queries on the CPU copy of the water
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+#include <emmintrin.h>
+
+#include "waterReadback.h"
+#include "waterQuery.h"
+
+namespace
+{
+    /// one tile has 2^TILE_SHIFT x 2^TILE_SHIFT texels
+    const unsigned int TILE_SHIFT = 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterQuery::WaterQuery() :
+    mNormalScale(1.0f)
+{
+    setWorldRect(-1.0f, -1.0f, 1.0f, 1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterQuery::setWorldRect(float minX, float minZ, float maxX, float maxZ)
+{
+    assert(maxX > minX && maxZ > minZ);
+
+    mMinX = minX;
+    mMinZ = minZ;
+    mInvSizeX = 1.0f / (maxX - minX);
+    mInvSizeZ = 1.0f / (maxZ - minZ);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterQuery::sample(const WaterHeightField &field, const glm::vec2 *positions, size_t count, WaterSample *outSamples)
+{
+    if (count == 0)
+        return;
+
+    assert(positions && outSamples);
+    assert(field.mWidth >= 2 && field.mHeight >= 2 && "height field is not ready!");
+
+    sortByTiles(field, positions, count);
+
+    const float *data  = &field.mData[0];
+    const int    stride = 2 * (int)field.mWidth;   // floats in one row
+
+    const __m128 maxX0    = _mm_set1_ps((float)(field.mWidth - 2));
+    const __m128 maxY0    = _mm_set1_ps((float)(field.mHeight - 2));
+    const __m128 rowSize  = _mm_set1_ps((float)stride);
+    const __m128 two      = _mm_set1_ps(2.0f);
+    const __m128 one      = _mm_set1_ps(1.0f);
+    // gradient is per texel of the downsampled grid, normal map uses central difference on the full grid
+    const __m128 gradScale = _mm_set1_ps(-2.0f / (float)(1 << field.mDownsampleLevel));
+    const __m128 normalY   = _mm_set1_ps(mNormalScale);
+
+    for (size_t i = 0; i < count; i += 4)
+    {
+        // the last group is padded with the last query
+        unsigned int idx[4];
+        for (size_t k = 0; k < 4; ++k)
+            idx[k] = mOrder[std::min(i + k, count - 1)];
+
+        __m128 gx = _mm_set_ps(mCoords[idx[3]].x, mCoords[idx[2]].x, mCoords[idx[1]].x, mCoords[idx[0]].x);
+        __m128 gy = _mm_set_ps(mCoords[idx[3]].y, mCoords[idx[2]].y, mCoords[idx[1]].y, mCoords[idx[0]].y);
+
+        // coords are already clamped to >= 0 so truncation works as floor
+        __m128 x0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(gx)), maxX0);
+        __m128 y0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(gy)), maxY0);
+        __m128 fx = _mm_sub_ps(gx, x0);
+        __m128 fy = _mm_sub_ps(gy, y0);
+
+        int o[4];
+        _mm_storeu_si128((__m128i *)o, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(y0, rowSize), _mm_mul_ps(x0, two))));
+
+        //
+        // gather four corners (height, velocity) for all four queries
+        //
+        __m128 h00 = _mm_set_ps(data[o[3]],              data[o[2]],              data[o[1]],              data[o[0]]);
+        __m128 v00 = _mm_set_ps(data[o[3]+1],            data[o[2]+1],            data[o[1]+1],            data[o[0]+1]);
+        __m128 h10 = _mm_set_ps(data[o[3]+2],            data[o[2]+2],            data[o[1]+2],            data[o[0]+2]);
+        __m128 v10 = _mm_set_ps(data[o[3]+3],            data[o[2]+3],            data[o[1]+3],            data[o[0]+3]);
+        __m128 h01 = _mm_set_ps(data[o[3]+stride],       data[o[2]+stride],       data[o[1]+stride],       data[o[0]+stride]);
+        __m128 v01 = _mm_set_ps(data[o[3]+stride+1],     data[o[2]+stride+1],     data[o[1]+stride+1],     data[o[0]+stride+1]);
+        __m128 h11 = _mm_set_ps(data[o[3]+stride+2],     data[o[2]+stride+2],     data[o[1]+stride+2],     data[o[0]+stride+2]);
+        __m128 v11 = _mm_set_ps(data[o[3]+stride+3],     data[o[2]+stride+3],     data[o[1]+stride+3],     data[o[0]+stride+3]);
+
+        //
+        // bilinear interpolation
+        //
+        __m128 dxTop    = _mm_sub_ps(h10, h00);
+        __m128 dxBottom = _mm_sub_ps(h11, h01);
+        __m128 hTop     = _mm_add_ps(h00, _mm_mul_ps(dxTop, fx));
+        __m128 hBottom  = _mm_add_ps(h01, _mm_mul_ps(dxBottom, fx));
+        __m128 height   = _mm_add_ps(hTop, _mm_mul_ps(_mm_sub_ps(hBottom, hTop), fy));
+
+        __m128 vTop     = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), fx));
+        __m128 vBottom  = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), fx));
+        __m128 velocity = _mm_add_ps(vTop, _mm_mul_ps(_mm_sub_ps(vBottom, vTop), fy));
+
+        //
+        // normal from the gradient of the bilinear patch
+        //
+        __m128 dhdx = _mm_add_ps(dxTop, _mm_mul_ps(_mm_sub_ps(dxBottom, dxTop), fy));
+        __m128 dyLeft  = _mm_sub_ps(h01, h00);
+        __m128 dyRight = _mm_sub_ps(h11, h10);
+        __m128 dhdy = _mm_add_ps(dyLeft, _mm_mul_ps(_mm_sub_ps(dyRight, dyLeft), fx));
+
+        __m128 nx = _mm_mul_ps(dhdx, gradScale);
+        __m128 nz = _mm_mul_ps(dhdy, gradScale);
+        __m128 lenSq  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(normalY, normalY)), _mm_mul_ps(nz, nz));
+        __m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(lenSq));
+        nx = _mm_mul_ps(nx, invLen);
+        nz = _mm_mul_ps(nz, invLen);
+        __m128 ny = _mm_mul_ps(normalY, invLen);
+
+        //
+        // scatter results back in the original order
+        //
+        float outH[4], outV[4], outNx[4], outNy[4], outNz[4];
+        _mm_storeu_ps(outH, height);
+        _mm_storeu_ps(outV, velocity);
+        _mm_storeu_ps(outNx, nx);
+        _mm_storeu_ps(outNy, ny);
+        _mm_storeu_ps(outNz, nz);
+
+        const size_t valid = std::min((size_t)4, count - i);
+        for (size_t k = 0; k < valid; ++k)
+        {
+            WaterSample &s = outSamples[idx[k]];
+            s.mHeight   = outH[k];
+            s.mVelocity = outV[k];
+            s.mNormal   = glm::vec3(outNx[k], outNy[k], outNz[k]);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterQuery::sortByTiles(const WaterHeightField &field, const glm::vec2 *positions, size_t count)
+{
+    const unsigned int tilesX = ((field.mWidth - 1) >> TILE_SHIFT) + 1;
+    const unsigned int tilesY = ((field.mHeight - 1) >> TILE_SHIFT) + 1;
+
+    mCoords.resize(count);
+    mOrder.resize(count);
+    mTileStart.assign(tilesX * tilesY + 1, 0);
+
+    // world -> grid, texel centers are at half texel
+    const float scaleX = mInvSizeX * (float)field.mWidth;
+    const float scaleZ = mInvSizeZ * (float)field.mHeight;
+    const float maxX = (float)(field.mWidth - 1);
+    const float maxY = (float)(field.mHeight - 1);
+
+    //
+    // counting sort by tile index
+    //
+    for (size_t i = 0; i < count; ++i)
+    {
+        float gx = (positions[i].x - mMinX) * scaleX - 0.5f;
+        float gy = (positions[i].y - mMinZ) * scaleZ - 0.5f;
+        gx = std::min(std::max(gx, 0.0f), maxX);
+        gy = std::min(std::max(gy, 0.0f), maxY);
+        mCoords[i] = glm::vec2(gx, gy);
+
+        unsigned int tile = ((unsigned int)gy >> TILE_SHIFT) * tilesX + ((unsigned int)gx >> TILE_SHIFT);
+        mTileStart[tile + 1]++;
+    }
+
+    for (size_t t = 1; t < mTileStart.size(); ++t)
+        mTileStart[t] += mTileStart[t - 1];
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned int tile = ((unsigned int)mCoords[i].y >> TILE_SHIFT) * tilesX + ((unsigned int)mCoords[i].x >> TILE_SHIFT);
+        mOrder[mTileStart[tile]++] = (unsigned int)i;
+    }
+}
@@ -0,0 +1,53 @@
+/** @file waterQuery.h
+*  @brief batched height/velocity/normal queries on the CPU copy of the water
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+struct WaterHeightField;
+
+/** result of one query */
+struct WaterSample
+{
+    float     mHeight;
+    float     mVelocity;
+    glm::vec3 mNormal;    //!< world space, Y is up
+};
+
+/** samples WaterHeightField (see WaterReadback) at many world space points in one call
+*
+* values are bilinearly interpolated, normal is the gradient of the interpolated height
+* (central difference scale, the same as in the normal map pass).
+* Queries are sorted by grid tiles first so that neighbouring samples hit the same cache lines,
+* then processed four at once with SSE2.
+*/
+class WaterQuery
+{
+private:
+    float mMinX;
+    float mMinZ;
+    float mInvSizeX;
+    float mInvSizeZ;
+    float mNormalScale;
+
+    // scratch memory, kept between calls to avoid allocations:
+    std::vector<glm::vec2>    mCoords;     //!< grid coordinates of the queries
+    std::vector<unsigned int> mOrder;      //!< queries sorted by tiles
+    std::vector<unsigned int> mTileStart;
+public:
+    WaterQuery();
+
+    /// world space rectangle (on the XZ plane) covered by the water grid, default is -1..1 like the rendered quad
+    void setWorldRect(float minX, float minZ, float maxX, float maxZ);
+
+    /// strength of the normal in the Y direction, use WaterSurface::mNormalScale
+    void setNormalScale(float normalScale) { mNormalScale = normalScale; }
+
+    /// @param positions world space positions on the XZ plane (x, z), points outside the grid are clamped
+    /// @param outSamples array of count elements, results are in the same order as positions
+    void sample(const WaterHeightField &field, const glm::vec2 *positions, size_t count, WaterSample *outSamples);
+private:
+    void sortByTiles(const WaterHeightField &field, const glm::vec2 *positions, size_t count);
+};
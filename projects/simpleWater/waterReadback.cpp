@@ -0,0 +1,183 @@
+/** @file waterReadback.cpp
+*  @brief asynchronous copy of the water state on the CPU
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+#include "Framebuffer.h"
+#include "GLState.h"
+
+#include "waterSurface.h"
+#include "waterReadback.h"
+
+///////////////////////////////////////////////////////////////////////////////
+WaterReadback::WaterReadback() :
+    mDownsampledTex(0),
+    mDownsampleLevel(0),
+    mRingSize(0),
+    mSourceWidth(0),
+    mSourceHeight(0)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterReadback::~WaterReadback()
+{
+    destroyTargets();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterReadback::init(const WaterSurface &surface, GLuint downsampleLevel, GLuint ringSize)
+{
+    mDownsampleLevel = downsampleLevel;
+    mRingSize = ringSize;
+
+    return createTargets(surface);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterReadback::requestAll(const WaterSurface &surface)
+{
+    return requestRegion(surface, 0, 0, surface.width(), surface.height());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterReadback::requestRegion(const WaterSurface &surface, int x, int y, int w, int h)
+{
+    assert(mRingSize > 0 && "call init first!");
+
+    // simulation grid was resized - start again
+    if (surface.width() != mSourceWidth || surface.height() != mSourceHeight)
+    {
+        if (createTargets(surface) == false)
+            return false;
+    }
+
+    if (mReadback.isFull())
+        return false;
+
+    // clip to the grid:
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    w = std::min(w, (int)mSourceWidth - x);
+    h = std::min(h, (int)mSourceHeight - y);
+    if (w <= 0 || h <= 0)
+        return false;
+
+    PixelReadback::Region region;
+    region.mX      = x >> mDownsampleLevel;
+    region.mY      = y >> mDownsampleLevel;
+    region.mWidth  = std::max(w >> mDownsampleLevel, 1);
+    region.mHeight = std::max(h >> mDownsampleLevel, 1);
+    region.mTag    = surface.step();
+
+    if (mDownsampleLevel == 0)
+    {
+        glState::bindFramebuffer(GL_READ_FRAMEBUFFER, surface.dataFboName());
+    }
+    else
+    {
+        // downsample only the requested part
+        mFboDownsampled.bind(false);
+        glState::bindFramebuffer(GL_READ_FRAMEBUFFER, surface.dataFboName());
+        glBlitFramebuffer(x, y, x + w, y + h,
+                          region.mX, region.mY, region.mX + region.mWidth, region.mY + region.mHeight,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glState::bindFramebuffer(GL_READ_FRAMEBUFFER, mFboDownsampled.getId());
+    }
+
+    bool ok = mReadback.readPixels(region, GL_RG, GL_FLOAT);
+
+    FrameBuffer::bindSystemFrameBuffer();
+    CHECK_OPENGL_ERRORS();
+
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterReadback::update()
+{
+    bool newData = false;
+
+    PixelReadback::Region region;
+    const float *data = NULL;
+    while ((data = (const float *)mReadback.mapOldest(&region)) != NULL)
+    {
+        // regions requested before a resize do not match the field
+        if ((GLuint)(region.mX + region.mWidth) <= mField.mWidth && (GLuint)(region.mY + region.mHeight) <= mField.mHeight)
+        {
+            const size_t rowSize = sizeof(float) * 2 * region.mWidth;
+            for (int y = 0; y < region.mHeight; ++y)
+            {
+                memcpy(&mField.mData[2*((region.mY + y)*mField.mWidth + region.mX)], data + 2*y*region.mWidth, rowSize);
+            }
+
+            mField.mStep = region.mTag;
+            newData = true;
+        }
+
+        mReadback.unmap();
+    }
+
+    return newData;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterReadback::createTargets(const WaterSurface &surface)
+{
+    destroyTargets();
+
+    mSourceWidth  = surface.width();
+    mSourceHeight = surface.height();
+
+    mField.mWidth  = std::max(mSourceWidth >> mDownsampleLevel, 1u);
+    mField.mHeight = std::max(mSourceHeight >> mDownsampleLevel, 1u);
+    mField.mStep   = 0;
+    mField.mDownsampleLevel = mDownsampleLevel;
+    mField.mData.assign(2 * mField.mWidth * mField.mHeight, 0.0f);
+
+    if (mReadback.init(mRingSize, sizeof(float) * mField.mData.size()) == false)
+        return false;
+
+    if (mDownsampleLevel > 0)
+    {
+        mDownsampledTex = textureLoader::createEmptyTexture2D(mField.mWidth, mField.mHeight, GL_RGB16F, GL_RGB, GL_FLOAT, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+        mFboDownsampled.createAndBind();
+        mFboDownsampled.attachTextureAsColorTarget(0, mDownsampledTex, mField.mWidth, mField.mHeight, GL_TEXTURE_2D);
+        mFboDownsampled.setDrawBuffers();
+        bool complete = mFboDownsampled.check();
+
+        FrameBuffer::bindSystemFrameBuffer();
+
+        if (!complete)
+        {
+            LOG_ERROR("cannot create downsampled target for the water readback!");
+            return false;
+        }
+    }
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterReadback::destroyTargets()
+{
+    mReadback.destroy();
+    mFboDownsampled.destroy();
+
+    if (mDownsampledTex > 0)
+    {
+        glDeleteTextures(1, &mDownsampledTex);
+        glState::invalidate();
+    }
+    mDownsampledTex = 0;
+}
@@ -0,0 +1,79 @@
+/** @file waterReadback.h
+*  @brief asynchronous copy of the water state on the CPU
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include "Framebuffer.h"
+#include "PixelReadback.h"
+
+class WaterSurface;
+
+/** CPU copy of the water state, two floats per texel: height and velocity */
+struct WaterHeightField
+{
+    WaterHeightField() { mWidth = 0; mHeight = 0; mStep = 0; mDownsampleLevel = 0; }
+
+    GLuint mWidth;            //!< size of the grid (after downsampling)
+    GLuint mHeight;
+    GLuint mStep;             //!< simulation step of the most recent data
+    GLuint mDownsampleLevel;  //!< grid is 2^level times smaller than the simulation
+    std::vector<float> mData;
+
+    float height(GLuint x, GLuint y) const   { return mData[2*(y*mWidth + x)]; }
+    float velocity(GLuint x, GLuint y) const { return mData[2*(y*mWidth + x) + 1]; }
+};
+
+/** reads the WaterSurface data texture back to the CPU without stalls
+*
+* requests are issued after the water update, the data arrives a few frames later
+* (ring size) and is copied into heightField() in update().
+* downsample level L reads a grid 2^L times smaller (GL_LINEAR blit) to reduce transfer size.
+* Whole grid or just selected regions can be requested.
+*/
+class WaterReadback
+{
+private:
+    PixelReadback    mReadback;
+    WaterHeightField mField;
+
+    /// used only when mDownsampleLevel > 0
+    FrameBuffer      mFboDownsampled;
+    GLuint           mDownsampledTex;
+
+    GLuint mDownsampleLevel;
+    GLuint mRingSize;
+    GLuint mSourceWidth;      //!< size of the simulation grid the targets were created for
+    GLuint mSourceHeight;
+public:
+    WaterReadback();
+    ~WaterReadback();
+
+    /// @param downsampleLevel 0 - full resolution, 1 - half, 2 - quarter...
+    /// @param ringSize how many reads can be in flight, results are about ringSize frames late
+    bool init(const WaterSurface &surface, GLuint downsampleLevel, GLuint ringSize = 3);
+
+    /// requests the whole grid, call it after WaterSurface::endUpdate
+    /// @return false if the ring is full (request is skipped, nothing waits)
+    bool requestAll(const WaterSurface &surface);
+
+    /// requests only a part of the grid, coordinates in the simulation texels
+    bool requestRegion(const WaterSurface &surface, int x, int y, int w, int h);
+
+    /// collects all finished reads into heightField()
+    /// @return true when new data arrived
+    bool update();
+
+    const WaterHeightField &heightField() const { return mField; }
+    GLuint downsampleLevel() const { return mDownsampleLevel; }
+    GLuint pendingCount() const { return mReadback.pendingCount(); }
+private:
+    bool createTargets(const WaterSurface &surface);
+    void destroyTargets();
+
+    // block copying:
+    WaterReadback(const WaterReadback &);
+    WaterReadback & operator=(const WaterReadback &);
+};
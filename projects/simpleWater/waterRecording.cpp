@@ -0,0 +1,591 @@
+/** @file waterRecording.cpp
+*  @brief every step of the water recorded to a file and replayed without the simulation
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "Framebuffer.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "waterSurface.h"
+#include "waterRecording.h"
+
+namespace
+{
+    /// "SWRC" - simpleWater recording
+    const unsigned int RECORDING_MAGIC   = 0x43525753;
+    const unsigned int RECORDING_VERSION = 1;
+
+    /// previous frame of the replay is the flat surface, not a recorded step
+    const GLuint NO_STEP = 0xffffffff;
+
+    /// reads in flight, steps are dropped when all of them are pending
+    const GLuint READBACK_RING_SIZE = 6;
+
+    ///////////////////////////////////////////////////////////////////////////////
+    FILE *openFile(const char *name, const char *mode)
+    {
+        FILE *fp = NULL;
+#ifdef _MSC_VER
+        fopen_s(&fp, name, mode);
+#else
+        fp = fopen(name, mode);
+#endif
+        return fp;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// small differences (the usual case) become small numbers, whatever the sign
+    unsigned int zigzag(int value)
+    {
+        return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    int unzigzag(unsigned int value)
+    {
+        return (int)(value >> 1) ^ -(int)(value & 1);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    void putVarint(std::vector<unsigned char> *out, unsigned int value)
+    {
+        while (value >= 0x80)
+        {
+            out->push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        out->push_back((unsigned char)value);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool getVarint(const unsigned char **p, const unsigned char *end, unsigned int *outValue)
+    {
+        unsigned int value = 0;
+        for (int shift = 0; shift < 32; shift += 7)
+        {
+            if (*p == end)
+                return false;
+
+            const unsigned char b = *(*p)++;
+            value |= (unsigned int)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+            {
+                *outValue = value;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+WaterRecorder::WaterRecorder() :
+    mFile(NULL),
+    mDroppedFrames(0),
+    mFramesRequested(0),
+    mStopping(false),
+    mBlockFrames(0),
+    mQuantStep(1.0f / 4096.0f)
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterRecorder::~WaterRecorder()
+{
+    stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterRecorder::start(const WaterSurface &surface, const char *fileName, GLuint framesPerBlock)
+{
+    assert(fileName && framesPerBlock > 0 && mQuantStep > 0.0f);
+
+    stop();
+
+    const GLuint texels = surface.width() * surface.height();
+    if (mReadback.init(READBACK_RING_SIZE, sizeof(float) * texels) == false)
+        return false;
+
+    mFile = openFile(fileName, "wb");
+    if (mFile == NULL)
+    {
+        LOG_ERROR("cannot create the recording %s", fileName);
+        mReadback.destroy();
+        return false;
+    }
+
+    mHeader.mMagic          = RECORDING_MAGIC;
+    mHeader.mVersion        = RECORDING_VERSION;
+    mHeader.mWidth          = surface.width();
+    mHeader.mHeight         = surface.height();
+    mHeader.mFrameCount     = 0;
+    mHeader.mFramesPerBlock = framesPerBlock;
+    mHeader.mQuantStep      = mQuantStep;
+    // written again in stop(), with the frame count
+    fwrite(&mHeader, sizeof(mHeader), 1, mFile);
+
+    mPrevious.assign(texels, 0);
+    mCurrent.assign(texels, 0);
+    mBlock.clear();
+    mBlockSteps.clear();
+    mBlockFrames     = 0;
+    mDroppedFrames   = 0;
+    mFramesRequested = 0;
+    mStopping        = false;
+
+    mWriter = std::thread(&WaterRecorder::writerLoop, this);
+
+    LOG("recording the water to %s (%dx%d)", fileName, mHeader.mWidth, mHeader.mHeight);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::stop()
+{
+    if (!isRecording())
+        return;
+
+    // the last steps are still in the ring
+    glFinish();
+    update();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeUp.notify_all();
+    mWriter.join();
+
+    fseek(mFile, 0, SEEK_SET);
+    const bool ok = fwrite(&mHeader, sizeof(mHeader), 1, mFile) == 1;
+    if (fclose(mFile) != 0 || !ok)
+        LOG_ERROR("cannot complete the water recording!");
+    mFile = NULL;
+
+    mReadback.destroy();
+    mQueue.clear();
+
+    LOG("water recording stopped: %d frames, %d dropped", mHeader.mFrameCount, mDroppedFrames);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::record(const WaterSurface &surface)
+{
+    if (!isRecording())
+        return;
+
+    if (surface.width() != mHeader.mWidth || surface.height() != mHeader.mHeight)
+    {
+        LOG_ERROR("the water grid was resized, recording stopped");
+        stop();
+        return;
+    }
+
+    mFramesRequested++;
+
+    PixelReadback::Region region;
+    region.mWidth  = surface.width();
+    region.mHeight = surface.height();
+    region.mTag    = surface.step();
+
+    bool ok = false;
+    if (mReadback.isFull() == false)
+    {
+        glState::bindFramebuffer(GL_READ_FRAMEBUFFER, surface.dataFboName());
+        ok = mReadback.readPixels(region, GL_RED, GL_FLOAT);
+        FrameBuffer::bindSystemFrameBuffer();
+    }
+
+    if (!ok)
+    {
+        // the file keeps step numbers, the gap is visible in the replay
+        if (mDroppedFrames == 0)
+            LOG("water recording: the readback ring is full, step %d dropped", region.mTag);
+        mDroppedFrames++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::update()
+{
+    if (!isRecording())
+        return;
+
+    const size_t texels = (size_t)mHeader.mWidth * mHeader.mHeight;
+
+    PixelReadback::Region region;
+    const float *data = NULL;
+    while ((data = (const float *)mReadback.mapOldest(&region)) != NULL)
+    {
+        std::vector<float> frame(data, data + texels);
+        mReadback.unmap();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.push_back(QueuedFrame());
+            mQueue.back().mStep = region.mTag;
+            mQueue.back().mHeights.swap(frame);
+        }
+        mWakeUp.notify_one();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::writerLoop()
+{
+    std::vector<float> frame;
+    GLuint step = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mStopping && mQueue.empty())
+                mWakeUp.wait(lock);
+
+            // everything queued before stop() is written
+            if (mQueue.empty())
+                break;
+
+            frame.swap(mQueue.front().mHeights);
+            step = mQueue.front().mStep;
+            mQueue.pop_front();
+        }
+
+        encodeFrame(step, frame);
+        if (mBlockFrames == mHeader.mFramesPerBlock)
+            writeBlock();
+    }
+
+    if (mBlockFrames > 0)
+        writeBlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::encodeFrame(GLuint step, const std::vector<float> &heights)
+{
+    const size_t count = mCurrent.size();
+    const float scale = 1.0f / mHeader.mQuantStep;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float q = floorf(heights[i] * scale + 0.5f);
+        mCurrent[i] = (short)std::max(std::min(q, 32767.0f), -32767.0f);
+    }
+
+    // blocks start from a flat surface, so each can be decoded alone
+    if (mBlockFrames == 0)
+        std::fill(mPrevious.begin(), mPrevious.end(), (short)0);
+
+    for (size_t i = 0; i < count; )
+    {
+        const int diff = (int)mCurrent[i] - (int)mPrevious[i];
+        if (diff != 0)
+        {
+            putVarint(&mBlock, zigzag(diff));
+            i++;
+            continue;
+        }
+
+        // calm water does not change at all, whole rows become one run
+        size_t run = 1;
+        while (i + run < count && mCurrent[i + run] == mPrevious[i + run])
+            run++;
+        putVarint(&mBlock, 0);
+        putVarint(&mBlock, (unsigned int)(run - 1));
+        i += run;
+    }
+
+    mPrevious.swap(mCurrent);
+    mBlockSteps.push_back(step);
+    mBlockFrames++;
+    mHeader.mFrameCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterRecorder::writeBlock()
+{
+    WaterRecordingBlock block;
+    block.mFirstFrame = mHeader.mFrameCount - mBlockFrames;
+    block.mFrameCount = mBlockFrames;
+    block.mByteSize   = (unsigned int)mBlock.size();
+
+    const bool ok = fwrite(&block, sizeof(block), 1, mFile) == 1 &&
+                    fwrite(&mBlockSteps[0], sizeof(unsigned int), mBlockSteps.size(), mFile) == mBlockSteps.size() &&
+                    fwrite(&mBlock[0], 1, mBlock.size(), mFile) == mBlock.size();
+    if (!ok)
+        LOG_ERROR("cannot write the water recording!");
+
+    mBlock.clear();
+    mBlockSteps.clear();
+    mBlockFrames = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+WaterPlayer::WaterPlayer() :
+    mFile(NULL),
+    mLoop(true),
+    mQuit(false),
+    mEnded(false),
+    mGaps(0),
+    mFramesAhead(8)
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterPlayer::~WaterPlayer()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterPlayer::open(const char *fileName, bool loop)
+{
+    assert(fileName);
+
+    close();
+
+    mFile = openFile(fileName, "rb");
+    if (mFile == NULL)
+    {
+        LOG_ERROR("cannot open the recording %s", fileName);
+        return false;
+    }
+
+    const bool valid = fread(&mHeader, sizeof(mHeader), 1, mFile) == 1 &&
+                       mHeader.mMagic == RECORDING_MAGIC && mHeader.mVersion == RECORDING_VERSION &&
+                       mHeader.mWidth > 0 && mHeader.mHeight > 0 && mHeader.mFramesPerBlock > 0 && mHeader.mQuantStep > 0.0f;
+    if (!valid)
+    {
+        LOG_ERROR("%s is not a valid water recording", fileName);
+        fclose(mFile);
+        mFile = NULL;
+        return false;
+    }
+
+    mLoop  = loop;
+    mQuit  = false;
+    mEnded = false;
+    mGaps  = 0;
+    mDecoder = std::thread(&WaterPlayer::decoderLoop, this);
+
+    LOG("replaying %s: %dx%d, %d frames", fileName, mHeader.mWidth, mHeader.mHeight, mHeader.mFrameCount);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterPlayer::close()
+{
+    if (!isOpen())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeUp.notify_all();
+    mDecoder.join();
+
+    for (size_t i = 0; i < mReady.size(); ++i)
+        delete mReady[i];
+    for (size_t i = 0; i < mFree.size(); ++i)
+        delete mFree[i];
+    mReady.clear();
+    mFree.clear();
+
+    fclose(mFile);
+    mFile = NULL;
+
+    if (mGaps > 0)
+        LOG("the replayed recording skips steps in %d places", mGaps);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterPlayer::nextFrame(WaterSurface *surface)
+{
+    assert(surface);
+
+    if (!isOpen())
+        return false;
+
+    Frame *frame = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mReady.empty())
+            return false;
+        frame = mReady.front();
+        mReady.pop_front();
+    }
+    // room for the next one
+    mWakeUp.notify_one();
+
+    bool ok = surface->setState(mHeader.mWidth, mHeader.mHeight, frame->mIndex, &frame->mData[0]);
+    if (ok)
+        surface->updateNormals();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(frame);
+
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterPlayer::ended()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEnded && mReady.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLuint WaterPlayer::gapCount()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mGaps;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterPlayer::decoderLoop()
+{
+    const size_t texels = (size_t)mHeader.mWidth * mHeader.mHeight;
+    const long firstBlock = (long)sizeof(WaterRecordingHeader);
+
+    std::vector<short> heights(texels);
+    std::vector<float> previous(texels, 0.0f);
+    GLuint previousStep = NO_STEP;
+    std::vector<unsigned int> steps;
+    std::vector<unsigned char> data;
+    bool decodedSinceStart = false;
+
+    for (;;)
+    {
+        WaterRecordingBlock block;
+        bool ok = fread(&block, sizeof(block), 1, mFile) == 1;
+
+        if (!ok && mLoop && decodedSinceStart)
+        {
+            fseek(mFile, firstBlock, SEEK_SET);
+            std::fill(previous.begin(), previous.end(), 0.0f);
+            previousStep = NO_STEP;
+            decodedSinceStart = false;
+            continue;
+        }
+
+        // a varint is at most 3 bytes for int16 differences, a run is at most 1 + 5
+        ok = ok && block.mFrameCount > 0 && block.mFrameCount <= mHeader.mFramesPerBlock &&
+             block.mByteSize <= texels * block.mFrameCount * 6;
+        if (ok)
+        {
+            steps.resize(block.mFrameCount);
+            data.resize(block.mByteSize);
+            ok = fread(&steps[0], sizeof(unsigned int), steps.size(), mFile) == steps.size() &&
+                 (data.empty() || fread(&data[0], 1, data.size(), mFile) == data.size());
+        }
+        if (ok)
+            ok = decodeBlock(block, steps, data, &heights, &previous, &previousStep);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQuit)
+            return;
+        if (!ok)
+        {
+            mEnded = true;
+            return;
+        }
+        decodedSinceStart = true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterPlayer::decodeBlock(const WaterRecordingBlock &block, const std::vector<unsigned int> &steps, const std::vector<unsigned char> &data,
+                              std::vector<short> *heights, std::vector<float> *previous, GLuint *previousStep)
+{
+    const size_t texels = heights->size();
+    const unsigned char *p   = data.empty() ? NULL : &data[0];
+    const unsigned char *end = p + data.size();
+
+    std::fill(heights->begin(), heights->end(), (short)0);
+
+    for (GLuint f = 0; f < block.mFrameCount; ++f)
+    {
+        for (size_t i = 0; i < texels; )
+        {
+            unsigned int value;
+            if (getVarint(&p, end, &value) == false)
+                return false;
+
+            if (value != 0)
+            {
+                (*heights)[i] = (short)((*heights)[i] + unzigzag(value));
+                i++;
+                continue;
+            }
+
+            unsigned int run;
+            if (getVarint(&p, end, &run) == false || i + run + 1 > texels)
+                return false;
+            i += run + 1;
+        }
+
+        // steps between this frame and the previous one, more than 1 when the recorder dropped some
+        const GLuint step = steps[f];
+        GLuint stepCount = 1;
+        bool gap = false;
+        if (*previousStep != NO_STEP)
+        {
+            if (step <= *previousStep)
+                return false;
+            stepCount = step - *previousStep;
+            gap = stepCount > 1;
+            if (gap)
+                LOG("water recording: steps %d..%d are missing", *previousStep + 1, step - 1);
+        }
+        *previousStep = step;
+
+        Frame *frame = allocFrame();
+        frame->mIndex = step;
+        frame->mData.resize(2 * texels);
+        const float invStepCount = 1.0f / (float)stepCount;
+        for (size_t i = 0; i < texels; ++i)
+        {
+            const float h = (float)(*heights)[i] * mHeader.mQuantStep;
+            frame->mData[2*i]     = h;
+            frame->mData[2*i + 1] = (h - (*previous)[i]) * invStepCount;
+            (*previous)[i] = h;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (gap)
+            mGaps++;
+        while (!mQuit && mReady.size() >= mFramesAhead)
+            mWakeUp.wait(lock);
+
+        if (mQuit)
+        {
+            mFree.push_back(frame);
+            return true;
+        }
+        mReady.push_back(frame);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterPlayer::Frame *WaterPlayer::allocFrame()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFree.empty())
+        return new Frame();
+
+    Frame *frame = mFree.back();
+    mFree.pop_back();
+    return frame;
+}
@@ -0,0 +1,169 @@
+/** @file waterRecording.h
+*  @brief every step of the water recorded to a file and replayed without the simulation
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "PixelReadback.h"
+
+class WaterSurface;
+
+/** file layout of a recording
+*
+* header, then blocks one after another: WaterRecordingBlock, mFrameCount step numbers (unsigned int)
+* and mByteSize bytes of frames. Steps that could not be read are missing, the step numbers show the gaps.
+* Heights are quantized to int16 (mQuantStep units) and every frame is stored as the difference
+* to the previous one: zigzag varints, a zero is followed by the length of the zero run - 1.
+* The first frame of a block is relative to a flat surface, so blocks decode on their own.
+* Only heights are stored, replay derives the velocity from two frames (per step, also over a gap).
+*/
+struct WaterRecordingHeader
+{
+    unsigned int mMagic;
+    unsigned int mVersion;
+    unsigned int mWidth;
+    unsigned int mHeight;
+    unsigned int mFrameCount;       //!< written when the recording stops
+    unsigned int mFramesPerBlock;
+    float        mQuantStep;        //!< height of one int16 step
+};
+
+struct WaterRecordingBlock
+{
+    unsigned int mFirstFrame;      //!< index of the first frame in the file, not a step
+    unsigned int mFrameCount;
+    unsigned int mByteSize;
+};
+
+/** records heights of every step
+*
+* record() reads the state (PixelReadback, only the height channel), update() collects the reads
+* a few frames later and a writer thread encodes and writes them block by block,
+* nothing waits for the GPU or the disk. When the ring of reads is full the step is dropped
+* (see droppedFrames()), every frame keeps its step number so the replay knows about it.
+* A resized surface (dynamic grid) ends the recording.
+*/
+class WaterRecorder
+{
+private:
+    struct QueuedFrame
+    {
+        GLuint             mStep;
+        std::vector<float> mHeights;
+    };
+
+    PixelReadback        mReadback;
+    WaterRecordingHeader mHeader;
+    FILE                *mFile;
+    GLuint               mDroppedFrames;
+    GLuint               mFramesRequested;
+
+    // frames waiting for the writer:
+    std::deque<QueuedFrame> mQueue;
+    std::thread             mWriter;
+    std::mutex              mMutex;
+    std::condition_variable mWakeUp;
+    bool                    mStopping;
+
+    // used only by the writer thread:
+    std::vector<short>         mPrevious;
+    std::vector<short>         mCurrent;
+    std::vector<unsigned char> mBlock;
+    std::vector<unsigned int>  mBlockSteps;
+    GLuint                     mBlockFrames;
+public:
+    /// height of one quantization step, default is 1/4096 (range +-8), set it before start()
+    float mQuantStep;
+public:
+    WaterRecorder();
+    ~WaterRecorder();
+
+    bool start(const WaterSurface &surface, const char *fileName, GLuint framesPerBlock = 32);
+    /// waits for all pending reads and the writer, completes the file
+    void stop();
+    bool isRecording() const { return mFile != NULL; }
+
+    /// reads the state of the last step, call it after WaterSurface::endUpdate
+    void record(const WaterSurface &surface);
+    /// hands finished reads to the writer, call it once per frame
+    void update();
+
+    GLuint frameCount() const    { return mFramesRequested - mDroppedFrames; }
+    GLuint droppedFrames() const { return mDroppedFrames; }
+private:
+    void writerLoop();
+    void encodeFrame(GLuint step, const std::vector<float> &heights);
+    void writeBlock();
+
+    // block copying:
+    WaterRecorder(const WaterRecorder &);
+    WaterRecorder & operator=(const WaterRecorder &);
+};
+
+/** replays a recording into a WaterSurface
+*
+* a decoder thread reads and decodes up to mFramesAhead frames in advance,
+* nextFrame() only uploads a ready frame (WaterSurface::setState) and never waits.
+* The surface gets the recorded step numbers. Steps dropped by the recorder are counted
+* (gapCount()), the velocity after a gap is the average over the missing steps.
+*/
+class WaterPlayer
+{
+private:
+    struct Frame
+    {
+        GLuint             mIndex;
+        std::vector<float> mData;     //!< height, velocity pairs
+    };
+
+    WaterRecordingHeader mHeader;
+    FILE                *mFile;
+    bool                 mLoop;
+
+    std::deque<Frame *>     mReady;
+    std::vector<Frame *>    mFree;       //!< reused, frames are big
+    std::thread             mDecoder;
+    std::mutex              mMutex;
+    std::condition_variable mWakeUp;
+    bool                    mQuit;
+    bool                    mEnded;
+    GLuint                  mGaps;
+public:
+    /// how many frames are decoded in advance, default is 8
+    GLuint mFramesAhead;
+public:
+    WaterPlayer();
+    ~WaterPlayer();
+
+    /// @param loop when true the playback starts again after the last frame
+    bool open(const char *fileName, bool loop = true);
+    void close();
+    bool isOpen() const { return mFile != NULL; }
+
+    /// uploads the next frame into the surface (resized when needed) and updates its normals
+    /// @return false when the frame is not decoded yet (the surface keeps the previous one) or the recording ended
+    bool nextFrame(WaterSurface *surface);
+
+    bool ended();
+    GLuint frameCount() const { return mHeader.mFrameCount; }
+    /// places where the recording skips steps, found so far
+    GLuint gapCount();
+private:
+    void decoderLoop();
+    /// decodes one block into frames, false when the file is broken
+    /// @param previousStep step of *previous, NO_STEP when it is the flat surface before the first frame
+    bool decodeBlock(const WaterRecordingBlock &block, const std::vector<unsigned int> &steps, const std::vector<unsigned char> &data,
+                     std::vector<short> *heights, std::vector<float> *previous, GLuint *previousStep);
+    Frame *allocFrame();
+
+    // block copying:
+    WaterPlayer(const WaterPlayer &);
+    WaterPlayer & operator=(const WaterPlayer &);
+};
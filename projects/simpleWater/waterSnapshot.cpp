@@ -0,0 +1,367 @@
+/** @file waterSnapshot.cpp
+*  @brief water state saved to a file and restored from it
+*
+*	@author Bartlomiej Filipek
+*/
+
+#include "stdafx.h"
+
+#include "Init.h"
+#include "Log.h"
+#include "GLState.h"
+#include "Framebuffer.h"
+#include "MappedFile.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "waterSurface.h"
+#include "waterReadback.h"
+#include "waterSnapshot.h"
+
+namespace
+{
+    /// "SWSS" - simpleWater snapshot
+    const unsigned int SNAPSHOT_MAGIC   = 0x53535753;
+    const unsigned int SNAPSHOT_VERSION = 1;
+
+    ///////////////////////////////////////////////////////////////////////////////
+    unsigned int planeOffset()
+    {
+        return (sizeof(WaterSnapshotHeader) + SNAPSHOT_PLANE_ALIGNMENT - 1) / SNAPSHOT_PLANE_ALIGNMENT * SNAPSHOT_PLANE_ALIGNMENT;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// header for the current state of the surface
+    WaterSnapshotHeader makeHeader(const WaterSurface &surface)
+    {
+        WaterSnapshotHeader h;
+        memset(&h, 0, sizeof(h));
+        h.mMagic            = SNAPSHOT_MAGIC;
+        h.mVersion          = SNAPSHOT_VERSION;
+        h.mHeaderSize       = sizeof(WaterSnapshotHeader);
+        h.mWidth            = surface.width();
+        h.mHeight           = surface.height();
+        h.mStep             = surface.step();
+        h.mFlags            = (surface.tileable() ? WaterSnapshotHeader::FLAG_TILEABLE : 0) |
+                              (surface.mProceduralRain ? WaterSnapshotHeader::FLAG_PROCEDURAL_RAIN : 0);
+        h.mPlaneCount       = 1;
+        h.mPlaneOffset      = planeOffset();
+        h.mPlaneSize        = sizeof(float) * 2 * h.mWidth * h.mHeight;
+        h.mFadeDY           = surface.mfadeDY;
+        h.mGatherFactor     = surface.mgatherFactor;
+        h.mFadeY            = surface.mfadeY;
+        h.mNormalScale      = surface.mNormalScale;
+        h.mOffsetScale      = surface.mOffsetScale;
+        h.mRainDropsPerStep = surface.mRainDropsPerStep;
+        h.mRainPressure     = surface.mRainPressure;
+        h.mBodyCoupling     = surface.mBodyCoupling;
+        return h;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    FILE *openFile(const std::string &name, const char *mode)
+    {
+        FILE *fp = NULL;
+#ifdef _MSC_VER
+        fopen_s(&fp, name.c_str(), mode);
+#else
+        fp = fopen(name.c_str(), mode);
+#endif
+        return fp;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// runs on the writer thread
+    void writeFile(std::string fileName, WaterSnapshotHeader header, std::vector<float> data, std::atomic<bool> *writing)
+    {
+        const std::string tmpName = fileName + ".tmp";
+
+        bool ok = false;
+        FILE *fp = openFile(tmpName, "wb");
+        if (fp)
+        {
+            std::vector<char> padding(header.mPlaneOffset - sizeof(header), 0);
+            ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                 (padding.empty() || fwrite(&padding[0], 1, padding.size(), fp) == padding.size()) &&
+                 fwrite(&data[0], 1, header.mPlaneSize, fp) == header.mPlaneSize;
+            ok = fclose(fp) == 0 && ok;
+        }
+
+        if (ok)
+        {
+            // rename does not overwrite on Windows
+            remove(fileName.c_str());
+            ok = rename(tmpName.c_str(), fileName.c_str()) == 0;
+        }
+
+        if (ok)
+        {
+            LOG_SUCCESS("water snapshot %s saved (%dx%d, step %d)", fileName.c_str(), header.mWidth, header.mHeight, header.mStep);
+        }
+        else
+        {
+            LOG_ERROR("cannot write the water snapshot %s", fileName.c_str());
+            remove(tmpName.c_str());
+        }
+
+        *writing = false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// maps the file and checks that the header and the plane fit in it
+    bool openSnapshot(const char *fileName, MappedFile *file, const WaterSnapshotHeader **outHeader, const float **outData)
+    {
+        if (file->open(fileName) == false)
+        {
+            LOG_ERROR("cannot open the water snapshot %s", fileName);
+            return false;
+        }
+
+        const WaterSnapshotHeader *header = (const WaterSnapshotHeader *)file->data();
+        const bool valid = file->size() >= sizeof(WaterSnapshotHeader) &&
+                           header->mMagic == SNAPSHOT_MAGIC && header->mVersion == SNAPSHOT_VERSION &&
+                           header->mHeaderSize == sizeof(WaterSnapshotHeader) &&
+                           header->mPlaneCount == 1 && header->mWidth > 0 && header->mHeight > 0 &&
+                           header->mPlaneSize == sizeof(float) * 2 * header->mWidth * header->mHeight &&
+                           header->mPlaneOffset % sizeof(float) == 0 &&
+                           (size_t)header->mPlaneOffset + header->mPlaneSize <= file->size();
+        if (!valid)
+        {
+            LOG_ERROR("%s is not a valid water snapshot", fileName);
+            return false;
+        }
+
+        *outHeader = header;
+        *outData   = (const float *)(file->data() + header->mPlaneOffset);
+        return true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterSnapshotWriter::WaterSnapshotWriter() :
+    mWriting(false)
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaterSnapshotWriter::~WaterSnapshotWriter()
+{
+    finish();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterSnapshotWriter::request(const WaterSurface &surface, const char *fileName)
+{
+    assert(fileName);
+
+    const GLsizeiptr size = (GLsizeiptr)sizeof(float) * 2 * surface.width() * surface.height();
+    if (size > mReadback.slotSize())
+    {
+        // grows only between snapshots
+        if (mPending.empty() == false)
+            return false;
+        if (mReadback.init(2, size) == false)
+            return false;
+    }
+
+    if (mReadback.isFull())
+        return false;
+
+    Pending pending;
+    pending.mFileName = fileName;
+    pending.mHeader   = makeHeader(surface);
+
+    PixelReadback::Region region;
+    region.mWidth  = surface.width();
+    region.mHeight = surface.height();
+    region.mTag    = surface.step();
+
+    glState::bindFramebuffer(GL_READ_FRAMEBUFFER, surface.dataFboName());
+    const bool ok = mReadback.readPixels(region, GL_RG, GL_FLOAT);
+    FrameBuffer::bindSystemFrameBuffer();
+
+    if (ok)
+        mPending.push_back(pending);
+
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool WaterSnapshotWriter::update()
+{
+    // one file at a time, the next read waits in its buffer
+    if (mWriting)
+        return false;
+
+    // the thread is done, join returns at once
+    if (mWriter.joinable())
+        mWriter.join();
+
+    if (mPending.empty())
+        return false;
+
+    PixelReadback::Region region;
+    const float *data = (const float *)mReadback.mapOldest(&region);
+    if (data == NULL)
+        return false;
+
+    Pending pending = mPending.front();
+    mPending.pop_front();
+
+    std::vector<float> copy(data, data + pending.mHeader.mPlaneSize / sizeof(float));
+    mReadback.unmap();
+
+    mWriting = true;
+    mWriter = std::thread(writeFile, pending.mFileName, pending.mHeader, std::move(copy), &mWriting);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaterSnapshotWriter::finish()
+{
+    if (mWriter.joinable())
+        mWriter.join();
+}
+
+namespace waterSnapshot
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    bool load(const char *fileName, WaterSurface *surface, bool restoreParams)
+    {
+        assert(fileName && surface);
+
+        MappedFile file;
+        const WaterSnapshotHeader *header = NULL;
+        const float *data = NULL;
+        if (openSnapshot(fileName, &file, &header, &data) == false)
+            return false;
+
+        if (restoreParams)
+        {
+            surface->mfadeDY           = header->mFadeDY;
+            surface->mgatherFactor     = header->mGatherFactor;
+            surface->mfadeY            = header->mFadeY;
+            surface->mNormalScale      = header->mNormalScale;
+            surface->mOffsetScale      = header->mOffsetScale;
+            surface->mRainDropsPerStep = header->mRainDropsPerStep;
+            surface->mRainPressure     = header->mRainPressure;
+            surface->mBodyCoupling     = header->mBodyCoupling;
+            surface->mProceduralRain   = (header->mFlags & WaterSnapshotHeader::FLAG_PROCEDURAL_RAIN) != 0;
+            surface->setTileable((header->mFlags & WaterSnapshotHeader::FLAG_TILEABLE) != 0);
+        }
+
+        // straight from the mapped pages
+        if (surface->setState(header->mWidth, header->mHeight, header->mStep, data) == false)
+            return false;
+        // visible at once, even when the simulation is paused
+        surface->updateNormals();
+
+        LOG_SUCCESS("water snapshot %s restored (%dx%d, step %d)", logger::fileNameFromPath(fileName), header->mWidth, header->mHeight, header->mStep);
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool load(const char *fileName, WaterHeightField *field)
+    {
+        assert(fileName && field);
+
+        MappedFile file;
+        const WaterSnapshotHeader *header = NULL;
+        const float *data = NULL;
+        if (openSnapshot(fileName, &file, &header, &data) == false)
+            return false;
+
+        field->mWidth           = header->mWidth;
+        field->mHeight          = header->mHeight;
+        field->mStep            = header->mStep;
+        field->mDownsampleLevel = 0;
+        field->mData.assign(data, data + header->mPlaneSize / sizeof(float));
+
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    bool checkResizedRestore(WaterSurface *surface, const char *fileName)
+    {
+        assert(surface && fileName);
+
+        const GLuint width  = surface->width();
+        const GLuint height = surface->height();
+        const GLuint step   = surface->step();
+
+        // the current state, put back at the end
+        std::vector<float> original(2 * width * height);
+        glState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glState::bindTexture(GL_TEXTURE_2D, surface->dataTexName());
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, &original[0]);
+        glState::bindTexture(GL_TEXTURE_2D, 0);
+
+        // half the size, values exact in the 16 bit floats of the surface
+        WaterSnapshotHeader header = makeHeader(*surface);
+        header.mWidth     = std::max(width / 2, 2u);
+        header.mHeight    = std::max(height / 2, 2u);
+        header.mStep      = step + 1;
+        header.mPlaneSize = sizeof(float) * 2 * header.mWidth * header.mHeight;
+
+        std::vector<float> data(2 * header.mWidth * header.mHeight);
+        for (GLuint y = 0; y < header.mHeight; ++y)
+        {
+            for (GLuint x = 0; x < header.mWidth; ++x)
+            {
+                data[2 * (y * header.mWidth + x)]     = (float)(x % 8) * 0.125f;
+                data[2 * (y * header.mWidth + x) + 1] = (float)(y % 4) * -0.25f;
+            }
+        }
+
+        std::atomic<bool> writing(true);
+        writeFile(fileName, header, data, &writing);
+
+        while (glGetError() != GL_NO_ERROR)
+            ;
+
+        bool ok = load(fileName, surface, false);
+        remove(fileName);
+
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            LOG_ERROR("GL error 0x%x when restoring a %dx%d snapshot into a %dx%d surface", error, header.mWidth, header.mHeight, width, height);
+            ok = false;
+        }
+
+        if (ok)
+        {
+            glState::bindFramebuffer(GL_FRAMEBUFFER, surface->dataFboName());
+            ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            FrameBuffer::bindSystemFrameBuffer();
+
+            std::vector<float> restored(data.size());
+            glState::bindTexture(GL_TEXTURE_2D, surface->dataTexName());
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, &restored[0]);
+            glState::bindTexture(GL_TEXTURE_2D, 0);
+
+            ok = ok && surface->width() == header.mWidth && surface->height() == header.mHeight &&
+                 surface->step() == header.mStep && restored == data;
+            if (!ok)
+                LOG_ERROR("the %dx%d snapshot is not restored correctly", header.mWidth, header.mHeight);
+        }
+
+        // and back to the original size
+        if (surface->setState(width, height, step, &original[0]) == false)
+            ok = false;
+        surface->updateNormals();
+
+        error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            LOG_ERROR("GL error 0x%x when restoring the %dx%d state", error, width, height);
+            ok = false;
+        }
+
+        if (ok)
+            LOG_SUCCESS("snapshot restore with a different size: ok");
+
+        return ok;
+    }
+} // namespace waterSnapshot
@@ -0,0 +1,111 @@
+/** @file waterSnapshot.h
+*  @brief water state saved to a file and restored from it
+*
+*	@author Bartlomiej Filipek
+*/
+
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <deque>
+
+#include "PixelReadback.h"
+
+class WaterSurface;
+struct WaterHeightField;
+
+/** file layout of a snapshot
+*
+* the fixed header is followed (at mPlaneOffset, aligned to SNAPSHOT_PLANE_ALIGNMENT) by planes of raw data.
+* Version 1 has one plane: width*height pairs of floats (height, velocity), rows from the bottom,
+* exactly what glTexSubImage2D(GL_RG, GL_FLOAT) takes, so a mapped file is uploaded without any copy.
+*/
+struct WaterSnapshotHeader
+{
+    enum Flags
+    {
+        FLAG_TILEABLE        = 1,
+        FLAG_PROCEDURAL_RAIN = 2
+    };
+
+    unsigned int mMagic;
+    unsigned int mVersion;
+    unsigned int mHeaderSize;      //!< sizeof(WaterSnapshotHeader)
+    unsigned int mWidth;
+    unsigned int mHeight;
+    unsigned int mStep;
+    unsigned int mFlags;
+    unsigned int mPlaneCount;
+    unsigned int mPlaneOffset;     //!< from the start of the file
+    unsigned int mPlaneSize;       //!< bytes of one plane
+
+    // WaterSurface parameters:
+    double mFadeDY;
+    double mGatherFactor;
+    double mFadeY;
+    double mNormalScale;
+    double mOffsetScale;
+    double mRainDropsPerStep;
+    double mRainPressure;
+    double mBodyCoupling;
+};
+
+/// page size, planes can be mapped and read with any alignment the driver likes
+const unsigned int SNAPSHOT_PLANE_ALIGNMENT = 4096;
+
+/** saves snapshots without stalling the simulation
+*
+* request() only queues a read of the current state (PixelReadback), update() collects it
+* a few frames later and a worker thread writes the file (to "name.tmp" first, then renamed,
+* so a crash never leaves a half written snapshot).
+*/
+class WaterSnapshotWriter
+{
+private:
+    struct Pending
+    {
+        std::string         mFileName;
+        WaterSnapshotHeader mHeader;
+    };
+
+    PixelReadback       mReadback;
+    std::deque<Pending> mPending;      //!< in the order of the readbacks
+    std::thread         mWriter;
+    std::atomic<bool>   mWriting;      //!< cleared by the writer thread when the file is done
+public:
+    WaterSnapshotWriter();
+    ~WaterSnapshotWriter();
+
+    /// reads the state of the surface for the file, call it outside beginUpdate/endUpdate
+    /// @return false when the previous reads are still pending
+    bool request(const WaterSurface &surface, const char *fileName);
+
+    /// collects finished reads and starts writing them, call it once per frame
+    /// @return true when a snapshot went to the writer
+    bool update();
+
+    /// true while reads are in flight or a file is written
+    bool isBusy() const { return mPending.empty() == false || mWriting; }
+
+    /// waits for the file that is being written
+    void finish();
+private:
+    // block copying:
+    WaterSnapshotWriter(const WaterSnapshotWriter &);
+    WaterSnapshotWriter & operator=(const WaterSnapshotWriter &);
+};
+
+namespace waterSnapshot
+{
+    /// maps the file and uploads it straight into the surface (resized when needed)
+    /// @param restoreParams when true the simulation parameters of the file are set too
+    bool load(const char *fileName, WaterSurface *surface, bool restoreParams = true);
+
+    /// the same file into the CPU grid (WaterReadback layout, full resolution)
+    bool load(const char *fileName, WaterHeightField *field);
+
+    /// writes a snapshot of a different size, restores it and then the original state,
+    /// false on GL errors or when the data read back differs from the file (see runChecks)
+    bool checkResizedRestore(WaterSurface *surface, const char *fileName);
+} // namespace waterSnapshot
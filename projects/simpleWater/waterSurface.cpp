@@ -10,18 +10,22 @@
 #include "Init.h"
 #include "Log.h"
 #include "DisplayUtils.h"
-#include "shaderProgram.h"
-#include "shaderLoader.h"
-#include "texture.h"
-#include "framebuffer.h"
+#include "Shader.h"
+#include "ShaderProgram.h"
+#include "ShaderLoader.h"
+#include "Texture.h"
+#include "Framebuffer.h"
+#include "GLState.h"
 
-#include "WaterSurface.h"
+#include "waterSurface.h"
+#include "uniformBlocks.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 WaterSurface::WaterSurface()
 {
     mWidth  = 0;
     mHeight = 0;
+    mBaseWidth = 0;
 
     mfadeDY = 0.990;
     mgatherFactor = 1.0/4.0;
@@ -29,16 +33,35 @@ WaterSurface::WaterSurface()
 
     mNormalScale = 1.0;
 
+    mProceduralRain = false;
+    mRainDropsPerStep = 1.0;
+    mRainPressure = 2.5;
+    mBodyCoupling = 0.5;
+
+    mDynamicResolution = false;
+    mStepBudget = 1.0;
+    mMinSize = 128;
+    mMaxSize = 1024;
+    mResizeCooldown = 0;
+
     mEnabled = false;
+    mTileable = false;
+    mNormalMapEnabled = true;
 
     mCurrID = 0;
+    mStep = 0;
 
     // clear ids:
     mWaterDataTex[0] = 0;
     mWaterDataTex[1] = 0;
     mNormalsTex = 0;
+    mNormalLevelCount = 0;
+    mNormalLevelsUsed = 1;
     mQuadVBO = 0;
     mQuadVAO = 0;
+    mSplatVBO = 0;
+    mSplatVAO = 0;
+    mSplatCapacity = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -51,6 +74,9 @@ WaterSurface::~WaterSurface()
 
     glDeleteBuffers(1, &mQuadVBO);
     glDeleteVertexArrays(1, &mQuadVAO);
+    glDeleteBuffers(1, &mSplatVBO);
+    glDeleteVertexArrays(1, &mSplatVAO);
+    glState::invalidate();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -59,6 +85,7 @@ bool WaterSurface::init(GLuint width, GLuint height)
 {
     mWidth = width;
     mHeight = height;
+    mBaseWidth = width;
 
     mfadeDY = 0.9f;
     mgatherFactor = 1.0f/4.0f;
@@ -70,6 +97,7 @@ bool WaterSurface::init(GLuint width, GLuint height)
     mEnabled = true;
 
     mCurrID = 0;
+    mStep = 0;
 
     CHECK_OPENGL_ERRORS();
     if (initBuffers() == false)
@@ -78,15 +106,182 @@ bool WaterSurface::init(GLuint width, GLuint height)
     if (initShaders() == false)
         return false;
 
+    if (mParamsRing.init(1, sizeof(uniformBlocks::WaterParams)) == false)
+        return false;
+
     CHECK_OPENGL_ERRORS();
     displayUtils::initQuadGeometry(&mQuadVAO, &mQuadVBO);
     CHECK_OPENGL_ERRORS();
 
+    //
+    // splats: (x, y, height, weight), diameter
+    //
+    const GLsizei STRIDE = sizeof(Splat);
+    mSplatCapacity = 64;
+    mSplats.clear();
+    mSplats.reserve(mSplatCapacity);
+
+    glGenVertexArrays(1, &mSplatVAO);
+    glState::bindVertexArray(mSplatVAO);
+
+    glGenBuffers(1, &mSplatVBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, mSplatVBO);
+    glBufferData(GL_ARRAY_BUFFER, STRIDE * mSplatCapacity, NULL, GL_STREAM_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, STRIDE, (const void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, STRIDE, (const void *)(sizeof(float)*4));
+
+    glState::bindVertexArray(0);
+    CHECK_OPENGL_ERRORS();
+
+    mStepTimer.init();
+    mResizeCooldown = 0;
+
     mBeginUpdateCalled = false;
 
     return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+bool WaterSurface::resize(GLuint width, GLuint height)
+{
+    if (width == mWidth && height == mHeight)
+        return true;
+
+    if (mBeginUpdateCalled)
+    {
+        LOG_ERROR("resize cannot be called between beginUpdate and endUpdate!");
+        return false;
+    }
+
+    // keep the current state, initBuffers would delete it
+    GLuint oldTex = mWaterDataTex[mCurrID];
+    mWaterDataTex[mCurrID] = 0;
+
+    const GLuint oldWidth  = mWidth;
+    const GLuint oldHeight = mHeight;
+    mWidth  = width;
+    mHeight = height;
+
+    bool ok = initBuffers();
+
+    //
+    // resample: linear filter averages 2x2 texels when going down and interpolates when going up,
+    // so the waves keep their shape and only lose (or do not gain) the finest details
+    //
+    if (ok)
+    {
+        FrameBuffer oldFbo;
+        oldFbo.createAndBind();
+        oldFbo.attachTextureAsColorTarget(0, oldTex, oldWidth, oldHeight, GL_TEXTURE_2D);
+        ok = oldFbo.check();
+
+        if (ok)
+        {
+            glState::bindFramebuffer(GL_READ_FRAMEBUFFER, oldFbo.getId());
+            glState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, mFboForWater[mCurrID].getId());
+            glBlitFramebuffer(0, 0, oldWidth, oldHeight, 0, 0, mWidth, mHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+
+        FrameBuffer::bindSystemFrameBuffer();
+        oldFbo.destroy();
+    }
+
+    glDeleteTextures(1, &oldTex);
+    glState::invalidate();
+
+    if (!ok)
+        LOG_ERROR("cannot resize the water surface to %dx%d!", mWidth, mHeight);
+
+    CHECK_OPENGL_ERRORS();
+    return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+bool WaterSurface::setState(GLuint width, GLuint height, GLuint step, const float *heightVelocity)
+{
+    assert(heightVelocity);
+
+    if (mBeginUpdateCalled)
+    {
+        LOG_ERROR("setState cannot be called between beginUpdate and endUpdate!");
+        return false;
+    }
+
+    // nothing to keep, the whole grid is overwritten
+    if (width != mWidth || height != mHeight)
+    {
+        mWidth  = width;
+        mHeight = height;
+        if (initBuffers() == false)
+        {
+            LOG_ERROR("cannot resize the water surface to %dx%d!", mWidth, mHeight);
+            return false;
+        }
+
+        // a restored size should stay for a while, times measured before are of a different grid;
+        // the replay calls this every step, so with the same size the pending queries are kept
+        mStepTimer.init();
+        mResizeCooldown = 2 * AsyncTimerQuery::RING_SIZE;
+    }
+
+    glState::bindTexture(GL_TEXTURE_2D, mWaterDataTex[mCurrID]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mWidth, mHeight, GL_RG, GL_FLOAT, heightVelocity);
+    glState::bindTexture(GL_TEXTURE_2D, 0);
+
+    mStep = step;
+
+    CHECK_OPENGL_ERRORS();
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::updateResolution()
+{
+    // results are a few steps late, measurements of the previous size have to go away first
+    mStepTimer.poll();
+    if (mResizeCooldown > 0)
+    {
+        mResizeCooldown--;
+        return;
+    }
+
+    if (!mDynamicResolution || !mStepTimer.hasResult())
+        return;
+
+    // the cost is proportional to the texel count: 4x when the size doubles,
+    // going up needs some headroom so that it does not go back right away
+    GLuint newWidth = mWidth;
+    GLuint newHeight = mHeight;
+    const double time = mStepTimer.getTime();
+    if (time > mStepBudget && mWidth / 2 >= mMinSize)
+    {
+        newWidth = mWidth / 2;
+        newHeight = std::max(mHeight / 2, 1u);
+    }
+    else if (time * 4.0 < mStepBudget * 0.75 && mWidth * 2 <= mMaxSize)
+    {
+        newWidth = mWidth * 2;
+        newHeight = mHeight * 2;
+    }
+
+    if (newWidth == mWidth)
+        return;
+
+    if (resize(newWidth, newHeight))
+    {
+        // the smoothed time is of the old size
+        mStepTimer.init();
+        mResizeCooldown = 2 * AsyncTimerQuery::RING_SIZE;
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////
 void WaterSurface::beginUpdate()
@@ -97,27 +292,36 @@ void WaterSurface::beginUpdate()
     if (mBeginUpdateCalled)
         LOG_ERROR("beginUpdate called but was not finished with endUpdate probably!");
 
+    updateResolution();
+    mStepTimer.begin();
+
     // ping pong buffers
     GLuint nextID = 1 - mCurrID;
 
-    glGetIntegerv(GL_VIEWPORT, mSavedViewport);
+    glState::getViewport(mSavedViewport);
 
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    glState::setDepthTest(false);
+    glState::setBlend(false);
 
-    float densities[3] = { (float)mfadeDY, (float)mgatherFactor, (float)mfadeY };
+    //
+    // parameters for both passes in one block
+    //
+    const bool rain = mProceduralRain && mRainPressure > 0.0;
+    uploadParams(rain);
 
     //
     // 1. bind fbo for DY, set Y texture for shader
     //
     mFboForWater[nextID].bind(true);
-    mComputeShader.use();
-    mComputeShader.uniform3f("density", densities[0], densities[1], densities[2]);
-    mComputeShader.uniform2f("texelSize", (float)mOffsetScale/(float)mWidth, (float)mOffsetScale/(float)mHeight);
-    glActiveTexture(GL_TEXTURE0);
-    mFboForWater[mCurrID].bindColorTargetAsTexture(0); 
+    ShaderProgram *compute = computeShader(rain);
+    if (compute)
+    {
+        compute->use();
+        glState::activeTexture(GL_TEXTURE0);
+        mFboForWater[mCurrID].bindColorTargetAsTexture(0); 
 
-    displayUtils::drawQuad(mQuadVAO); 
+        displayUtils::drawQuad(mQuadVAO); 
+    }
     mDrawShader.use();
 
     mBeginUpdateCalled = true;
@@ -134,30 +338,184 @@ void WaterSurface::endUpdate()
     GLuint nextID = 1 - mCurrID;		
 
     //
-    // 2. calculate normals
+    // 2. queued drops and bodies, all in one draw
     //
-    mFboForNormals.bind(false);		// this time we do not have to set new viepoer, its the same as before
-    mComputeNormalsShader.use();
-    mComputeNormalsShader.uniform1f("normalScale", (float)mNormalScale);
-    mComputeNormalsShader.uniform2f("texelSize", (float)mOffsetScale/(float)mWidth, (float)mOffsetScale/(float)mHeight);
-    mFboForWater[nextID].bindColorTargetAsTexture(0);
-    displayUtils::drawQuad(mQuadVAO); 
+    drawSplats();
 
+    //
+    // 3. calculate normals
+    //
+    if (mNormalMapEnabled)
+    {
+        mFboForNormals.bind(false);		// this time we do not have to set new viepoer, its the same as before
+        mComputeNormalsShader.use();
+        mFboForWater[nextID].bindColorTargetAsTexture(0);
+        displayUtils::drawQuad(mQuadVAO); 
+
+        if (mNormalLevelsUsed > 1)
+            downsampleNormals();
+    }
 
     mComputeNormalsShader.disable();
+    mParamsRing.endFrame();
 
     // this is called inside the bindSystemFrameBuffer() method
     //mFboForNormals.unbind();
 
+    mStepTimer.end();
+
     mCurrID = nextID;
+    mStep++;
 
     // restore:
     FrameBuffer::bindSystemFrameBuffer();
-    glViewport(mSavedViewport[0], mSavedViewport[1], mSavedViewport[2], mSavedViewport[3]);
+    glState::viewport(mSavedViewport[0], mSavedViewport[1], mSavedViewport[2], mSavedViewport[3]);
 
     mBeginUpdateCalled = false;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::updateNormals()
+{
+    if (!mEnabled || !mNormalMapEnabled)
+        return;
+
+    if (mBeginUpdateCalled)
+    {
+        LOG_ERROR("updateNormals cannot be called between beginUpdate and endUpdate!");
+        return;
+    }
+
+    int savedViewport[4];
+    glState::getViewport(savedViewport);
+    glState::setDepthTest(false);
+    glState::setBlend(false);
+
+    uploadParams(false);
+
+    // the same pass as in endUpdate, only from the current state
+    mFboForNormals.bind(true);
+    mComputeNormalsShader.use();
+    mFboForWater[mCurrID].bindColorTargetAsTexture(0);
+    displayUtils::drawQuad(mQuadVAO);
+
+    if (mNormalLevelsUsed > 1)
+        downsampleNormals();
+
+    mComputeNormalsShader.disable();
+    mParamsRing.endFrame();
+
+    FrameBuffer::bindSystemFrameBuffer();
+    glState::viewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::uploadParams(bool proceduralRain)
+{
+    uniformBlocks::WaterParams params;
+    params.mDensity     = glm::vec4((float)mfadeDY, (float)mgatherFactor, (float)mfadeY, 0.0f);
+    params.mTexelSize   = glm::vec2((float)mOffsetScale/(float)mWidth, (float)mOffsetScale/(float)mHeight);
+    params.mNormalScale = normalScale();
+    params.mRainSeed    = (int)mStep;
+    params.mRainParams  = glm::vec2(0.0f);
+    if (proceduralRain)
+        params.mRainParams = glm::vec2((float)(mRainDropsPerStep / ((double)mWidth*(double)mHeight)), (float)mRainPressure);
+
+    mParamsRing.beginFrame();
+    mParamsRing.upload(uniformBlocks::WATER_PARAMS_BINDING, &params, sizeof(params));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::addDrop(float x, float y, float pressure, float radius)
+{
+    if (!mEnabled)
+        return;
+
+    Splat splat;
+    splat.mX        = x;
+    splat.mY        = y;
+    splat.mHeight   = pressure;
+    splat.mWeight   = 1.0f;
+    splat.mDiameter = std::max(radius * (float)mWidth, 1.5f);     // -1..1 covers mWidth texels
+    mSplats.push_back(splat);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::addBodyFootprint(float x, float y, float radius, float submergedVolume)
+{
+    if (!mEnabled || radius <= 0.0f || submergedVolume <= 0.0f)
+        return;
+
+    // falloff (1-r^2)^2 used in the shader has 1/3 of the volume of a cylinder
+    const float area = 3.14159265f * radius * radius;
+
+    Splat splat;
+    splat.mX        = x;
+    splat.mY        = y;
+    splat.mHeight   = -3.0f * submergedVolume / area;
+    splat.mWeight   = (float)mBodyCoupling;
+    splat.mDiameter = radius * (float)mWidth;
+    mSplats.push_back(splat);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::drawSplats()
+{
+    if (mSplats.empty())
+        return;
+
+    // orphan the buffer every time, grow it when needed
+    if (mSplats.size() > mSplatCapacity)
+        mSplatCapacity = std::max((GLuint)mSplats.size(), 2 * mSplatCapacity);
+
+    glState::bindBuffer(GL_ARRAY_BUFFER, mSplatVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Splat) * mSplatCapacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Splat) * mSplats.size(), &mSplats[0]);
+
+    // result = src + dst * (1 - src.a), so the water moves towards the splat's height
+    glState::setBlend(true);
+    glState::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    mSplatShader.use();
+    glState::bindVertexArray(mSplatVAO);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)mSplats.size());
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glState::setBlend(false);
+
+    mSplats.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::setTileable(bool tileable)
+{
+    if (mTileable == tileable)
+        return;
+
+    mTileable = tileable;
+
+    // neighbours in the update and normals passes are read through the same textures,
+    // so changing the wrap mode is enough to make the simulation periodic
+    const GLenum wrap = mTileable ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    const GLuint textures[3] = { mWaterDataTex[0], mWaterDataTex[1], mNormalsTex };
+    for (int i = 0; i < 3; ++i)
+    {
+        if (textures[i] == 0)
+            continue;
+
+        glState::bindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////
 bool WaterSurface::initBuffers()
@@ -169,23 +527,29 @@ bool WaterSurface::initBuffers()
     if (mWaterDataTex[0] > 0) glDeleteTextures(1, &mWaterDataTex[0]);
     if (mWaterDataTex[1] > 0) glDeleteTextures(1, &mWaterDataTex[1]);
     if (mNormalsTex > 0)      glDeleteTextures(1, &mNormalsTex);
+    // resize() and setState() come here again: fresh fbos, otherwise the old ids leak
+    // and the color attachment is listed twice in the draw buffers
+    mFboForWater[0].destroy();
+    mFboForWater[1].destroy();
+    glState::invalidate();
 
-    // 
+    //
     // generate textures:
     //
     // todo: use some Texture class...
-    mWaterDataTex[0] = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGB16F, GL_RGB, GL_FLOAT, GL_CLAMP_TO_EDGE);
-    mWaterDataTex[1] = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGB16F, GL_RGB, GL_FLOAT, GL_CLAMP_TO_EDGE);
-    mNormalsTex      = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, GL_CLAMP_TO_EDGE);
+    const GLenum wrap = mTileable ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    mWaterDataTex[0] = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGB16F, GL_RGB, GL_FLOAT, wrap);
+    mWaterDataTex[1] = textureLoader::createEmptyTexture2D(mWidth, mHeight, GL_RGB16F, GL_RGB, GL_FLOAT, wrap);
+    mNormalsTex = 0;
     CHECK_OPENGL_ERRORS();
     // get current settings:
     int view[4];
-    glGetIntegerv(GL_VIEWPORT, view);
+    glState::getViewport(view);
     float col[4];
     glGetFloatv(GL_COLOR_CLEAR_VALUE, col);
 
     // new viewport:
-    glViewport(0, 0, mWidth, mHeight);
+    glState::viewport(0, 0, mWidth, mHeight);
     //
     // fbo:
     //
@@ -210,59 +574,211 @@ bool WaterSurface::initBuffers()
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    // restore:
+    FrameBuffer::bindSystemFrameBuffer();
+    glState::viewport(view[0], view[1], view[2], view[3]);
+    glClearColor(col[0], col[1], col[2], col[3]);
 
     // 3:
-    mFboForNormals.createAndBind();
-    mFboForNormals.attachTextureAsColorTarget(0, mNormalsTex, mWidth, mHeight, GL_TEXTURE_2D);
-    mFboForNormals.setDrawBuffers();
+    if (mNormalMapEnabled)
+        return createNormalsTarget();
+
+    return true;
+}
 
-    mFboForNormals.check();
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+bool WaterSurface::createNormalsTarget()
+{
+    destroyNormalsTarget();
 
-    glClearColor(0.0f, 0.0f, 1.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // full mip chain is allocated, but only mNormalLevelsUsed levels are generated
+    const GLenum wrap = mTileable ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    mNormalLevelCount = std::min(textureLoader::mipLevelCount(mWidth, mHeight), MAX_NORMAL_LEVELS);
+    mNormalLevelsUsed = std::min(mNormalLevelsUsed, mNormalLevelCount);
+    mNormalsTex = textureLoader::createEmptyTexture2DMipmaps(mWidth, mHeight, mNormalLevelCount, GL_RGBA8, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mNormalLevelsUsed - 1);
+
+    float col[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, col);
+
+    // flat water, alpha - length of the averaged normal:
+    glClearColor(0.5f, 0.5f, 1.0f, 1.0f);
+
+    bool complete = true;
+    for (GLuint level = 0; level < mNormalLevelCount; ++level)
+    {
+        const int w = std::max((int)mWidth >> level, 1);
+        const int h = std::max((int)mHeight >> level, 1);
+
+        FrameBuffer &fbo = level == 0 ? mFboForNormals : mFboForNormalLevels[level];
+        fbo.createAndBind();
+        fbo.attachTextureAsColorTarget(0, mNormalsTex, w, h, GL_TEXTURE_2D, level);
+        fbo.setDrawBuffers();
+        complete = fbo.check() && complete;
+
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
 
-    // restore:
     FrameBuffer::bindSystemFrameBuffer();
-    glViewport(view[0], view[1], view[2], view[3]);
     glClearColor(col[0], col[1], col[2], col[3]);
 
+    if (!complete)
+    {
+        LOG_ERROR("cannot create target for the water normals!");
+        return false;
+    }
+
     return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////
-bool WaterSurface::initShaders()
+void WaterSurface::destroyNormalsTarget()
 {
-    if (!shaderLoader::loadAndBuildShaderPairFromFile(&mDrawShader, "shaders/waterPassThrough.vs", "shaders/waterDraw.fs"))
+    mFboForNormals.destroy();
+    for (GLuint level = 1; level < MAX_NORMAL_LEVELS; ++level)
+        mFboForNormalLevels[level].destroy();
+
+    if (mNormalsTex > 0)
     {
-        return false;
+        glDeleteTextures(1, &mNormalsTex);
+        glState::invalidate();
+    }
+    mNormalsTex = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::setNormalMipLevels(GLuint levels)
+{
+    levels = std::max(levels, 1u);
+    if (mNormalLevelCount > 0)
+        levels = std::min(levels, mNormalLevelCount);
+
+    if (levels == mNormalLevelsUsed)
+        return;
+
+    mNormalLevelsUsed = levels;
+
+    // levels that are not generated must not be sampled
+    if (mNormalsTex > 0)
+    {
+        glState::bindTexture(GL_TEXTURE_2D, mNormalsTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mNormalLevelsUsed - 1);
     }
+}
 
-    if (!shaderLoader::loadAndBuildShaderPairFromFile(&mComputeShader, "shaders/waterPassThrough.vs", "shaders/waterUpdate.fs"))
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::downsampleNormals()
+{
+    mDownsampleNormalsShader.use();
+    glState::bindTextureToUnit(0, GL_TEXTURE_2D, mNormalsTex);
+
+    for (GLuint level = 1; level < mNormalLevelsUsed; ++level)
     {
-        return false;
+        // only the previous level is visible to the shader, so there is no feedback loop
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+
+        mFboForNormalLevels[level].bind(true);
+        displayUtils::drawQuad(mQuadVAO);
     }
 
-    mComputeShader.use();
-    mComputeShader.uniform1i("texture0", 0);
-    mComputeShader.uniform2f("texelSize", (float)mOffsetScale/(float)mWidth, (float)mOffsetScale/(float)mHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mNormalLevelsUsed - 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::setNormalMapEnabled(bool enabled)
+{
+    if (mNormalMapEnabled == enabled)
+        return;
+
+    mNormalMapEnabled = enabled;
+
+    // nothing to create yet, init will do it
+    if (mWaterDataTex[0] == 0)
+        return;
+
+    if (mNormalMapEnabled)
+        createNormalsTarget();
+    else
+        destroyNormalsTarget();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+ShaderProgram *WaterSurface::computeShader(bool proceduralRain)
+{
+    ShaderDefines defines;
+    if (proceduralRain)
+        defines.set("PROCEDURAL_RAIN");
+
+    // both variants are built in initShaders, so this is only a lookup
+    bool created = false;
+    ShaderProgram *prog = mComputePermutations.get(defines, &created);
+    if (created)
+        setupComputeShader(prog);
+
+    return prog;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+void WaterSurface::setupComputeShader(ShaderProgram *prog)
+{
+    prog->use();
+    prog->uniform1i("texture0", 0);
+    prog->uniformBlockBinding("WaterParams", uniformBlocks::WATER_PARAMS_BINDING);
+}
 
-    if (!shaderLoader::loadAndBuildShaderPairFromFile(&mComputeNormalsShader, "shaders/waterPassThrough.vs", "shaders/waterUpdateNormals.fs"))
+/////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////
+bool WaterSurface::initShaders()
+{
+    // all programs (both variants of the update pass too) are compiled by the driver at the same time
+    ShaderDefines noRain;
+    ShaderDefines rain;
+    rain.set("PROCEDURAL_RAIN");
+
+    shaderLoader::ProgramBatch batch;
+    mComputePermutations.init("shaders/waterPassThrough.vs", NULL, NULL, NULL, "shaders/waterUpdate.fs");
+    ShaderProgram *computeNoRain = mComputePermutations.prepare(noRain, &batch);
+    ShaderProgram *computeRain   = mComputePermutations.prepare(rain, &batch);
+    bool ok = computeNoRain != NULL && computeRain != NULL &&
+              batch.add(&mDrawShader, "shaders/waterPassThrough.vs", NULL, NULL, NULL, "shaders/waterDraw.fs") &&
+              batch.add(&mComputeNormalsShader, "shaders/waterPassThrough.vs", NULL, NULL, NULL, "shaders/waterUpdateNormals.fs") &&
+              batch.add(&mDownsampleNormalsShader, "shaders/waterPassThrough.vs", NULL, NULL, NULL, "shaders/waterNormalsDownsample.fs") &&
+              batch.add(&mSplatShader, "shaders/waterSplat.vs", NULL, NULL, NULL, "shaders/waterSplat.fs");
+
+    if (!batch.finish() || !ok)
     {
         return false;
     }
 
+    setupComputeShader(computeNoRain);
+    setupComputeShader(computeRain);
+
     mComputeNormalsShader.use();
     mComputeNormalsShader.uniform1i("texture0", 0);
-    mComputeNormalsShader.uniform2f("texelSize", (float)mOffsetScale/(float)mWidth, (float)mOffsetScale/(float)mHeight);
+    mComputeNormalsShader.uniformBlockBinding("WaterParams", uniformBlocks::WATER_PARAMS_BINDING);
+
+    mDownsampleNormalsShader.use();
+    mDownsampleNormalsShader.uniform1i("texture0", 0);
 
 #ifdef _DEBUG
     mDrawShader.validate();
-    mComputeShader.validate();
+    computeNoRain->validate();
+    computeRain->validate();
     mComputeNormalsShader.validate();
+    mDownsampleNormalsShader.validate();
+    mSplatShader.validate();
 #endif
 
-    glUseProgram(0);
+    glState::useProgram(0);
 
     return true;
 }
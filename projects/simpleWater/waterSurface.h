@@ -6,39 +6,93 @@
 
 #pragma once
 
-#include "FrameBuffer.h"
+#include "Framebuffer.h"
+#include "UniformBufferRing.h"
+#include "TimeQuery.h"
+#include "ShaderLoader.h"
 
 /** simple heght map based water surface simulation that is performed on the GPU
 *
-* result: two textures: one with height data (height, velocity) and the next one with normals
+* result: two textures: one with height data (height, velocity) and the next one with normals,
+* the normal pass can be turned off (setNormalMapEnabled) when the renderer derives normals from the heights
 *
-* drawing on the water can be done between beginUpdate and endUpdate methods
+* drawing on the water can be done between beginUpdate and endUpdate methods,
+* raindrops can be also generated procedurally on the GPU (see mProceduralRain)
+* or queued with addDrop. Floating bodies push the water down with addBodyFootprint,
+* all queued drops and footprints are drawn with one draw call in endUpdate
+*
+* the grid can be resized at any time (resize), the state is resampled so the waves continue,
+* with mDynamicResolution the size is halved/doubled to keep the GPU time of a step in mStepBudget
 *
 * in the next version of the class, normal map calcultions should be done outside
 */
 class WaterSurface
 {
+public:
+    /// enough for 65536 x 65536 grid
+    static const GLuint MAX_NORMAL_LEVELS = 17;
 protected:
     GLuint mWidth;
     GLuint mHeight;
+    /// size passed to init, mNormalScale is relative to its texel size
+    GLuint mBaseWidth;
 
     GLuint mCurrID;
 
+    /// number of simulation steps done so far, seeds the procedural rain
+    GLuint mStep;
+
     FrameBuffer mFboForWater[2];
     FrameBuffer mFboForNormals;
+    /// targets for the mip levels of the normal map (index = level, 0 is not used)
+    FrameBuffer mFboForNormalLevels[MAX_NORMAL_LEVELS];
 
     GLuint mWaterDataTex[2];
     GLuint mNormalsTex;
+    /// levels allocated in mNormalsTex
+    GLuint mNormalLevelCount;
+    /// levels generated in every step, the rest is not visible
+    GLuint mNormalLevelsUsed;
 
     GLuint mQuadVBO;
     GLuint mQuadVAO;
 
+    /// drop or footprint of a body, drawn as a point sprite
+    struct Splat
+    {
+        float mX, mY;       //!< from -1 to 1
+        float mHeight;      //!< target height of the water
+        float mWeight;      //!< 1 - water gets mHeight, less - only moves towards it
+        float mDiameter;    //!< in texels
+    };
+    std::vector<Splat> mSplats;
+    GLuint mSplatVBO;
+    GLuint mSplatVAO;
+    GLuint mSplatCapacity;
+
     ShaderProgram mDrawShader;
-    ShaderProgram mComputeShader;
+    /// update pass, variants: with and without procedural rain (PROCEDURAL_RAIN)
+    shaderLoader::PermutationCache mComputePermutations;
     ShaderProgram mComputeNormalsShader;
+    ShaderProgram mDownsampleNormalsShader;
+    ShaderProgram mSplatShader;
+
+    /// "WaterParams" block for the update and normals passes, one part per step
+    UniformBufferRing mParamsRing;
 
     bool mEnabled;
 
+    /// textures wrap around, the simulation is periodic and the result can be tiled
+    bool mTileable;
+
+    /// normals pass and its target are used
+    bool mNormalMapEnabled;
+
+    /// GPU time of beginUpdate..endUpdate, read a few steps later
+    AsyncTimerQuery mStepTimer;
+    /// steps left before the next resolution change is allowed
+    GLuint mResizeCooldown;
+
     /// for beginUpdate/endUpdate matching...
     bool mBeginUpdateCalled;
     /// saved viewport so that it can be restored in the endUpdate
@@ -56,6 +110,22 @@ public:
     /// distance to neighbour - 1.0 is the default value, 
     /// used in normal map update and water simulation update
     double mOffsetScale;
+    /// when true raindrops are generated in the update shader, nothing has to be drawn
+    /// between beginUpdate and endUpdate, default value is false
+    bool mProceduralRain;
+    /// procedural rain: average number of drops over the whole surface in one step
+    double mRainDropsPerStep;
+    /// procedural rain: max pressure of a drop, the same scale as the drawn drops use
+    double mRainPressure;
+    /// how fast the water under a floating body moves to the body's displacement (0..1), default value is 0.5
+    double mBodyCoupling;
+    /// when true the grid is resized (by a factor of 2) in beginUpdate so that a step takes about mStepBudget, default is false
+    bool mDynamicResolution;
+    /// GPU time of one step in miliseconds, default value is 1
+    double mStepBudget;
+    /// limits of the dynamic resolution (width), default is 128..1024
+    GLuint mMinSize;
+    GLuint mMaxSize;
 public:
     WaterSurface();
     virtual ~WaterSurface();
@@ -63,17 +133,76 @@ public:
     /// initializes all the needed data
     bool init(GLuint width, GLuint height);
 
+    /// changes the grid size, height and velocity are bilinearly resampled from the current grid,
+    /// can be called only outside beginUpdate/endUpdate
+    bool resize(GLuint width, GLuint height);
+
+    /// replaces the whole state (restoring a snapshot), the grid gets the given size if it differs
+    /// @param heightVelocity width*height pairs of floats (height, velocity), rows from the bottom
+    /// @param step value for step(), the procedural rain continues from it
+    bool setState(GLuint width, GLuint height, GLuint step, const float *heightVelocity);
+
+    /// runs the normals pass on the current state, needed after setState when no step follows
+    /// (replaying a recording), endUpdate does it on its own
+    void updateNormals();
+
     void beginUpdate();
     void endUpdate();
 
+    /// queues a raindrop for the next update, the water gets height = pressure at the drop
+    /// @param x, y position from -1 to 1
+    /// @param radius in the same units as the position, 0 means the smallest drop
+    void addDrop(float x, float y, float pressure, float radius = 0.0f);
+
+    /// queues a footprint of a floating body for the next update, the water below is pushed down
+    /// so that it makes room for the submerged volume
+    /// @param x, y, radius footprint on the surface, from -1 to 1
+    /// @param submergedVolume in surface units: area (in -1..1 space) * water height
+    void addBodyFootprint(float x, float y, float radius, float submergedVolume);
+
+    /// when true the water flows over the edges to the opposite side, so the textures
+    /// can be repeated over a larger area without seams, default is false (water reflects from the edges)
+    void setTileable(bool tileable);
+    bool tileable() const { return mTileable; }
+
+    /// when false the normals pass is skipped and its texture released, normalsTexName() returns 0
+    /// and normals have to be derived from dataTexName() (see renderSurface.fs), default is true
+    void setNormalMapEnabled(bool enabled);
+    bool normalMapEnabled() const { return mNormalMapEnabled; }
+
+    /// how many mip levels of the normal map are generated after every step (1 - only the base level),
+    /// levels are 2x2 box filtered, alpha keeps the length of the averaged normal (for Toksvig specular)
+    /// use the smallest number that covers the texel/pixel ratio of the view, default is 1
+    void setNormalMipLevels(GLuint levels);
+    GLuint normalMipLevels() const { return mNormalLevelsUsed; }
+    GLuint maxNormalMipLevels() const { return mNormalLevelCount; }
+
     const GLuint dataTexName() const { return mWaterDataTex[mCurrID]; }
     const GLuint normalsTexName() const { return mNormalsTex; }
+    /// fbo that has dataTexName() attached, useful for reading the data back
+    const GLuint dataFboName() const { return mFboForWater[mCurrID].getId(); }
 
     GLuint width() const { return mWidth; }
     GLuint height() const { return mHeight; }
+    GLuint step() const { return mStep; }
+    /// mNormalScale for the current texel size: the height differences of neighbours grow on a coarser grid,
+    /// so use it everywhere normals are calculated from the heights
+    float normalScale() const { return (float)mNormalScale * (float)mBaseWidth / (float)mWidth; }
+    /// smoothed GPU time of one step in miliseconds, 0 before the first result
+    double stepTime() const { return mStepTimer.getTime(); }
 protected:
     bool initShaders();
+    /// variant of the update pass for the current settings, NULL if it cannot be built
+    ShaderProgram *computeShader(bool proceduralRain);
+    void setupComputeShader(ShaderProgram *prog);
+    /// "WaterParams" block of the next passes, starts a new part of mParamsRing
+    void uploadParams(bool proceduralRain);
     bool initBuffers();
+    bool createNormalsTarget();
+    void destroyNormalsTarget();
+    void downsampleNormals();
+    void drawSplats();
+    void updateResolution();
 
     // block copying
     WaterSurface(const WaterSurface &) { }
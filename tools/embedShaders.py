@@ -0,0 +1,134 @@
+"""embedShaders.py - writes GLSL sources of a directory as a C++ table
+
+usage: python embedShaders.py <shader dir> <output .cpp> [path prefix]
+
+every *.vs, *.tcs, *.tes, *.gs, *.fs file becomes one entry of the table (see commonCode/ShaderSources.h),
+keyed by "<prefix>/<file name>" (prefix is "shaders" by default, the same paths the code loads).
+The output is rewritten only when it changes, so the project is not rebuilt for nothing.
+"""
+
+import os
+import sys
+
+EXTENSIONS = ('.vs', '.tcs', '.tes', '.gs', '.fs')
+
+# one literal has to be shorter than 64K in MSVC
+MAX_SOURCE_SIZE = 60000
+
+FNV_OFFSET = 0xcbf29ce484222325
+FNV_PRIME  = 0x100000001b3
+
+
+def fnv1a(data):
+    """the same as shaderSources::hashSource"""
+    h = FNV_OFFSET
+    for b in bytearray(data):
+        h ^= b
+        h = (h * FNV_PRIME) & 0xffffffffffffffff
+    return h
+
+
+def escape_line(line):
+    out = []
+    for c in line:
+        if c == '\\':
+            out.append('\\\\')
+        elif c == '"':
+            out.append('\\"')
+        elif c == '\t':
+            out.append('\\t')
+        elif c == '?':
+            out.append('\\?')        # no trigraphs
+        elif ord(c) < 32 or ord(c) > 126:
+            out.append('\\%03o' % ord(c))
+        else:
+            out.append(c)
+    return ''.join(out)
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 1
+
+    shader_dir = sys.argv[1]
+    output = sys.argv[2]
+    prefix = sys.argv[3] if len(sys.argv) > 3 else 'shaders'
+
+    names = sorted(f for f in os.listdir(shader_dir) if f.endswith(EXTENSIONS))
+
+    lines = []
+    lines.append('/** @file %s' % os.path.basename(output))
+    lines.append('*  @brief GLSL sources embedded in the executable')
+    lines.append('*')
+    lines.append('*  GENERATED by tools/embedShaders.py in the pre-build step, do not edit')
+    lines.append('*/')
+    lines.append('')
+    lines.append('#include "stdafx.h"')
+    lines.append('')
+    lines.append('#include "ShaderSources.h"')
+    lines.append('')
+    lines.append('namespace')
+    lines.append('{')
+
+    entries = []
+    for i, name in enumerate(names):
+        with open(os.path.join(shader_dir, name), 'rb') as f:
+            # files are read in the text mode at runtime, so CRLF becomes LF
+            data = f.read().replace(b'\r\n', b'\n')
+
+        if len(data) > MAX_SOURCE_SIZE:
+            print('embedShaders: %s is too big to embed (%d bytes)' % (name, len(data)))
+            return 1
+
+        text = data.decode('latin-1')
+        var = 'SOURCE_%d' % i
+        lines.append('    // %s' % name)
+        lines.append('    const char %s[] =' % var)
+        src_lines = text.split('\n')
+        if src_lines and src_lines[-1] == '':
+            src_lines.pop()
+            with_newline = True
+        else:
+            with_newline = False
+        if not src_lines:
+            lines.append('        ""')
+        for j, l in enumerate(src_lines):
+            nl = '\\n' if (j + 1 < len(src_lines) or with_newline) else ''
+            lines.append('        "%s%s"' % (escape_line(l), nl))
+        lines[-1] += ';'
+        lines.append('')
+
+        entries.append((prefix + '/' + name, var, fnv1a(data)))
+
+    lines.append('    const EmbeddedShader TABLE[] =')
+    lines.append('    {')
+    for path, var, h in entries:
+        lines.append('        { "%s", %s, 0x%016xULL },' % (path, var, h))
+    lines.append('    };')
+    lines.append('}')
+    lines.append('')
+    lines.append('///////////////////////////////////////////////////////////////////////////////')
+    lines.append('void registerEmbeddedShaders()')
+    lines.append('{')
+    lines.append('    shaderSources::registerEmbedded(TABLE, sizeof(TABLE)/sizeof(TABLE[0]));')
+    lines.append('}')
+    lines.append('')
+
+    content = '\n'.join(lines)
+
+    old = None
+    if os.path.exists(output):
+        with open(output, 'r') as f:
+            old = f.read()
+
+    if old != content:
+        with open(output, 'w') as f:
+            f.write(content)
+        print('embedShaders: %d shaders written to %s' % (len(entries), output))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,81 @@
+"""makeCheckerboardDds.py - writes the checkerboard texture as a BC1 (DXT1) DDS file with all mip levels
+
+usage: python makeCheckerboardDds.py <output .dds> [size] [cell size]
+
+the same pattern as data/checkerboard.jpg, but already compressed, so textureLoader::loadCompressedTexture
+uploads it without decoding. Legacy header with the "DXT1" fourCC (no DX10 extension).
+"""
+
+import struct
+import sys
+
+LIGHT = (255, 255, 255)
+DARK  = (64, 64, 64)
+
+DDSD_CAPS, DDSD_HEIGHT, DDSD_WIDTH, DDSD_PIXELFORMAT = 0x1, 0x2, 0x4, 0x1000
+DDSD_MIPMAPCOUNT, DDSD_LINEARSIZE = 0x20000, 0x80000
+DDPF_FOURCC = 0x4
+DDSCAPS_COMPLEX, DDSCAPS_TEXTURE, DDSCAPS_MIPMAP = 0x8, 0x1000, 0x400000
+
+
+def rgb565(c):
+    return ((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3)
+
+
+def level_blocks(size, cell):
+    """one solid BC1 block per 4x4 texels, cells smaller than a block are averaged"""
+    data = bytearray()
+    for by in range(0, max(size, 4), 4):
+        for bx in range(0, max(size, 4), 4):
+            acc = [0, 0, 0]
+            for y in range(by, by + 4):
+                for x in range(bx, bx + 4):
+                    # below one texel per cell the level is the average of both colors
+                    if cell < 1:
+                        c = [(a + b) // 2 for a, b in zip(LIGHT, DARK)]
+                    else:
+                        c = LIGHT if ((x // int(cell)) + (y // int(cell))) % 2 == 0 else DARK
+                    for i in range(3):
+                        acc[i] += c[i]
+            color = rgb565([a // 16 for a in acc])
+            # color0 == color1: 3 color mode, all indices 0
+            data += struct.pack('<HHI', color, color, 0)
+    return data
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+
+    size = int(sys.argv[2]) if len(sys.argv) > 2 else 256
+    cell = int(sys.argv[3]) if len(sys.argv) > 3 else 32
+
+    levels = []
+    s, c = size, float(cell)
+    while True:
+        levels.append(level_blocks(s, c))
+        if s == 1:
+            break
+        s //= 2
+        c /= 2
+
+    pixel_format = struct.pack('<II4sIIIII', 32, DDPF_FOURCC, b'DXT1', 0, 0, 0, 0, 0)
+    header = struct.pack('<7I', 124,
+                         DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE,
+                         size, size, len(levels[0]), 0, len(levels))
+    header += b'\0' * (11 * 4) + pixel_format
+    header += struct.pack('<5I', DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP, 0, 0, 0, 0)
+    assert len(header) == 124 and header.index(pixel_format) == 72
+
+    with open(sys.argv[1], 'wb') as f:
+        f.write(b'DDS ' + header)
+        for level in levels:
+            f.write(level)
+
+    print('%s: %dx%d, %d levels' % (sys.argv[1], size, size, len(levels)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())